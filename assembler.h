@@ -21,7 +21,9 @@
  **/
 
 #include "assembler/frontend/frontend.h"
+#include "assembler/frontend/memory.h"
 #include "assembler/generator/generator.h"
+#include "assembler/jit/jit.h"
 #include "assembler/output/output.h"
 #include "assembler/parser/parser.h"
 #include "assembler/preprocessor/preprocessor.h"
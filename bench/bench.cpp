@@ -0,0 +1,534 @@
+/**
+ * Reaver Project Assembler License
+ *
+ * Copyright © 2014 Michał "Griwes" Dominiak
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation is required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ **/
+
+#include <cstdio>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <map>
+#include <random>
+#include <chrono>
+#include <algorithm>
+#include <functional>
+
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <fcntl.h>
+
+namespace
+{
+    const char * usage = "usage: bench <rasm> <corpus directory> <baseline file> [size in KiB] [--update-baseline]\n";
+
+    const double tolerance = 0.1;
+    const int runs = 3;
+
+    struct corpus
+    {
+        std::string main;
+        std::vector<std::string> arguments;
+        std::size_t bytes = 0;
+        std::size_t instructions = 0;
+    };
+
+    struct result
+    {
+        bool failed;
+        double seconds;
+        long peak_rss;
+        std::map<std::string, double> phases;
+        // what rasm printed, if it failed
+        std::string output;
+    };
+
+    const char * phases[] = { "parse", "generate", "output" };
+
+    class writer
+    {
+    public:
+        writer(std::string directory, corpus & c) : _directory{ std::move(directory) }, _corpus{ c }
+        {
+        }
+
+        std::ofstream open(const std::string & name)
+        {
+            auto path = _directory + "/" + name;
+            if (_corpus.main.empty())
+            {
+                _corpus.main = path;
+            }
+
+            _paths.push_back(path);
+            return std::ofstream{ path, std::ios::trunc };
+        }
+
+        ~writer()
+        {
+            for (const auto & path : _paths)
+            {
+                struct stat info;
+                if (stat(path.c_str(), &info) == 0)
+                {
+                    _corpus.bytes += info.st_size;
+                }
+            }
+        }
+
+    private:
+        std::string _directory;
+        corpus & _corpus;
+        std::vector<std::string> _paths;
+    };
+
+    const char * registers64[] = { "rax", "rbx", "rcx", "rdx", "rsi", "rdi", "r8", "r9", "r10", "r11", "r12", "r13" };
+    const char * registers32[] = { "eax", "ebx", "ecx", "edx", "esi", "edi", "r8d", "r9d", "r10d", "r11d" };
+    const char * arithmetic[] = { "add", "sub", "and", "or", "xor", "cmp", "mov" };
+
+    std::size_t _instruction(std::ostream & out, std::mt19937 & random, std::size_t label_count)
+    {
+        auto pick = [&](const auto & array) { return array[random() % (sizeof(array) / sizeof(*array))]; };
+
+        switch (random() % 8)
+        {
+            case 0:
+                out << "    lea     " << pick(registers64) << ", [" << pick(registers64) << " + " << pick(registers64) << "*"
+                    << (1 << random() % 4) << " + " << random() % 4096 << "]\n";
+                break;
+            case 1:
+                out << "    mov     " << pick(registers32) << ", " << random() % 100000 << "\n";
+                break;
+            case 2:
+                out << "    push    " << pick(registers64) << "\n";
+                break;
+            case 3:
+                out << "    pop     " << pick(registers64) << "\n";
+                break;
+            case 4:
+                if (label_count)
+                {
+                    out << "    jmp     label_" << random() % label_count << "\n";
+                    break;
+                }
+                // fallthrough
+            default:
+                out << "    " << std::left << std::setw(8) << pick(arithmetic) << pick(registers64) << ", " << pick(registers64) << "\n";
+        }
+
+        return 1;
+    }
+
+    void _text(writer & w, corpus & c, std::size_t size, std::mt19937 & random)
+    {
+        auto out = w.open("text.asm");
+        out << "bits    64\n\nsection .text\nglobal _start\n\n_start:\n";
+
+        std::size_t labels = size / 512 + 1;
+        for (std::size_t i = 0, written = 0; written < size; ++i)
+        {
+            if (i % 16 == 0 && i / 16 < labels)
+            {
+                out << "label_" << i / 16 << ":\n";
+            }
+
+            std::ostringstream line;
+            c.instructions += _instruction(line, random, labels);
+            written += line.str().size();
+            out << line.str();
+        }
+    }
+
+    void _data(writer & w, corpus & c, std::size_t size, std::mt19937 & random)
+    {
+        auto out = w.open("data.asm");
+        out << "bits    64\n\nsection .data\n\n";
+
+        for (std::size_t i = 0, written = 0; written < size; ++i)
+        {
+            std::ostringstream line;
+            line << "data_" << i << ":  db ";
+
+            if (i % 2)
+            {
+                line << "\"";
+                for (auto length = random() % 48 + 8; length; --length)
+                {
+                    line << static_cast<char>('a' + random() % 26);
+                }
+                line << "\", 0x0a, 0\n";
+            }
+
+            else
+            {
+                for (auto count = random() % 24 + 8; count; --count)
+                {
+                    line << "0x" << std::hex << random() % 256 << std::dec << (count > 1 ? ", " : "\n");
+                }
+            }
+
+            ++c.instructions;
+            written += line.str().size();
+            out << line.str();
+        }
+    }
+
+    void _includes(writer & w, corpus & c, std::size_t size, std::mt19937 & random)
+    {
+        const std::size_t depth = 6;
+        const std::size_t fanout = 3;
+
+        std::size_t files = 0;
+        for (std::size_t level = 0, width = 1; level <= depth; ++level, width *= fanout)
+        {
+            files += width;
+        }
+
+        std::function<void (std::size_t, std::size_t)> node = [&](std::size_t id, std::size_t level)
+        {
+            auto out = w.open("include_" + std::to_string(id) + ".asm");
+
+            if (id == 0)
+            {
+                out << "bits    64\n\nsection .text\nglobal _start\n\n_start:\n";
+            }
+
+            for (std::size_t written = 0; written < size / files; )
+            {
+                std::ostringstream line;
+                c.instructions += _instruction(line, random, 0);
+                written += line.str().size();
+                out << line.str();
+            }
+
+            if (level == depth)
+            {
+                return;
+            }
+
+            for (std::size_t i = 1; i <= fanout; ++i)
+            {
+                out << "%include \"include_" << id * fanout + i << ".asm\"\n";
+                node(id * fanout + i, level + 1);
+            }
+        };
+
+        node(0, 0);
+        c.arguments.push_back("-I");
+        c.arguments.push_back(c.main.substr(0, c.main.rfind('/')));
+    }
+
+    void _macros(writer & w, corpus & c, std::size_t size, std::mt19937 & random)
+    {
+        auto out = w.open("macros.asm");
+        out << "bits    64\n\n";
+
+        const std::size_t macros = 64;
+        std::vector<std::size_t> lengths;
+
+        for (std::size_t i = 0; i < macros; ++i)
+        {
+            out << "%define CONSTANT_" << i << " " << random() % 65536 << "\n";
+            out << "%macro  operation_" << i << " 2\n";
+
+            lengths.push_back(random() % 6 + 2);
+            for (std::size_t j = 0; j < lengths.back(); ++j)
+            {
+                out << "    " << std::left << std::setw(8) << arithmetic[random() % (sizeof(arithmetic) / sizeof(*arithmetic))]
+                    << "%1, %2\n";
+            }
+
+            out << "    add     %1, CONSTANT_" << i << "\n%endmacro\n\n";
+        }
+
+        out << "section .text\nglobal _start\n\n_start:\n";
+
+        for (std::size_t written = 0; written < size; )
+        {
+            std::ostringstream line;
+            auto id = random() % macros;
+            line << "    operation_" << id << " " << registers64[random() % 12] << ", " << registers64[random() % 12] << "\n";
+            c.instructions += lengths[id] + 1;
+            written += line.str().size();
+            out << line.str();
+        }
+    }
+
+    result _run(const std::string & rasm, const corpus & c)
+    {
+        std::vector<std::string> arguments{ rasm, c.main, "-o", "/dev/null", "-s", "-f", "elf64", "--time-report",
+            "--report-format=json" };
+        arguments.insert(arguments.end(), c.arguments.begin(), c.arguments.end());
+
+        std::vector<char *> argv;
+        for (auto & argument : arguments)
+        {
+            argv.push_back(&argument[0]);
+        }
+        argv.push_back(nullptr);
+
+        char report_path[] = "/tmp/rasm-bench-XXXXXX";
+        int report = mkstemp(report_path);
+
+        auto start = std::chrono::steady_clock::now();
+
+        auto pid = fork();
+        if (pid == 0)
+        {
+            dup2(report, STDERR_FILENO);
+            execv(argv[0], argv.data());
+            _exit(127);
+        }
+
+        int status = 0;
+        rusage usage{};
+        wait4(pid, &status, 0, &usage);
+
+        auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        std::ifstream in{ report_path };
+        std::string text{ std::istreambuf_iterator<char>{ in }, std::istreambuf_iterator<char>{} };
+        close(report);
+        unlink(report_path);
+
+        result ret{ !WIFEXITED(status) || WEXITSTATUS(status), seconds, usage.ru_maxrss, {}, {} };
+
+        if (ret.failed)
+        {
+            ret.output = std::move(text);
+            return ret;
+        }
+
+        for (auto phase : phases)
+        {
+            auto key = "\"" + std::string{ phase } + "\": { \"wall_ms\": ";
+            auto position = text.find(key);
+
+            if (position != std::string::npos)
+            {
+                ret.phases[phase] = std::stod(text.substr(position + key.size())) / 1000;
+            }
+        }
+
+        return ret;
+    }
+
+    std::map<std::string, double> _read_baseline(const std::string & path)
+    {
+        std::map<std::string, double> ret;
+        std::ifstream in{ path };
+
+        // `<shape> <MB/s>` for the whole run and `<shape>/<phase> <MB/s>` for each phase of the time report
+        std::string key;
+        double throughput;
+        while (in >> key >> throughput)
+        {
+            ret[key] = throughput;
+        }
+
+        return ret;
+    }
+}
+
+int main(int argc, char ** argv)
+{
+    if (argc < 4)
+    {
+        std::cerr << usage;
+        return 2;
+    }
+
+    std::string rasm = argv[1];
+    std::string directory = argv[2];
+    std::string baseline_path = argv[3];
+    std::size_t size = 4096 * 1024;
+    bool update = false;
+
+    for (int i = 4; i < argc; ++i)
+    {
+        if (std::string{ argv[i] } == "--update-baseline")
+        {
+            update = true;
+        }
+
+        else
+        {
+            size = std::stoul(argv[i]) * 1024;
+        }
+    }
+
+    using generator = void (*)(writer &, corpus &, std::size_t, std::mt19937 &);
+
+    struct shape
+    {
+        std::string name;
+        generator generate;
+        // why the assembler cannot parse this shape yet; such a shape is still generated and run, and reported as
+        // rejected instead of measured, until it parses
+        const char * pending;
+    };
+
+    const std::vector<shape> shapes = {
+        { "text", _text, nullptr },
+        { "data", _data, nullptr },
+        { "includes", _includes, "%include needs the preprocessor" },
+        { "macros", _macros, "%define and %macro need the preprocessor" }
+    };
+
+    auto baseline = _read_baseline(baseline_path);
+    std::map<std::string, double> measured;
+    bool regressed = false;
+
+    // a regression of the whole run or of any single phase fails the benchmark
+    auto compare = [&](const std::string & key, double throughput)
+    {
+        measured[key] = throughput;
+
+        auto it = baseline.find(key);
+        if (it != baseline.end() && throughput < it->second * (1 - tolerance))
+        {
+            regressed = true;
+            return true;
+        }
+
+        return false;
+    };
+
+    std::cout << "shape          MB/s      instr/s   peak RSS (KiB)   parse MB/s   generate MB/s   output MB/s   baseline MB/s\n";
+
+    for (const auto & shape : shapes)
+    {
+        auto shape_directory = directory + "/" + shape.name;
+        mkdir(directory.c_str(), 0755);
+        mkdir(shape_directory.c_str(), 0755);
+
+        corpus c;
+        {
+            std::mt19937 random{ 0x72617361 };
+            writer w{ shape_directory, c };
+            shape.generate(w, c, size, random);
+        }
+
+        result best{ false, 0, 0, {}, {} };
+        for (int i = 0; i < runs; ++i)
+        {
+            auto r = _run(rasm, c);
+
+            if (r.failed && shape.pending)
+            {
+                best = std::move(r);
+                break;
+            }
+
+            // the time of a rejected input says nothing about throughput; the baseline is left alone
+            if (r.failed)
+            {
+                std::cerr << "bench: `" << rasm << " " << c.main << "` failed:\n" << r.output;
+                return 2;
+            }
+
+            if (!i || r.seconds < best.seconds)
+            {
+                best.seconds = r.seconds;
+            }
+            best.peak_rss = std::max(best.peak_rss, r.peak_rss);
+
+            for (const auto & phase : r.phases)
+            {
+                if (!best.phases.count(phase.first) || phase.second < best.phases[phase.first])
+                {
+                    best.phases[phase.first] = phase.second;
+                }
+            }
+        }
+
+        if (best.failed)
+        {
+            std::printf("%-10s rejected (%s): %s\n", shape.name.c_str(), shape.pending,
+                best.output.substr(0, best.output.find('\n')).c_str());
+            continue;
+        }
+
+        if (shape.pending)
+        {
+            std::printf("%-10s parses now; it is no longer pending (%s)\n", shape.name.c_str(), shape.pending);
+        }
+
+        auto throughput = c.bytes / best.seconds / (1024 * 1024);
+        auto total_regressed = compare(shape.name, throughput);
+
+        std::printf("%-10s %10.2f %12.0f %16ld", shape.name.c_str(), throughput, c.instructions / best.seconds, best.peak_rss);
+
+        std::vector<std::string> phase_regressions;
+        const int widths[] = { 13, 15, 13 };
+        for (std::size_t i = 0; i < 3; ++i)
+        {
+            auto it = best.phases.find(phases[i]);
+            if (it == best.phases.end() || it->second <= 0)
+            {
+                std::printf(" %*s", widths[i], "-");
+                continue;
+            }
+
+            auto phase_throughput = c.bytes / it->second / (1024 * 1024);
+            std::printf(" %*.2f", widths[i], phase_throughput);
+
+            if (compare(shape.name + "/" + phases[i], phase_throughput))
+            {
+                phase_regressions.push_back(phases[i]);
+            }
+        }
+
+        auto it = baseline.find(shape.name);
+        if (it != baseline.end())
+        {
+            std::printf(" %15.2f", it->second);
+        }
+
+        if (total_regressed)
+        {
+            std::printf("   REGRESSION");
+        }
+
+        for (const auto & phase : phase_regressions)
+        {
+            std::printf("   REGRESSION (%s)", phase.c_str());
+        }
+
+        std::printf("\n");
+    }
+
+    if (update || baseline.empty())
+    {
+        std::ofstream out{ baseline_path, std::ios::trunc };
+        for (const auto & entry : measured)
+        {
+            out << entry.first << " " << entry.second << "\n";
+        }
+
+        std::cout << "baseline written to " << baseline_path << ".\n";
+    }
+
+    return regressed ? 1 : 0;
+}
@@ -0,0 +1,326 @@
+/**
+ * Reaver Project Assembler License
+ *
+ * Copyright © 2014 Michał "Griwes" Dominiak
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation is required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ **/
+
+#include <mutex>
+#include <thread>
+#include <exception>
+#include <iostream>
+
+#include "driver.h"
+#include "../frontend/batch.h"
+#include "../parser/parser.h"
+#include "../parser/census.h"
+#include "../parser/precompiled.h"
+#include "../generator/generator.h"
+#include "../output/output.h"
+#include "../utils/thread_pool.h"
+#include "../utils/spsc_queue.h"
+#include "../utils/statistics.h"
+#include "../utils/trace.h"
+
+namespace
+{
+    // batches of statements in flight between the parser and generator threads of --pipeline
+    const std::size_t _pipeline_depth = 8;
+
+    // thrown out of the parser sink once the generator has closed the queue, so that the parser stops instead of
+    // producing batches nobody is going to consume
+    struct _pipeline_cancelled
+    {
+    };
+
+    // runs the parser on its own thread, feeding the generator on the calling thread through a bounded queue; a full
+    // queue stalls the parser and an empty one stalls the generator, so comparing the stall times shows which of the two
+    // limits the throughput of a given input
+    template<typename F>
+    void _pipeline(const reaver::assembler::frontend & front, const reaver::assembler::parser & parse, F generate)
+    {
+        using reaver::assembler::utils::statistics;
+        using reaver::assembler::utils::trace;
+
+        auto stats = front.statistics();
+        reaver::assembler::utils::spsc_queue<reaver::assembler::ast> queue{ _pipeline_depth };
+
+        statistics::stopwatch parsing, generating;
+        std::exception_ptr error;
+
+        std::thread producer{ [&]()
+        {
+            trace::span span{ front.trace(), "parse", "phase" };
+
+            if (stats)
+            {
+                parsing.start();
+            }
+
+            try
+            {
+                parse([&](reaver::assembler::ast && batch)
+                {
+                    if (!queue.push(std::move(batch)))
+                    {
+                        throw _pipeline_cancelled{};
+                    }
+                });
+            }
+
+            catch (_pipeline_cancelled &)
+            {
+            }
+
+            catch (...)
+            {
+                error = std::current_exception();
+            }
+
+            if (stats)
+            {
+                parsing.stop();
+            }
+
+            queue.close();
+        } };
+
+        if (stats)
+        {
+            generating.start();
+        }
+
+        try
+        {
+            reaver::assembler::ast batch;
+
+            while (queue.pop(batch))
+            {
+                generate(std::move(batch));
+            }
+        }
+
+        catch (...)
+        {
+            // the parser stops at its next push instead of blocking on a queue nobody drains
+            queue.close();
+            producer.join();
+            throw;
+        }
+
+        producer.join();
+
+        if (stats)
+        {
+            generating.stop();
+        }
+
+        if (error)
+        {
+            std::rethrow_exception(error);
+        }
+
+        if (stats)
+        {
+            stats->add("parse", parsing.elapsed());
+            stats->add("parse/stall", { queue.producer_stall(), {} });
+            stats->add("generate", generating.elapsed());
+            stats->add("generate/stall", { queue.consumer_stall(), {} });
+            stats->count("pipeline batches", queue.pushed());
+            stats->maximum("pipeline peak occupancy", queue.peak());
+        }
+    }
+
+    void _assemble(const reaver::assembler::frontend & front, reaver::error_engine & engine)
+    {
+        using reaver::assembler::utils::statistics;
+        using reaver::assembler::utils::trace;
+
+        auto stats = front.statistics();
+        trace::span job{ front.trace(), front.input_name(), "job" };
+
+        if (front.precompile())
+        {
+            statistics::scope timer{ stats, "precompile" };
+            trace::span span{ front.trace(), "precompile", "phase" };
+            reaver::assembler::precompile(front, engine, (*reaver::assembler::create_parser(front, engine))());
+            return;
+        }
+
+        // the parser hands over batches of statements as it goes, so only one batch of the tree is resident at a time;
+        // parsing and generation interleave, so their times are accumulated separately
+        std::unique_ptr<reaver::assembler::object> generated;
+        {
+            statistics::scope timer{ stats, "assemble" };
+            statistics::stopwatch parsing, generating;
+
+            auto generator = reaver::assembler::create_generator(front, engine);
+            auto session = generator->start();
+            auto parser = reaver::assembler::create_parser(front, engine);
+
+            auto generate = [&](reaver::assembler::ast && batch)
+            {
+                if (stats && reaver::assembler::utils::allocation::enabled)
+                {
+                    reaver::assembler::ast_census(batch, *stats);
+                }
+
+                trace::span batch_span{ front.trace(), "generate batch", "encode" };
+                (*session)(batch);
+            };
+
+            if (front.pipeline())
+            {
+                _pipeline(front, *parser, generate);
+            }
+
+            else
+            {
+                trace::span span{ front.trace(), "parse", "phase" };
+
+                if (stats)
+                {
+                    parsing.start();
+                }
+
+                (*parser)([&](reaver::assembler::ast && batch)
+                {
+                    if (stats)
+                    {
+                        parsing.stop();
+                        generating.start();
+                    }
+
+                    generate(std::move(batch));
+
+                    if (stats)
+                    {
+                        generating.stop();
+                        parsing.start();
+                    }
+                });
+
+                if (stats)
+                {
+                    parsing.stop();
+                }
+            }
+
+            trace::span span{ front.trace(), "generate", "phase" };
+
+            if (stats)
+            {
+                generating.start();
+            }
+
+            generated = session->finish();
+
+            if (stats)
+            {
+                generating.stop();
+                stats->add("parse", parsing.elapsed());
+                stats->add("generate", generating.elapsed());
+            }
+        }
+
+        statistics::scope timer{ stats, "output" };
+        trace::span span{ front.trace(), "output", "phase" };
+        (*reaver::assembler::create_output(front, engine))(generated);
+    }
+
+    void _report(const reaver::assembler::console_frontend & frontend)
+    {
+        if (auto stats = frontend.statistics())
+        {
+            stats->print(std::cerr, frontend.time_report(), frontend.statistics_report(), frontend.json_report());
+        }
+    }
+
+    int _batch(const reaver::assembler::console_frontend & frontend, reaver::logger::logger & log)
+    {
+        using reaver::logger::crash;
+
+        std::mutex lock;
+        int result = 0;
+
+        auto threads = frontend.threads() ? frontend.threads() : std::max(std::thread::hardware_concurrency(), 1u);
+        reaver::assembler::utils::thread_pool pool{ threads };
+
+        for (const auto & job : frontend.jobs())
+        {
+            pool.push([&]()
+            {
+                reaver::error_engine engine;
+
+                try
+                {
+                    reaver::assembler::batch_frontend front{ frontend, job.first, job.second, engine };
+                    _assemble(front, engine);
+
+                    if (engine.size())
+                    {
+                        std::lock_guard<std::mutex> guard{ lock };
+                        engine.print(log);
+                    }
+                }
+
+                catch (reaver::exception & e)
+                {
+                    std::lock_guard<std::mutex> guard{ lock };
+                    e.print(log);
+                    result = std::max(result, e.level() == crash ? 2 : 1);
+                }
+
+                catch (std::exception & e)
+                {
+                    std::lock_guard<std::mutex> guard{ lock };
+                    log(crash) << job.first << ": " << e.what();
+                    result = 2;
+                }
+            });
+        }
+
+        pool.wait();
+        return result;
+    }
+}
+
+int reaver::assembler::run(const console_frontend & frontend, error_engine & engine, logger::logger & log)
+{
+    if (frontend.batch())
+    {
+        if (engine.size())
+        {
+            engine.print(log);
+        }
+
+        auto result = _batch(frontend, log);
+        _report(frontend);
+        return result;
+    }
+
+    _assemble(frontend, engine);
+    _report(frontend);
+
+    if (engine.size())
+    {
+        engine.print(log);
+    }
+
+    return 0;
+}
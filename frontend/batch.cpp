@@ -0,0 +1,65 @@
+/**
+ * Reaver Project Assembler License
+ *
+ * Copyright © 2014 Michał "Griwes" Dominiak
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation is required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ **/
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <boost/filesystem.hpp>
+
+#include "batch.h"
+
+reaver::assembler::batch_frontend::batch_frontend(const console_frontend & parent, std::string input, std::string output,
+    error_engine & engine) : _parent{ parent }, _input_name{ std::move(input) }
+{
+    _asm_only = _parent.assemble_only() || boost::filesystem::path(output).extension() == ".o";
+
+    _input.open(_input_name, std::ios::in);
+    if (!_input)
+    {
+        engine.push(exception(logger::error) << "failed to open input file `"  << _input_name << ".");
+        throw std::move(engine);
+    }
+
+    _output_buffer.reset(::open(output.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0666));
+    if (_output_buffer.descriptor() < 0)
+    {
+        engine.push(exception(logger::error) << "failed to open output file `" << output << ".");
+        throw std::move(engine);
+    }
+
+    for (const auto & x : _parent.default_include_names())
+    {
+        _default_includes.emplace_back(find_file(_parent.include_paths(), x, _parent.cache()));
+    }
+
+    _include_paths = _parent.include_paths();
+    _include_paths.insert(_include_paths.begin(), _parent.working_directory());
+    _include_paths.insert(_include_paths.begin() + 1, boost::filesystem::absolute(_input_name).parent_path().string());
+}
+
+reaver::assembler::batch_frontend::~batch_frontend()
+{
+    if (_output_buffer.descriptor() >= 0)
+    {
+        ::close(_output_buffer.descriptor());
+    }
+}
@@ -0,0 +1,185 @@
+/**
+ * Reaver Project Assembler License
+ *
+ * Copyright © 2014 Michał "Griwes" Dominiak
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation is required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ **/
+
+#pragma once
+
+#include <fstream>
+
+#include <reaver/error.h>
+
+#include "console.h"
+#include "../utils/descriptor.h"
+
+namespace reaver
+{
+    namespace assembler
+    {
+        class batch_frontend : public frontend
+        {
+        public:
+            batch_frontend(const console_frontend &, std::string, std::string, error_engine &);
+            virtual ~batch_frontend();
+
+            virtual bool assemble_only() const override
+            {
+                return _asm_only;
+            }
+
+            virtual std::string syntax() const override
+            {
+                return _parent.syntax();
+            }
+
+            virtual ::reaver::target::triple target() const override
+            {
+                return _parent.target();
+            }
+
+            virtual std::string format() const override
+            {
+                return _parent.format();
+            }
+
+            virtual std::istream & input() const override
+            {
+                return _input;
+            }
+
+            virtual std::ostream & output() const override
+            {
+                return _output;
+            }
+
+            virtual int output_descriptor() const override
+            {
+                return _output_buffer.descriptor();
+            }
+
+            virtual bool parallel_output() const override
+            {
+                return _parent.parallel_output();
+            }
+
+            virtual bool pipeline() const override
+            {
+                return _parent.pipeline();
+            }
+
+            virtual bool gc_sections() const override
+            {
+                return _parent.gc_sections();
+            }
+
+            virtual bool icf() const override
+            {
+                return _parent.icf();
+            }
+
+            virtual std::string input_name() const override
+            {
+                return _input_name;
+            }
+
+            virtual std::vector<file> & default_includes() const override
+            {
+                return _default_includes;
+            }
+
+            virtual const std::vector<std::string> & precompiled_includes() const override
+            {
+                return _parent.precompiled_includes();
+            }
+
+            virtual bool precompile() const override
+            {
+                return _parent.precompile();
+            }
+
+            virtual file open_file(std::string filename) const override
+            {
+                return find_file(_include_paths, std::move(filename), _parent.cache());
+            }
+
+            virtual std::string locate_file(std::string filename) const override
+            {
+                return find_path(_include_paths, std::move(filename));
+            }
+
+            virtual const std::map<std::string, std::shared_ptr<define>> & defines() const override
+            {
+                return _parent.defines();
+            }
+
+            virtual logger::level warning_level() const override
+            {
+                return _parent.warning_level();
+            }
+
+            virtual std::size_t error_limit() const override
+            {
+                return _parent.error_limit();
+            }
+
+            virtual bool debug_info() const override
+            {
+                return _parent.debug_info();
+            }
+
+            virtual bool compress_debug_sections() const override
+            {
+                return _parent.compress_debug_sections();
+            }
+
+            virtual bool performance_report() const override
+            {
+                return _parent.performance_report();
+            }
+
+            virtual std::string microarchitecture() const override
+            {
+                return _parent.microarchitecture();
+            }
+
+            virtual utils::statistics * statistics() const override
+            {
+                return _parent.statistics();
+            }
+
+            virtual utils::trace * trace() const override
+            {
+                return _parent.trace();
+            }
+
+        private:
+            const console_frontend & _parent;
+            bool _asm_only;
+
+            mutable std::ifstream _input;
+            mutable utils::descriptor_buffer _output_buffer;
+            mutable std::ostream _output{ &_output_buffer };
+
+            std::string _input_name;
+            mutable std::vector<file> _default_includes;
+            std::vector<std::string> _include_paths;
+        };
+    }
+}
@@ -22,12 +22,16 @@
 
 #include <iostream>
 
+#include <fcntl.h>
+#include <unistd.h>
+
 #include <boost/filesystem.hpp>
 #include <boost/algorithm/string.hpp>
 
 #include <reaver/error.h>
 
 #include "console.h"
+#include "../server/protocol.h"
 
 namespace reaver
 {
@@ -43,7 +47,9 @@ using reaver::style::styles;
 
 using namespace reaver::target;
 
-reaver::assembler::console_frontend::console_frontend(int argc, char ** argv, error_engine & engine)
+reaver::assembler::console_frontend::console_frontend(int argc, char ** argv, error_engine & engine,
+    std::string working_directory, utils::file_cache * cache) : _working_directory{ working_directory.empty()
+    ? boost::filesystem::current_path().string() : std::move(working_directory) }, _cache{ cache }
 {
     boost::program_options::options_description general("General options");
     general.add_options()
@@ -52,11 +58,21 @@ reaver::assembler::console_frontend::console_frontend(int argc, char ** argv, er
 
     boost::program_options::options_description config("Configuration");
     config.add_options()
-        ("output,o", boost::program_options::value<std::string>()->default_value(""), "specify output file")
+        ("output,o", boost::program_options::value<std::string>()->default_value(""), "specify output file; `-` writes to standard output")
         ("assemble-only,s", "assemble only, do not link")
+        ("parallel-output", "preallocate the output file and write its sections concurrently at their final offsets")
+        ("pipeline", "parse and generate code concurrently on separate threads, passing batches of statements between them")
+        ("gc-sections", "when linking, remove sections unreachable from `_start`")
+        ("icf", "when linking, fold identical code sections")
+        ("debug,g", "generate DWARF line number information (.debug_line)")
+        ("compress-debug-sections", "compress debug sections with zlib (SHF_COMPRESSED)")
         ("include-dir,I", boost::program_options::value<std::vector<std::string>>(&_include_paths)->composing(), "specify additional"
             " include directories")
         ("include,i", boost::program_options::value<std::vector<std::string>>()->composing(), "specify automatically included file")
+        ("include-pch", boost::program_options::value<std::vector<std::string>>()->composing(), "specify precompiled header "
+            "used before the input file")
+        ("precompile", "write a precompiled header with the constants and symbol declarations of the input file instead of "
+            "assembling it")
         ("syntax", boost::program_options::value<std::string>()->default_value(""), "specify assembly syntax "
             "(x86 and x86_64 only); currently supported:\n- intel (default for x86 and x86_64 targets)")
         ("format,f", boost::program_options::value<std::string>()->default_value("elf64"), "specify format; currently "
@@ -68,20 +84,50 @@ reaver::assembler::console_frontend::console_frontend(int argc, char ** argv, er
     errors.add_options()
         ("Wextra", boost::program_options::value<bool>(&_wextra)->implicit_value(true), " enable additional warnings")
         ("Werror", boost::program_options::value<bool>(&_werror)->implicit_value(true), " throw errors instead of warnings")
+        ("error-limit", boost::program_options::value<std::size_t>()->default_value(20), "stop after the specified number "
+            "of errors; 0 disables the limit")
         ("Wno-long-mode-ss-write", boost::program_options::value<bool>(&_no_ss_warning)->implicit_value(true), " disable warning"
             " about write to segment register being ignored in 64 bit mode, if the segment register is SS (i(X)86 and x86_64 only)")
         ("optimizations,O", boost::program_options::value<int>(&_opt), "set optimization level; supported levels:\n"
             "- O0 - disable all optimizations\n- O1 - enable space optimizations (default)\n- O2 - enable additional optimizations");
 
+    boost::program_options::options_description batch("Batch options");
+    batch.add_options()
+        ("batch", "assemble every input file to its own output file (input with its extension replaced by .o with -s, "
+            "by .rpch with --precompile, by .out otherwise) in a single process")
+        ("manifest", boost::program_options::value<std::string>(), "read additional batch jobs from the specified file, one "
+            "`<input file> [output file]` per line; implies --batch")
+        ("jobs,j", boost::program_options::value<std::size_t>()->default_value(0), "number of threads used in batch mode; "
+            "0 (default) uses one per hardware thread");
+
+    boost::program_options::options_description server("Server options");
+    server.add_options()
+        ("server", "keep running and assemble invocations sent by `rasm --connect` over a Unix domain socket")
+        ("connect", "send this invocation to a running server, or assemble locally if there is none")
+        ("socket", boost::program_options::value<std::string>()->default_value(default_socket_path()), "specify the socket "
+            "used by --server and --connect");
+
+    boost::program_options::options_description analysis("Analysis options");
+    analysis.add_options()
+        ("perf-report", "print estimated uops, port pressure, latency chain and reciprocal throughput of every basic block")
+        ("perf-arch", boost::program_options::value<std::string>()->default_value("skylake"), "specify microarchitecture "
+            "used by --perf-report; currently supported:\n- skylake (default)\n- zen2")
+        ("time-report", "print wall and CPU time spent in every phase and sub-phase")
+        ("stats", "print counts of lines, tokens, instructions, symbols, relocations and bytes per section")
+        ("report-format", boost::program_options::value<std::string>()->default_value("text"), "specify format of "
+            "--time-report and --stats; currently supported:\n- text (default)\n- json")
+        ("trace", boost::program_options::value<std::string>(), "write Chrome trace events for every file, include, parser "
+            "chunk, encoding run and output write to the specified file");
+
     boost::program_options::options_description hidden("Hidden");
     hidden.add_options()
-        ("input", boost::program_options::value<std::string>(), "specify input file");
+        ("input", boost::program_options::value<std::vector<std::string>>()->composing(), "specify input file");
 
     boost::program_options::positional_options_description pod;
-    pod.add("input", 1);
+    pod.add("input", -1);
 
     boost::program_options::options_description options;
-    options.add(config).add(hidden).add(general).add(errors);
+    options.add(config).add(hidden).add(general).add(errors).add(batch).add(server).add(analysis);
     boost::program_options::store(boost::program_options::command_line_parser(argc, argv).options(options).positional(pod)
         .style(boost::program_options::command_line_style::allow_short
             | boost::program_options::command_line_style::allow_long
@@ -96,10 +142,14 @@ reaver::assembler::console_frontend::console_frontend(int argc, char ** argv, er
         std::cout << version_string << '\n';
 
         std::cout << "Usage:\n";
-        std::cout << "  rasm [options] <input file> [options]\n\n";
+        std::cout << "  rasm [options] <input file> [options]\n";
+        std::cout << "  rasm --batch [options] <input files...> [options]\n";
+        std::cout << "  rasm --server [--socket <path>]\n\n";
+        std::cout << "Use `-` as the input file to read from standard input.\n\n";
 
         std::stringstream ss;
-        ss << general << std::endl << config << std::endl << errors;
+        ss << general << std::endl << config << std::endl << errors << std::endl << batch << std::endl << server
+            << std::endl << analysis;
         std::string str = ss.str();
         boost::algorithm::replace_all(str, "--W", "-W");
         boost::algorithm::replace_all(str, "--D", "-D");
@@ -121,7 +171,131 @@ reaver::assembler::console_frontend::console_frontend(int argc, char ** argv, er
         std::exit(0);
     }
 
-    _input_name = _variables.count("input") ? _variables["input"].as<std::string>() : "";
+    std::vector<std::string> inputs;
+    if (_variables.count("input"))
+    {
+        inputs = _variables["input"].as<std::vector<std::string>>();
+    }
+
+    if (_variables.count("server"))
+    {
+        _server = true;
+        return;
+    }
+
+    for (auto & path : _include_paths)
+    {
+        path = _resolve(path);
+    }
+
+    if (_variables.count("trace"))
+    {
+        _trace.open(_resolve(_variables["trace"].as<std::string>()));
+    }
+
+    if (_variables.count("include-pch"))
+    {
+        for (const auto & path : _variables.at("include-pch").as<std::vector<std::string>>())
+        {
+            _precompiled_includes.push_back(_resolve(path));
+        }
+    }
+
+    _batch = _variables.count("batch") || _variables.count("manifest");
+    _asm_only = _variables.count("assemble-only");
+    std::string extension = precompile() ? ".rpch" : _asm_only ? ".o" : ".out";
+
+    if (_variables["report-format"].as<std::string>() != "text" && _variables["report-format"].as<std::string>() != "json")
+    {
+        engine.push(exception(logger::error) << "not supported report format selected: `" << _variables["report-format"]
+            .as<std::string>() << "`.");
+        throw std::move(engine);
+    }
+
+    _target = _variables["target"].as<std::string>();
+
+    if (_target.arch() >= arch::i386 && _target.arch() <= arch::x86_64 && _variables["syntax"].as<std::string>() == "")
+    {
+        _variables.at("syntax").value() = boost::any{ std::string{ "intel" } };
+    }
+
+    if (_variables.count("optimizations"))
+    {
+        _opt = _variables.at("optimizations").as<int>();
+    }
+
+    if (_opt > 2)
+    {
+        engine.push(exception(logger::warning) << "not supported optimization level requested; changing to 2.");
+        _opt = 2;
+    }
+
+    if (_batch)
+    {
+        if (_variables["output"].as<std::string>() != "")
+        {
+            engine.push(exception(logger::error) << "output file cannot be specified in batch mode.");
+            throw std::move(engine);
+        }
+
+        for (const auto & input : inputs)
+        {
+            _jobs.emplace_back(_resolve(input), _resolve(boost::filesystem::path{ input }.replace_extension(extension)
+                .string()));
+        }
+
+        if (_variables.count("manifest"))
+        {
+            std::ifstream manifest{ _resolve(_variables["manifest"].as<std::string>()) };
+            if (!manifest)
+            {
+                engine.push(exception(logger::error) << "failed to open manifest file `" << _variables["manifest"].as<std::string>()
+                    << "`.");
+                throw std::move(engine);
+            }
+
+            std::string line;
+            while (std::getline(manifest, line))
+            {
+                std::istringstream fields{ line };
+                std::string input, output;
+
+                if (!(fields >> input) || input[0] == '#')
+                {
+                    continue;
+                }
+
+                if (!(fields >> output))
+                {
+                    output = boost::filesystem::path{ input }.replace_extension(extension).string();
+                }
+
+                _jobs.emplace_back(_resolve(input), _resolve(output));
+            }
+        }
+
+        if (_jobs.empty())
+        {
+            engine.push(exception(logger::error) << "you must specify input file.");
+            throw std::move(engine);
+        }
+
+        if (_variables.count("include"))
+        {
+            _default_include_names = _variables.at("include").as<std::vector<std::string>>();
+        }
+
+        return;
+    }
+
+    if (inputs.size() > 1)
+    {
+        engine.push(exception(logger::error) << "multiple input files specified; use --batch to assemble them in a single "
+            "process.");
+        throw std::move(engine);
+    }
+
+    _input_name = inputs.empty() ? "" : inputs.front();
 
     if (_input_name == "")
     {
@@ -129,8 +303,18 @@ reaver::assembler::console_frontend::console_frontend(int argc, char ** argv, er
         throw std::move(engine);
     }
 
-    _input.open(_input_name, std::ios::in);
-    if (!_input)
+    if (_input_name == "-")
+    {
+        _input_name = "<stdin>";
+        _input_stream = &_stdin;
+    }
+
+    else
+    {
+        _input.open(_resolve(_input_name), std::ios::in);
+    }
+
+    if (!input())
     {
         engine.push(exception(logger::error) << "failed to open input file `"  << _input_name << ".");
         throw std::move(engine);
@@ -138,26 +322,31 @@ reaver::assembler::console_frontend::console_frontend(int argc, char ** argv, er
 
     if (_variables["output"].as<std::string>() == "")
     {
-        _variables.at("output").value() = boost::any{ boost::filesystem::path{ _input_name }.replace_extension(".out").string() };
+        _variables.at("output").value() = boost::any{ _input_stream == &_stdin ? std::string{ "a.out" }
+            : boost::filesystem::path{ _input_name }.replace_extension(precompile() ? ".rpch" : ".out").string() };
     }
 
-    _output.open(_variables["output"].as<std::string>(), std::ios::out | std::ios::binary);
-    if (!_output)
+    if (_variables["output"].as<std::string>() == "-")
     {
-        engine.push(exception(logger::error) << "failed to open output file `" << _variables["output"].as<std::string>() << ".");
-        throw std::move(engine);
+        _output_buffer.reset(STDOUT_FILENO);
+        _owns_output = false;
     }
 
-    if (_variables.count("assemble-only") || boost::filesystem::path(_variables["output"].as<std::string>()).extension() == ".o")
+    else
     {
-        _asm_only = true;
+        _output_buffer.reset(::open(_resolve(_variables["output"].as<std::string>()).c_str(), O_WRONLY | O_CREAT | O_TRUNC,
+            0666));
     }
 
-    _target = _variables["target"].as<std::string>();
+    if (_output_buffer.descriptor() < 0)
+    {
+        engine.push(exception(logger::error) << "failed to open output file `" << _variables["output"].as<std::string>() << ".");
+        throw std::move(engine);
+    }
 
-    if (_target.arch() >= arch::i386 && _target.arch() <= arch::x86_64 && _variables["syntax"].as<std::string>() == "")
+    if (boost::filesystem::path(_variables["output"].as<std::string>()).extension() == ".o")
     {
-        _variables.at("syntax").value() = boost::any{ std::string{ "intel" } };
+        _asm_only = true;
     }
 
     if (_variables.count("include"))
@@ -168,57 +357,96 @@ reaver::assembler::console_frontend::console_frontend(int argc, char ** argv, er
         }
     }
 
-    if (_variables.count("optimizations"))
-    {
-        _opt = _variables.at("optimizations").as<int>();
-    }
+    _include_paths.insert(_include_paths.begin(), _working_directory);
+    _include_paths.insert(_include_paths.begin() + 1, _input_stream == &_stdin ? _working_directory
+        : boost::filesystem::path(_resolve(_input_name)).parent_path().string());
+}
 
-    if (_opt > 2)
+std::string reaver::assembler::console_frontend::_resolve(const std::string & path) const
+{
+    return boost::filesystem::absolute(path, _working_directory).string();
+}
+
+reaver::assembler::console_frontend::~console_frontend()
+{
+    if (_owns_output && _output_buffer.descriptor() >= 0)
     {
-        engine.push(exception(logger::warning) << "not supported optimization level requested; changing to 2.");
-        _opt = 2;
+        ::close(_output_buffer.descriptor());
     }
-
-    _include_paths.insert(_include_paths.begin(), boost::filesystem::current_path().string());
-    _include_paths.insert(_include_paths.begin() + 1, boost::filesystem::absolute(_input_name).parent_path().string());
 }
 
 reaver::assembler::file reaver::assembler::console_frontend::open_file(std::string filename) const
 {
-    if (boost::filesystem::path(filename).is_absolute())
+    return find_file(_include_paths, std::move(filename), _cache);
+}
+
+std::string reaver::assembler::console_frontend::locate_file(std::string filename) const
+{
+    return find_path(_include_paths, std::move(filename));
+}
+
+reaver::assembler::file reaver::assembler::find_file(const std::vector<std::string> & include_paths, std::string filename,
+    utils::file_cache * cache)
+{
+    auto open = [&](const std::string & path) -> std::unique_ptr<std::istream>
     {
-        if (boost::filesystem::is_regular_file(filename))
+        if (cache)
         {
-            std::ifstream ret{ filename, std::ios::in };
+            auto contents = cache->get(path);
+            return contents ? std::make_unique<std::istringstream>(*contents) : nullptr;
+        }
 
-            if (!ret)
-            {
-                throw file_failed_to_open{ filename };
-            }
+        if (!boost::filesystem::is_regular_file(path))
+        {
+            return nullptr;
+        }
 
-            return { filename, std::move(ret) };
+        auto ret = std::make_unique<std::ifstream>(path, std::ios::in);
+
+        if (!*ret)
+        {
+            throw file_failed_to_open{ filename };
         }
 
-        else
+        return ret;
+    };
+
+    if (boost::filesystem::path(filename).is_absolute())
+    {
+        if (auto ret = open(filename))
         {
-            throw file_is_directory{ filename };
+            return { filename, std::move(ret) };
         }
+
+        throw file_is_directory{ filename };
     }
 
-    for (auto & path : _include_paths)
+    for (auto & path : include_paths)
     {
-        if (boost::filesystem::is_regular_file(path + "/" + filename))
+        if (auto ret = open(path + "/" + filename))
         {
-            std::ifstream ret{ path + "/" + filename, std::ios::in };
+            return { (include_paths.size() > 1 && (path == include_paths[0]
+                || path == include_paths[1])) ? filename : path + "/" + filename, std::move(ret) };
+        }
+    }
 
-            if (!ret)
-            {
-                throw file_failed_to_open{ filename };
-            }
+    throw file_not_found{ filename };
+}
 
-            return { (path == _include_paths[0] || path == _include_paths[1]) ? filename : path + "/" + filename, std::move(ret) };
+std::string reaver::assembler::find_path(const std::vector<std::string> & include_paths, std::string filename)
+{
+    if (boost::filesystem::path(filename).is_absolute())
+    {
+        return boost::filesystem::is_regular_file(filename) ? filename : "";
+    }
+
+    for (auto & path : include_paths)
+    {
+        if (boost::filesystem::is_regular_file(path + "/" + filename))
+        {
+            return boost::filesystem::absolute(path + "/" + filename).string();
         }
     }
 
-    throw file_not_found{ filename };
+    return "";
 }
@@ -22,22 +22,78 @@
 
 #pragma once
 
+#include <fstream>
+
+#include <unistd.h>
+
 #include <boost/program_options.hpp>
 
 #include <reaver/target.h>
 #include <reaver/error.h>
 
 #include "frontend.h"
+#include "../utils/descriptor.h"
+#include "../utils/file_cache.h"
+#include "../utils/statistics.h"
+#include "../utils/trace.h"
 
 namespace reaver
 {
     namespace assembler
     {
+        file find_file(const std::vector<std::string> &, std::string, utils::file_cache * = nullptr);
+        std::string find_path(const std::vector<std::string> &, std::string);
+
         class console_frontend : public frontend
         {
         public:
-            console_frontend(int, char **, error_engine &);
-            virtual ~console_frontend() {}
+            console_frontend(int, char **, error_engine &, std::string = "", utils::file_cache * = nullptr);
+            virtual ~console_frontend();
+
+            bool batch() const
+            {
+                return _batch;
+            }
+
+            bool server() const
+            {
+                return _server;
+            }
+
+            std::string socket() const
+            {
+                return _variables["socket"].as<std::string>();
+            }
+
+            const std::string & working_directory() const
+            {
+                return _working_directory;
+            }
+
+            utils::file_cache * cache() const
+            {
+                return _cache;
+            }
+
+            const std::vector<std::pair<std::string, std::string>> & jobs() const
+            {
+                return _jobs;
+            }
+
+            std::size_t threads() const
+            {
+                return _variables["jobs"].as<std::size_t>();
+            }
+
+            const std::vector<std::string> & include_paths() const
+            {
+                return _include_paths;
+            }
+
+            const std::vector<std::string> & default_include_names() const
+            {
+                return _default_include_names;
+            }
 
             virtual bool assemble_only() const override
             {
@@ -61,7 +117,7 @@ namespace reaver
 
             virtual std::istream & input() const override
             {
-                return _input;
+                return *_input_stream;
             }
 
             virtual std::ostream & output() const override
@@ -69,6 +125,31 @@ namespace reaver
                 return _output;
             }
 
+            virtual int output_descriptor() const override
+            {
+                return _output_buffer.descriptor();
+            }
+
+            virtual bool parallel_output() const override
+            {
+                return _variables.count("parallel-output");
+            }
+
+            virtual bool pipeline() const override
+            {
+                return _variables.count("pipeline");
+            }
+
+            virtual bool gc_sections() const override
+            {
+                return _variables.count("gc-sections");
+            }
+
+            virtual bool icf() const override
+            {
+                return _variables.count("icf");
+            }
+
             virtual std::string input_name() const override
             {
                 return _input_name;
@@ -79,7 +160,18 @@ namespace reaver
                 return _default_includes;
             }
 
+            virtual const std::vector<std::string> & precompiled_includes() const override
+            {
+                return _precompiled_includes;
+            }
+
+            virtual bool precompile() const override
+            {
+                return _variables.count("precompile");
+            }
+
             virtual file open_file(std::string) const override;
+            virtual std::string locate_file(std::string) const override;
 
             virtual const std::map<std::string, std::shared_ptr<define>> & defines() const override
             {
@@ -91,21 +183,89 @@ namespace reaver
                 return _werror ? logger::error : logger::warning;
             }
 
+            virtual std::size_t error_limit() const override
+            {
+                return _variables["error-limit"].as<std::size_t>();
+            }
+
+            virtual bool debug_info() const override
+            {
+                return _variables.count("debug");
+            }
+
+            virtual bool compress_debug_sections() const override
+            {
+                return _variables.count("compress-debug-sections");
+            }
+
+            virtual bool performance_report() const override
+            {
+                return _variables.count("perf-report");
+            }
+
+            virtual std::string microarchitecture() const override
+            {
+                return _variables["perf-arch"].as<std::string>();
+            }
+
+            virtual utils::statistics * statistics() const override
+            {
+                return time_report() || statistics_report() ? &_statistics : nullptr;
+            }
+
+            virtual utils::trace * trace() const override
+            {
+                return _trace.enabled() ? &_trace : nullptr;
+            }
+
+            bool time_report() const
+            {
+                return _variables.count("time-report");
+            }
+
+            bool statistics_report() const
+            {
+                return _variables.count("stats");
+            }
+
+            bool json_report() const
+            {
+                return _variables["report-format"].as<std::string>() == "json";
+            }
+
         private:
+            std::string _resolve(const std::string &) const;
+
             boost::program_options::variables_map _variables;
+            std::string _working_directory;
+            utils::file_cache * _cache;
+
             bool _asm_only = false;
+            bool _batch = false;
+            bool _server = false;
             bool _wextra = false;
             bool _werror = false;
             bool _no_ss_warning = false;
             int _opt = 1;
 
             mutable std::ifstream _input;
-            mutable std::ofstream _output;
+            mutable utils::descriptor_input_buffer _stdin_buffer{ STDIN_FILENO };
+            mutable std::istream _stdin{ &_stdin_buffer };
+            std::istream * _input_stream = &_input;
+            bool _owns_output = true;
+            mutable utils::descriptor_buffer _output_buffer;
+            mutable std::ostream _output{ &_output_buffer };
 
             std::string _input_name;
             mutable std::vector<file> _default_includes;
+            mutable utils::statistics _statistics;
+            mutable utils::trace _trace;
             std::vector<std::string> _include_paths;
 
+            std::vector<std::pair<std::string, std::string>> _jobs;
+            std::vector<std::string> _default_include_names;
+            std::vector<std::string> _precompiled_includes;
+
             std::map<std::string, std::shared_ptr<define>> _defines;
 
             ::reaver::target::triple _target;
@@ -22,7 +22,7 @@
 
 #pragma once
 
-#include <fstream>
+#include <istream>
 #include <vector>
 #include <map>
 #include <memory>
@@ -36,16 +36,22 @@ namespace reaver
     {
         class define;
 
+        namespace utils
+        {
+            class statistics;
+            class trace;
+        }
+
         struct file
         {
             file(file &&) = default;
 
-            file(std::string n, std::ifstream && str) : name{ std::move(n) }, stream{ std::move(str) }
+            file(std::string n, std::unique_ptr<std::istream> str) : name{ std::move(n) }, stream{ std::move(str) }
             {
             }
 
             std::string name;
-            std::ifstream stream;
+            std::unique_ptr<std::istream> stream;
         };
 
         class frontend
@@ -61,15 +67,34 @@ namespace reaver
 
             virtual std::istream & input() const = 0;
             virtual std::ostream & output() const = 0;
+            virtual int output_descriptor() const = 0;
+            virtual bool parallel_output() const = 0;
+            virtual bool pipeline() const = 0;
+            virtual bool gc_sections() const = 0;
+            virtual bool icf() const = 0;
 
             virtual std::string input_name() const = 0;
             virtual std::vector<file> & default_includes() const = 0;
+            virtual const std::vector<std::string> & precompiled_includes() const = 0;
+            virtual bool precompile() const = 0;
 
             virtual file open_file(std::string) const = 0;
+            // the path of a file to be read by the output stage instead of the parser; empty if there is none
+            virtual std::string locate_file(std::string) const = 0;
 
             virtual const std::map<std::string, std::shared_ptr<define>> & defines() const = 0;
 
             virtual logger::level warning_level() const = 0;
+            virtual std::size_t error_limit() const = 0;
+
+            virtual bool debug_info() const = 0;
+            virtual bool compress_debug_sections() const = 0;
+
+            virtual bool performance_report() const = 0;
+            virtual std::string microarchitecture() const = 0;
+
+            virtual utils::statistics * statistics() const = 0;
+            virtual utils::trace * trace() const = 0;
         };
     }
 }
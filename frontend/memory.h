@@ -0,0 +1,204 @@
+/**
+ * Reaver Project Assembler License
+ *
+ * Copyright © 2014 Michał "Griwes" Dominiak
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation is required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ **/
+
+#pragma once
+
+#include <sstream>
+
+#include <reaver/target.h>
+#include <reaver/error.h>
+
+#include "frontend.h"
+
+namespace reaver
+{
+    namespace assembler
+    {
+        class memory_frontend : public frontend
+        {
+        public:
+            memory_frontend(std::string source, ::reaver::target::triple target = std::string{ "x86_64-none-elf" },
+                std::string syntax = "intel", std::string format = "binary") : _input{ std::move(source) },
+                _syntax{ std::move(syntax) }, _format{ std::move(format) }, _target{ std::move(target) }
+            {
+            }
+
+            virtual ~memory_frontend() {}
+
+            virtual bool assemble_only() const override
+            {
+                return true;
+            }
+
+            virtual std::string syntax() const override
+            {
+                return _syntax;
+            }
+
+            virtual ::reaver::target::triple target() const override
+            {
+                return _target;
+            }
+
+            virtual std::string format() const override
+            {
+                return _format;
+            }
+
+            virtual std::istream & input() const override
+            {
+                return _input;
+            }
+
+            virtual std::ostream & output() const override
+            {
+                return _output;
+            }
+
+            virtual int output_descriptor() const override
+            {
+                return -1;
+            }
+
+            virtual bool parallel_output() const override
+            {
+                return false;
+            }
+
+            virtual bool pipeline() const override
+            {
+                return false;
+            }
+
+            virtual bool gc_sections() const override
+            {
+                return false;
+            }
+
+            virtual bool icf() const override
+            {
+                return false;
+            }
+
+            virtual std::string input_name() const override
+            {
+                return "<memory>";
+            }
+
+            virtual std::vector<file> & default_includes() const override
+            {
+                return _default_includes;
+            }
+
+            virtual const std::vector<std::string> & precompiled_includes() const override
+            {
+                return _precompiled_includes;
+            }
+
+            virtual bool precompile() const override
+            {
+                return false;
+            }
+
+            virtual file open_file(std::string) const override;
+
+            // in-memory files have no descriptor to copy from
+            virtual std::string locate_file(std::string) const override
+            {
+                return "";
+            }
+
+            virtual const std::map<std::string, std::shared_ptr<define>> & defines() const override
+            {
+                return _defines;
+            }
+
+            virtual logger::level warning_level() const override
+            {
+                return logger::warning;
+            }
+
+            virtual std::size_t error_limit() const override
+            {
+                return 0;
+            }
+
+            virtual bool debug_info() const override
+            {
+                return false;
+            }
+
+            virtual bool compress_debug_sections() const override
+            {
+                return false;
+            }
+
+            virtual bool performance_report() const override
+            {
+                return false;
+            }
+
+            virtual std::string microarchitecture() const override
+            {
+                return "skylake";
+            }
+
+            virtual utils::statistics * statistics() const override
+            {
+                return nullptr;
+            }
+
+            virtual utils::trace * trace() const override
+            {
+                return nullptr;
+            }
+
+            void add_file(std::string name, std::string contents)
+            {
+                _files[std::move(name)] = std::move(contents);
+            }
+
+            void add_precompiled_include(std::string path)
+            {
+                _precompiled_includes.push_back(std::move(path));
+            }
+
+            std::string output_buffer() const
+            {
+                return _output.str();
+            }
+
+        private:
+            mutable std::istringstream _input;
+            mutable std::ostringstream _output;
+
+            std::string _syntax;
+            std::string _format;
+            ::reaver::target::triple _target;
+
+            mutable std::vector<file> _default_includes;
+            std::vector<std::string> _precompiled_includes;
+            std::map<std::string, std::string> _files;
+            std::map<std::string, std::shared_ptr<define>> _defines;
+        };
+    }
+}
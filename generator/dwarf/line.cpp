@@ -0,0 +1,237 @@
+/**
+ * Reaver Project Assembler License
+ *
+ * Copyright © 2014 Michał "Griwes" Dominiak
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation is required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ **/
+
+#include "line.h"
+
+namespace
+{
+    enum : std::uint8_t
+    {
+        DW_LNS_copy = 0x01,
+        DW_LNS_advance_pc = 0x02,
+        DW_LNS_advance_line = 0x03,
+        DW_LNS_set_file = 0x04,
+        DW_LNS_negate_stmt = 0x06,
+
+        DW_LNE_end_sequence = 0x01,
+        DW_LNE_set_address = 0x02
+    };
+
+    constexpr std::int8_t _line_base = -5;
+    constexpr std::uint8_t _line_range = 14;
+    constexpr std::uint8_t _opcode_base = 13;
+    constexpr std::uint8_t _standard_opcode_lengths[] = { 0, 1, 1, 1, 1, 0, 0, 0, 1, 0, 0, 1 };
+
+    void _uleb128(std::vector<char> & out, std::uint64_t value)
+    {
+        do
+        {
+            std::uint8_t byte = value & 0x7f;
+            value >>= 7;
+            out.push_back(static_cast<char>(value ? byte | 0x80 : byte));
+        } while (value);
+    }
+
+    void _sleb128(std::vector<char> & out, std::int64_t value)
+    {
+        bool more = true;
+
+        while (more)
+        {
+            std::uint8_t byte = value & 0x7f;
+            value >>= 7;
+            more = !((value == 0 && !(byte & 0x40)) || (value == -1 && (byte & 0x40)));
+            out.push_back(static_cast<char>(more ? byte | 0x80 : byte));
+        }
+    }
+
+    void _fixed(std::vector<char> & out, std::uint64_t value, std::size_t size)
+    {
+        for (std::size_t i = 0; i < size; ++i)
+        {
+            out.push_back(static_cast<char>(value >> (i * 8)));
+        }
+    }
+
+    void _patch(std::vector<char> & out, std::size_t offset, std::uint64_t value, std::size_t size)
+    {
+        for (std::size_t i = 0; i < size; ++i)
+        {
+            out[offset + i] = static_cast<char>(value >> (i * 8));
+        }
+    }
+}
+
+std::uint64_t reaver::assembler::dwarf::line_program::_file(const std::string & name)
+{
+    auto it = _file_indices.find(name);
+
+    if (it == _file_indices.end())
+    {
+        _files.push_back(name);
+        it = _file_indices.emplace(name, _files.size()).first;
+    }
+
+    return it->second;
+}
+
+void reaver::assembler::dwarf::line_program::add(const std::string & section, std::uint64_t offset,
+    const utils::include_chain & chain)
+{
+    auto it = _sequence_indices.find(section);
+
+    if (it == _sequence_indices.end())
+    {
+        it = _sequence_indices.emplace(section, _sequences.size()).first;
+        _sequences.emplace_back();
+        _sequences.back().section = section;
+    }
+
+    auto & seq = _sequences[it->second];
+    auto file = _file(chain.file);
+    std::int64_t line = chain.line;
+    bool is_stmt = !chain.macro;
+
+    if (!seq.empty && file == seq.file && line == seq.line && is_stmt == seq.is_stmt)
+    {
+        return;
+    }
+
+    if (file != seq.file)
+    {
+        seq.program.push_back(DW_LNS_set_file);
+        _uleb128(seq.program, file);
+        seq.file = file;
+    }
+
+    if (is_stmt != seq.is_stmt)
+    {
+        seq.program.push_back(DW_LNS_negate_stmt);
+        seq.is_stmt = is_stmt;
+    }
+
+    auto line_delta = line - seq.line;
+    auto address_delta = offset - seq.address;
+
+    if (line_delta >= _line_base && line_delta < _line_base + _line_range)
+    {
+        auto opcode = (line_delta - _line_base) + _line_range * address_delta + _opcode_base;
+
+        if (opcode <= 255)
+        {
+            seq.program.push_back(static_cast<char>(opcode));
+            seq.address = offset;
+            seq.line = line;
+            seq.empty = false;
+            return;
+        }
+    }
+
+    if (line_delta)
+    {
+        seq.program.push_back(DW_LNS_advance_line);
+        _sleb128(seq.program, line_delta);
+    }
+
+    if (address_delta)
+    {
+        seq.program.push_back(DW_LNS_advance_pc);
+        _uleb128(seq.program, address_delta);
+    }
+
+    seq.program.push_back(DW_LNS_copy);
+    seq.address = offset;
+    seq.line = line;
+    seq.empty = false;
+}
+
+void reaver::assembler::dwarf::line_program::finish(object & obj) const
+{
+    if (_sequences.empty())
+    {
+        return;
+    }
+
+    std::vector<std::uint64_t> sizes;
+    for (const auto & seq : _sequences)
+    {
+        sizes.push_back(obj.get_section(seq.section).size());
+    }
+
+    auto & debug_line = obj.get_section(".debug_line");
+    auto & out = debug_line.blob;
+
+    _fixed(out, 0, 4);
+    _fixed(out, 4, 2);
+    _fixed(out, 0, 4);
+
+    auto header_start = out.size();
+
+    out.push_back(1);
+    out.push_back(1);
+    out.push_back(1);
+    out.push_back(static_cast<char>(_line_base));
+    out.push_back(static_cast<char>(_line_range));
+    out.push_back(static_cast<char>(_opcode_base));
+    out.insert(out.end(), std::begin(_standard_opcode_lengths), std::end(_standard_opcode_lengths));
+
+    out.push_back(0);
+
+    for (const auto & file : _files)
+    {
+        out.insert(out.end(), file.begin(), file.end());
+        out.push_back(0);
+        _uleb128(out, 0);
+        _uleb128(out, 0);
+        _uleb128(out, 0);
+    }
+
+    out.push_back(0);
+
+    _patch(out, 6, out.size() - header_start, 4);
+
+    for (std::size_t i = 0; i < _sequences.size(); ++i)
+    {
+        const auto & seq = _sequences[i];
+
+        out.push_back(0);
+        _uleb128(out, 1 + _address_size);
+        out.push_back(DW_LNE_set_address);
+        debug_line.relocations.push_back({ out.size(), seq.section, _address_size == 8 ? relocation_type::absolute64
+            : relocation_type::absolute32, 0 });
+        _fixed(out, 0, _address_size);
+
+        out.insert(out.end(), seq.program.begin(), seq.program.end());
+
+        if (sizes[i] > seq.address)
+        {
+            out.push_back(DW_LNS_advance_pc);
+            _uleb128(out, sizes[i] - seq.address);
+        }
+
+        out.push_back(0);
+        _uleb128(out, 1);
+        out.push_back(DW_LNE_end_sequence);
+    }
+
+    _patch(out, 0, out.size() - 4, 4);
+}
@@ -0,0 +1,73 @@
+/**
+ * Reaver Project Assembler License
+ *
+ * Copyright © 2014 Michał "Griwes" Dominiak
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation is required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ **/
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <map>
+
+#include "../object.h"
+#include "../../utils/include_chain.h"
+
+namespace reaver
+{
+    namespace assembler
+    {
+        namespace dwarf
+        {
+            class line_program
+            {
+            public:
+                line_program(std::uint8_t address_size) : _address_size{ address_size }
+                {
+                }
+
+                void add(const std::string & section, std::uint64_t offset, const utils::include_chain & chain);
+                void finish(object &) const;
+
+            private:
+                struct _sequence
+                {
+                    std::string section;
+                    std::vector<char> program;
+                    std::uint64_t address = 0;
+                    std::uint64_t file = 1;
+                    std::int64_t line = 1;
+                    bool is_stmt = true;
+                    bool empty = true;
+                };
+
+                std::uint64_t _file(const std::string &);
+
+                std::uint8_t _address_size;
+
+                std::vector<_sequence> _sequences;
+                std::map<std::string, std::size_t> _sequence_indices;
+
+                std::vector<std::string> _files;
+                std::map<std::string, std::uint64_t> _file_indices;
+            };
+        }
+    }
+}
@@ -26,10 +26,10 @@
 #include <map>
 
 #include <reaver/error.h>
-#include <reaver/format/executable.h>
 
 #include "../frontend/frontend.h"
 #include "../parser/ast.h"
+#include "object.h"
 
 namespace reaver
 {
@@ -44,7 +44,24 @@ namespace reaver
 
             virtual ~generator() {}
 
-            virtual std::unique_ptr<format::executable::executable> operator()(const ast &) const = 0;
+            // encodes statements as they are fed to it; only the object being built stays resident between batches
+            class session
+            {
+            public:
+                virtual ~session() {}
+
+                virtual void operator()(const ast &) = 0;
+                virtual std::unique_ptr<object> finish() = 0;
+            };
+
+            virtual std::unique_ptr<session> start() const = 0;
+
+            std::unique_ptr<object> operator()(const ast & tree) const
+            {
+                auto s = start();
+                (*s)(tree);
+                return s->finish();
+            }
         };
 
         std::unique_ptr<generator> create_generator(const frontend &, error_engine &);
@@ -0,0 +1,1232 @@
+/**
+ * Reaver Project Assembler License
+ *
+ * Copyright © 2014 Michał "Griwes" Dominiak
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation is required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ **/
+
+#pragma once
+
+#include <cstdint>
+#include <array>
+#include <string_view>
+#include <stdexcept>
+
+namespace reaver
+{
+    namespace assembler
+    {
+        namespace intel
+        {
+            enum class mode : std::uint8_t
+            {
+                bits16 = 16,
+                bits32 = 32,
+                bits64 = 64
+            };
+
+            enum class register_kind : std::uint8_t
+            {
+                general,
+                segment,
+                instruction_pointer
+            };
+
+            struct register_info
+            {
+                std::string_view name;
+                register_kind kind;
+                std::uint8_t code;
+                std::uint8_t size;
+                bool needs_rex;
+                bool high_byte;
+            };
+
+            inline constexpr register_info registers[] = {
+                { "al", register_kind::general, 0, 8, false, false },
+                { "cl", register_kind::general, 1, 8, false, false },
+                { "dl", register_kind::general, 2, 8, false, false },
+                { "bl", register_kind::general, 3, 8, false, false },
+                { "ah", register_kind::general, 4, 8, false, true },
+                { "ch", register_kind::general, 5, 8, false, true },
+                { "dh", register_kind::general, 6, 8, false, true },
+                { "bh", register_kind::general, 7, 8, false, true },
+                { "spl", register_kind::general, 4, 8, true, false },
+                { "bpl", register_kind::general, 5, 8, true, false },
+                { "sil", register_kind::general, 6, 8, true, false },
+                { "dil", register_kind::general, 7, 8, true, false },
+                { "r8b", register_kind::general, 8, 8, true, false },
+                { "r9b", register_kind::general, 9, 8, true, false },
+                { "r10b", register_kind::general, 10, 8, true, false },
+                { "r11b", register_kind::general, 11, 8, true, false },
+                { "r12b", register_kind::general, 12, 8, true, false },
+                { "r13b", register_kind::general, 13, 8, true, false },
+                { "r14b", register_kind::general, 14, 8, true, false },
+                { "r15b", register_kind::general, 15, 8, true, false },
+
+                { "ax", register_kind::general, 0, 16, false, false },
+                { "cx", register_kind::general, 1, 16, false, false },
+                { "dx", register_kind::general, 2, 16, false, false },
+                { "bx", register_kind::general, 3, 16, false, false },
+                { "sp", register_kind::general, 4, 16, false, false },
+                { "bp", register_kind::general, 5, 16, false, false },
+                { "si", register_kind::general, 6, 16, false, false },
+                { "di", register_kind::general, 7, 16, false, false },
+                { "r8w", register_kind::general, 8, 16, true, false },
+                { "r9w", register_kind::general, 9, 16, true, false },
+                { "r10w", register_kind::general, 10, 16, true, false },
+                { "r11w", register_kind::general, 11, 16, true, false },
+                { "r12w", register_kind::general, 12, 16, true, false },
+                { "r13w", register_kind::general, 13, 16, true, false },
+                { "r14w", register_kind::general, 14, 16, true, false },
+                { "r15w", register_kind::general, 15, 16, true, false },
+
+                { "eax", register_kind::general, 0, 32, false, false },
+                { "ecx", register_kind::general, 1, 32, false, false },
+                { "edx", register_kind::general, 2, 32, false, false },
+                { "ebx", register_kind::general, 3, 32, false, false },
+                { "esp", register_kind::general, 4, 32, false, false },
+                { "ebp", register_kind::general, 5, 32, false, false },
+                { "esi", register_kind::general, 6, 32, false, false },
+                { "edi", register_kind::general, 7, 32, false, false },
+                { "r8d", register_kind::general, 8, 32, true, false },
+                { "r9d", register_kind::general, 9, 32, true, false },
+                { "r10d", register_kind::general, 10, 32, true, false },
+                { "r11d", register_kind::general, 11, 32, true, false },
+                { "r12d", register_kind::general, 12, 32, true, false },
+                { "r13d", register_kind::general, 13, 32, true, false },
+                { "r14d", register_kind::general, 14, 32, true, false },
+                { "r15d", register_kind::general, 15, 32, true, false },
+
+                { "rax", register_kind::general, 0, 64, false, false },
+                { "rcx", register_kind::general, 1, 64, false, false },
+                { "rdx", register_kind::general, 2, 64, false, false },
+                { "rbx", register_kind::general, 3, 64, false, false },
+                { "rsp", register_kind::general, 4, 64, false, false },
+                { "rbp", register_kind::general, 5, 64, false, false },
+                { "rsi", register_kind::general, 6, 64, false, false },
+                { "rdi", register_kind::general, 7, 64, false, false },
+                { "r8", register_kind::general, 8, 64, false, false },
+                { "r9", register_kind::general, 9, 64, false, false },
+                { "r10", register_kind::general, 10, 64, false, false },
+                { "r11", register_kind::general, 11, 64, false, false },
+                { "r12", register_kind::general, 12, 64, false, false },
+                { "r13", register_kind::general, 13, 64, false, false },
+                { "r14", register_kind::general, 14, 64, false, false },
+                { "r15", register_kind::general, 15, 64, false, false },
+
+                { "es", register_kind::segment, 0, 16, false, false },
+                { "cs", register_kind::segment, 1, 16, false, false },
+                { "ss", register_kind::segment, 2, 16, false, false },
+                { "ds", register_kind::segment, 3, 16, false, false },
+                { "fs", register_kind::segment, 4, 16, false, false },
+                { "gs", register_kind::segment, 5, 16, false, false },
+
+                { "rip", register_kind::instruction_pointer, 5, 64, false, false }
+            };
+
+            constexpr bool _iequal(std::string_view lhs, std::string_view rhs)
+            {
+                if (lhs.size() != rhs.size())
+                {
+                    return false;
+                }
+
+                for (std::size_t i = 0; i < lhs.size(); ++i)
+                {
+                    char l = lhs[i] >= 'A' && lhs[i] <= 'Z' ? lhs[i] - 'A' + 'a' : lhs[i];
+                    char r = rhs[i] >= 'A' && rhs[i] <= 'Z' ? rhs[i] - 'A' + 'a' : rhs[i];
+
+                    if (l != r)
+                    {
+                        return false;
+                    }
+                }
+
+                return true;
+            }
+
+            constexpr const register_info * find_register(std::string_view name)
+            {
+                for (const auto & reg : registers)
+                {
+                    if (_iequal(reg.name, name))
+                    {
+                        return &reg;
+                    }
+                }
+
+                return nullptr;
+            }
+
+            enum class operand_kind : std::uint8_t
+            {
+                none,
+                reg,
+                memory,
+                immediate
+            };
+
+            struct memory_reference
+            {
+                const register_info * segment = nullptr;
+                const register_info * base = nullptr;
+                const register_info * index = nullptr;
+                std::uint8_t scale = 1;
+                std::int64_t displacement = 0;
+                std::uint8_t size = 0;
+            };
+
+            struct operand
+            {
+                operand_kind kind = operand_kind::none;
+                const register_info * reg = nullptr;
+                memory_reference memory = {};
+                std::int64_t value = 0;
+                bool symbolic = false;
+            };
+
+            constexpr operand reg(std::string_view name)
+            {
+                auto info = find_register(name);
+
+                if (!info)
+                {
+                    throw std::invalid_argument{ "unknown register" };
+                }
+
+                operand ret;
+                ret.kind = operand_kind::reg;
+                ret.reg = info;
+                return ret;
+            }
+
+            constexpr operand imm(std::int64_t value)
+            {
+                operand ret;
+                ret.kind = operand_kind::immediate;
+                ret.value = value;
+                return ret;
+            }
+
+            constexpr operand mem(std::string_view base, std::string_view index, std::uint8_t scale, std::int64_t displacement,
+                std::uint8_t size = 0)
+            {
+                operand ret;
+                ret.kind = operand_kind::memory;
+                ret.memory.base = base.empty() ? nullptr : reg(base).reg;
+                ret.memory.index = index.empty() ? nullptr : reg(index).reg;
+                ret.memory.scale = scale;
+                ret.memory.displacement = displacement;
+                ret.memory.size = size;
+                return ret;
+            }
+
+            constexpr operand mem(std::string_view base, std::int64_t displacement = 0, std::uint8_t size = 0)
+            {
+                return mem(base, "", 1, displacement, size);
+            }
+
+            enum class operand_type : std::uint8_t
+            {
+                none,
+                r8,
+                rv,
+                rm8,
+                rmv,
+                rm16,
+                m,
+                sreg,
+                imm8,
+                simm8,
+                immv,
+                immq,
+                rel8,
+                rel32
+            };
+
+            enum : std::int8_t
+            {
+                no_modrm = -2,
+                modrm_reg = -1
+            };
+
+            struct form
+            {
+                std::string_view mnemonic;
+                std::array<operand_type, 2> operands;
+                std::array<std::uint8_t, 3> opcode;
+                std::uint8_t opcode_size;
+                std::int8_t extension;
+                bool register_in_opcode;
+                bool default_64;
+            };
+
+            constexpr form _form(std::string_view mnemonic, operand_type first, operand_type second,
+                std::initializer_list<std::uint8_t> opcode, std::int8_t extension, bool plus_register = false,
+                bool default_64 = false)
+            {
+                form ret{ mnemonic, { first, second }, {}, 0, extension, plus_register, default_64 };
+
+                for (auto byte : opcode)
+                {
+                    ret.opcode[ret.opcode_size++] = byte;
+                }
+
+                return ret;
+            }
+
+            constexpr form _arithmetic(std::string_view mnemonic, std::uint8_t base, operand_type first,
+                operand_type second)
+            {
+                using ot = operand_type;
+
+                if (first == ot::rm8 && second == ot::r8)
+                {
+                    return _form(mnemonic, first, second, { base }, modrm_reg);
+                }
+
+                if (first == ot::rmv && second == ot::rv)
+                {
+                    return _form(mnemonic, first, second, { std::uint8_t(base + 1) }, modrm_reg);
+                }
+
+                if (first == ot::r8 && second == ot::rm8)
+                {
+                    return _form(mnemonic, first, second, { std::uint8_t(base + 2) }, modrm_reg);
+                }
+
+                if (first == ot::rv && second == ot::rmv)
+                {
+                    return _form(mnemonic, first, second, { std::uint8_t(base + 3) }, modrm_reg);
+                }
+
+                if (first == ot::rm8)
+                {
+                    return _form(mnemonic, first, second, { 0x80 }, base / 8);
+                }
+
+                if (second == ot::simm8)
+                {
+                    return _form(mnemonic, first, second, { 0x83 }, base / 8);
+                }
+
+                return _form(mnemonic, first, second, { 0x81 }, base / 8);
+            }
+
+            using ot = operand_type;
+
+#           define REAVER_ASSEMBLER_ARITHMETIC(name, base) \
+                _arithmetic(name, base, ot::rm8, ot::r8), \
+                _arithmetic(name, base, ot::rmv, ot::rv), \
+                _arithmetic(name, base, ot::r8, ot::rm8), \
+                _arithmetic(name, base, ot::rv, ot::rmv), \
+                _arithmetic(name, base, ot::rm8, ot::imm8), \
+                _arithmetic(name, base, ot::rmv, ot::simm8), \
+                _arithmetic(name, base, ot::rmv, ot::immv)
+
+            inline constexpr form forms[] = {
+                REAVER_ASSEMBLER_ARITHMETIC("add", 0x00),
+                REAVER_ASSEMBLER_ARITHMETIC("or", 0x08),
+                REAVER_ASSEMBLER_ARITHMETIC("adc", 0x10),
+                REAVER_ASSEMBLER_ARITHMETIC("sbb", 0x18),
+                REAVER_ASSEMBLER_ARITHMETIC("and", 0x20),
+                REAVER_ASSEMBLER_ARITHMETIC("sub", 0x28),
+                REAVER_ASSEMBLER_ARITHMETIC("xor", 0x30),
+                REAVER_ASSEMBLER_ARITHMETIC("cmp", 0x38),
+
+                _form("mov", ot::rm8, ot::r8, { 0x88 }, modrm_reg),
+                _form("mov", ot::rmv, ot::rv, { 0x89 }, modrm_reg),
+                _form("mov", ot::r8, ot::rm8, { 0x8a }, modrm_reg),
+                _form("mov", ot::rv, ot::rmv, { 0x8b }, modrm_reg),
+                _form("mov", ot::rm16, ot::sreg, { 0x8c }, modrm_reg),
+                _form("mov", ot::sreg, ot::rm16, { 0x8e }, modrm_reg),
+                _form("mov", ot::r8, ot::imm8, { 0xb0 }, no_modrm, true),
+                _form("mov", ot::rv, ot::immq, { 0xb8 }, no_modrm, true),
+                _form("mov", ot::rm8, ot::imm8, { 0xc6 }, 0),
+                _form("mov", ot::rmv, ot::immv, { 0xc7 }, 0),
+
+                _form("test", ot::rm8, ot::r8, { 0x84 }, modrm_reg),
+                _form("test", ot::rmv, ot::rv, { 0x85 }, modrm_reg),
+                _form("test", ot::rm8, ot::imm8, { 0xf6 }, 0),
+                _form("test", ot::rmv, ot::immv, { 0xf7 }, 0),
+
+                _form("lea", ot::rv, ot::m, { 0x8d }, modrm_reg),
+
+                _form("not", ot::rm8, ot::none, { 0xf6 }, 2),
+                _form("not", ot::rmv, ot::none, { 0xf7 }, 2),
+                _form("neg", ot::rm8, ot::none, { 0xf6 }, 3),
+                _form("neg", ot::rmv, ot::none, { 0xf7 }, 3),
+                _form("mul", ot::rm8, ot::none, { 0xf6 }, 4),
+                _form("mul", ot::rmv, ot::none, { 0xf7 }, 4),
+                _form("imul", ot::rm8, ot::none, { 0xf6 }, 5),
+                _form("imul", ot::rmv, ot::none, { 0xf7 }, 5),
+                _form("imul", ot::rv, ot::rmv, { 0x0f, 0xaf }, modrm_reg),
+                _form("div", ot::rm8, ot::none, { 0xf6 }, 6),
+                _form("div", ot::rmv, ot::none, { 0xf7 }, 6),
+                _form("idiv", ot::rm8, ot::none, { 0xf6 }, 7),
+                _form("idiv", ot::rmv, ot::none, { 0xf7 }, 7),
+                _form("inc", ot::rm8, ot::none, { 0xfe }, 0),
+                _form("inc", ot::rmv, ot::none, { 0xff }, 0),
+                _form("dec", ot::rm8, ot::none, { 0xfe }, 1),
+                _form("dec", ot::rmv, ot::none, { 0xff }, 1),
+
+                _form("push", ot::rv, ot::none, { 0x50 }, no_modrm, true, true),
+                _form("push", ot::simm8, ot::none, { 0x6a }, no_modrm, false, true),
+                _form("push", ot::immv, ot::none, { 0x68 }, no_modrm, false, true),
+                _form("push", ot::rmv, ot::none, { 0xff }, 6, false, true),
+                _form("pop", ot::rv, ot::none, { 0x58 }, no_modrm, true, true),
+                _form("pop", ot::rmv, ot::none, { 0x8f }, 0, false, true),
+
+                _form("call", ot::rel32, ot::none, { 0xe8 }, no_modrm, false, true),
+                _form("call", ot::rmv, ot::none, { 0xff }, 2, false, true),
+                _form("jmp", ot::rel8, ot::none, { 0xeb }, no_modrm, false, true),
+                _form("jmp", ot::rel32, ot::none, { 0xe9 }, no_modrm, false, true),
+                _form("jmp", ot::rmv, ot::none, { 0xff }, 4, false, true),
+
+#           define REAVER_ASSEMBLER_JCC(name, code) \
+                _form(name, ot::rel8, ot::none, { 0x70 + code }, no_modrm, false, true), \
+                _form(name, ot::rel32, ot::none, { 0x0f, 0x80 + code }, no_modrm, false, true)
+
+                REAVER_ASSEMBLER_JCC("jo", 0x0), REAVER_ASSEMBLER_JCC("jno", 0x1),
+                REAVER_ASSEMBLER_JCC("jb", 0x2), REAVER_ASSEMBLER_JCC("jae", 0x3),
+                REAVER_ASSEMBLER_JCC("je", 0x4), REAVER_ASSEMBLER_JCC("jne", 0x5),
+                REAVER_ASSEMBLER_JCC("jbe", 0x6), REAVER_ASSEMBLER_JCC("ja", 0x7),
+                REAVER_ASSEMBLER_JCC("js", 0x8), REAVER_ASSEMBLER_JCC("jns", 0x9),
+                REAVER_ASSEMBLER_JCC("jp", 0xa), REAVER_ASSEMBLER_JCC("jnp", 0xb),
+                REAVER_ASSEMBLER_JCC("jl", 0xc), REAVER_ASSEMBLER_JCC("jge", 0xd),
+                REAVER_ASSEMBLER_JCC("jle", 0xe), REAVER_ASSEMBLER_JCC("jg", 0xf),
+                REAVER_ASSEMBLER_JCC("jz", 0x4), REAVER_ASSEMBLER_JCC("jnz", 0x5),
+
+#           undef REAVER_ASSEMBLER_JCC
+
+                _form("int", ot::imm8, ot::none, { 0xcd }, no_modrm),
+                _form("int3", ot::none, ot::none, { 0xcc }, no_modrm),
+                _form("ret", ot::none, ot::none, { 0xc3 }, no_modrm, false, true),
+                _form("nop", ot::none, ot::none, { 0x90 }, no_modrm),
+                _form("hlt", ot::none, ot::none, { 0xf4 }, no_modrm),
+                _form("cli", ot::none, ot::none, { 0xfa }, no_modrm),
+                _form("sti", ot::none, ot::none, { 0xfb }, no_modrm),
+                _form("syscall", ot::none, ot::none, { 0x0f, 0x05 }, no_modrm)
+            };
+
+#           undef REAVER_ASSEMBLER_ARITHMETIC
+
+            enum class encoding_error : std::uint8_t
+            {
+                none,
+                unknown_mnemonic,
+                invalid_operands,
+                ambiguous_size,
+                invalid_address,
+                invalid_in_mode,
+                rex_conflict
+            };
+
+            struct fixup
+            {
+                std::uint8_t operand = 0;
+                std::uint8_t offset = 0;
+                std::uint8_t size = 0;
+                bool relative = false;
+                // the cpu sign extends the field to 64 bits, so the value has to fit a signed field
+                bool sign_extended = false;
+                std::int64_t addend = 0;
+            };
+
+            struct encoded
+            {
+                std::array<std::uint8_t, 15> bytes = {};
+                std::uint8_t size = 0;
+                encoding_error error = encoding_error::none;
+
+                std::array<fixup, 2> fixups = {};
+                std::uint8_t fixup_count = 0;
+
+                const form * matched = nullptr;
+
+                constexpr void push(std::uint8_t byte)
+                {
+                    if (size == bytes.size())
+                    {
+                        error = encoding_error::invalid_operands;
+                        return;
+                    }
+
+                    bytes[size++] = byte;
+                }
+
+                constexpr void push(std::int64_t value, std::uint8_t width)
+                {
+                    for (std::uint8_t i = 0; i < width; ++i)
+                    {
+                        push(static_cast<std::uint8_t>(static_cast<std::uint64_t>(value) >> (i * 8)));
+                    }
+                }
+            };
+
+            struct instruction
+            {
+                constexpr instruction(std::string_view m, operand first = {}, operand second = {}) : mnemonic{ m },
+                    operands{ first, second }, count{ static_cast<std::uint8_t>((first.kind != operand_kind::none)
+                        + (second.kind != operand_kind::none)) }
+                {
+                }
+
+                std::string_view mnemonic;
+                std::array<operand, 2> operands;
+                std::uint8_t count;
+            };
+
+            constexpr bool _fits(std::int64_t value, std::uint8_t bits, bool allow_unsigned = true)
+            {
+                if (bits >= 64)
+                {
+                    return true;
+                }
+
+                std::int64_t min = -(std::int64_t{ 1 } << (bits - 1));
+                std::int64_t max = allow_unsigned ? (std::int64_t{ 1 } << bits) - 1 : (std::int64_t{ 1 } << (bits - 1)) - 1;
+
+                return value >= min && value <= max;
+            }
+
+            // the sizes an operand and an address get without a prefix; every mode dependent decision in the encoder is made
+            // with these and `if constexpr`, once per instantiation instead of once per operand
+            template<mode M>
+            constexpr std::uint8_t _default_operand_size = M == mode::bits16 ? 16 : 32;
+
+            template<mode M>
+            constexpr std::uint8_t _default_address_size = static_cast<std::uint8_t>(M);
+
+            constexpr bool _is_v(operand_type type)
+            {
+                return type == ot::rv || type == ot::rmv || type == ot::immv || type == ot::immq;
+            }
+
+            template<mode M>
+            constexpr bool _match(operand_type type, const operand & op, std::uint8_t size)
+            {
+                switch (type)
+                {
+                    case ot::none:
+                        return op.kind == operand_kind::none;
+
+                    case ot::r8:
+                        return op.kind == operand_kind::reg && op.reg->kind == register_kind::general && op.reg->size == 8;
+
+                    case ot::rv:
+                        return op.kind == operand_kind::reg && op.reg->kind == register_kind::general && op.reg->size == size;
+
+                    case ot::rm8:
+                        return _match<M>(ot::r8, op, size) || (op.kind == operand_kind::memory
+                            && (op.memory.size == 8 || op.memory.size == 0));
+
+                    case ot::rmv:
+                        return _match<M>(ot::rv, op, size) || (op.kind == operand_kind::memory
+                            && (op.memory.size == size || op.memory.size == 0));
+
+                    case ot::rm16:
+                        return (op.kind == operand_kind::reg && op.reg->kind == register_kind::general && op.reg->size >= 16)
+                            || (op.kind == operand_kind::memory && (op.memory.size == 16 || op.memory.size == 0));
+
+                    case ot::m:
+                        return op.kind == operand_kind::memory;
+
+                    case ot::sreg:
+                        return op.kind == operand_kind::reg && op.reg->kind == register_kind::segment;
+
+                    case ot::imm8:
+                        return op.kind == operand_kind::immediate && !op.symbolic && _fits(op.value, 8);
+
+                    case ot::simm8:
+                        return op.kind == operand_kind::immediate && !op.symbolic && _fits(op.value, 8, false);
+
+                    case ot::immv:
+                        return op.kind == operand_kind::immediate && _fits(op.value, size == 16 ? 16 : 32, size != 64);
+
+                    case ot::immq:
+                        return op.kind == operand_kind::immediate && (size == 64 || _fits(op.value, size));
+
+                    case ot::rel8:
+                        return op.kind == operand_kind::immediate && !op.symbolic && _fits(op.value, 8, false);
+
+                    case ot::rel32:
+                        return op.kind == operand_kind::immediate && (op.symbolic || _fits(op.value,
+                            _default_operand_size<M>, false));
+                }
+
+                return false;
+            }
+
+            template<mode M>
+            constexpr std::uint8_t _operand_size(const form & f, const instruction & instr)
+            {
+                std::uint8_t size = 0;
+
+                for (std::size_t i = 0; i < 2; ++i)
+                {
+                    const auto & op = instr.operands[i];
+
+                    if (!_is_v(f.operands[i]))
+                    {
+                        continue;
+                    }
+
+                    if (op.kind == operand_kind::reg)
+                    {
+                        size = op.reg->size;
+                    }
+
+                    else if (op.kind == operand_kind::memory && op.memory.size)
+                    {
+                        size = op.memory.size;
+                    }
+                }
+
+                if (!size && f.default_64)
+                {
+                    size = static_cast<std::uint8_t>(M);
+                }
+
+                return size;
+            }
+
+            constexpr std::uint8_t _segment_prefix(const register_info * segment)
+            {
+                constexpr std::uint8_t prefixes[] = { 0x26, 0x2e, 0x36, 0x3e, 0x64, 0x65 };
+                return prefixes[segment->code];
+            }
+
+            template<mode M>
+            constexpr std::uint8_t _address_size(const memory_reference & memory)
+            {
+                if (memory.base && memory.base->kind == register_kind::instruction_pointer)
+                {
+                    return 64;
+                }
+
+                if (memory.base)
+                {
+                    return memory.base->size;
+                }
+
+                if (memory.index)
+                {
+                    return memory.index->size;
+                }
+
+                return _default_address_size<M>;
+            }
+
+            struct _modrm_state
+            {
+                std::uint8_t rex = 0;
+                bool rex_required = false;
+                bool rex_forbidden = false;
+            };
+
+            constexpr void _track_register(_modrm_state & state, const register_info * reg)
+            {
+                if (reg && reg->needs_rex)
+                {
+                    state.rex_required = true;
+                }
+
+                if (reg && reg->high_byte)
+                {
+                    state.rex_forbidden = true;
+                }
+            }
+
+            template<mode M>
+            constexpr void _emit_modrm(encoded & ret, std::uint8_t reg, const operand & rm, std::uint8_t index)
+            {
+                if (rm.kind == operand_kind::reg)
+                {
+                    ret.push(static_cast<std::uint8_t>(0xc0 | ((reg & 7) << 3) | (rm.reg->code & 7)));
+                    return;
+                }
+
+                const auto & memory = rm.memory;
+                auto address_size = _address_size<M>(memory);
+                bool symbolic = rm.symbolic;
+
+                auto displacement = [&](std::uint8_t width, bool relative)
+                {
+                    if (symbolic)
+                    {
+                        auto & fix = ret.fixups[ret.fixup_count++];
+                        fix.operand = index;
+                        fix.offset = ret.size;
+                        fix.size = width;
+                        fix.relative = relative;
+                        fix.sign_extended = !relative && width == 4 && address_size == 64;
+                        fix.addend = memory.displacement;
+                        ret.push(std::int64_t{ 0 }, width);
+                        return;
+                    }
+
+                    ret.push(memory.displacement, width);
+                };
+
+                if (address_size == 16)
+                {
+                    const register_info * base = memory.base;
+                    const register_info * index = memory.index;
+
+                    if (memory.scale != 1)
+                    {
+                        ret.error = encoding_error::invalid_address;
+                        return;
+                    }
+
+                    if (base && (base->code == 6 || base->code == 7) && index)
+                    {
+                        auto tmp = base;
+                        base = index;
+                        index = tmp;
+                    }
+
+                    std::int8_t rm_bits = -1;
+
+                    if (!base && !index)
+                    {
+                        ret.push(static_cast<std::uint8_t>(((reg & 7) << 3) | 6));
+                        displacement(2, false);
+                        return;
+                    }
+
+                    if (base && index)
+                    {
+                        if (base->code == 3 && index->code == 6) rm_bits = 0;
+                        else if (base->code == 3 && index->code == 7) rm_bits = 1;
+                        else if (base->code == 5 && index->code == 6) rm_bits = 2;
+                        else if (base->code == 5 && index->code == 7) rm_bits = 3;
+                    }
+
+                    else
+                    {
+                        auto single = base ? base : index;
+
+                        if (single->code == 6) rm_bits = 4;
+                        else if (single->code == 7) rm_bits = 5;
+                        else if (single->code == 5) rm_bits = 6;
+                        else if (single->code == 3) rm_bits = 7;
+                    }
+
+                    if (rm_bits < 0)
+                    {
+                        ret.error = encoding_error::invalid_address;
+                        return;
+                    }
+
+                    if (!symbolic && memory.displacement == 0 && rm_bits != 6)
+                    {
+                        ret.push(static_cast<std::uint8_t>(((reg & 7) << 3) | rm_bits));
+                    }
+
+                    else if (!symbolic && _fits(memory.displacement, 8, false))
+                    {
+                        ret.push(static_cast<std::uint8_t>(0x40 | ((reg & 7) << 3) | rm_bits));
+                        displacement(1, false);
+                    }
+
+                    else
+                    {
+                        ret.push(static_cast<std::uint8_t>(0x80 | ((reg & 7) << 3) | rm_bits));
+                        displacement(2, false);
+                    }
+
+                    return;
+                }
+
+                if (memory.base && memory.base->kind == register_kind::instruction_pointer)
+                {
+                    if (M != mode::bits64 || memory.index)
+                    {
+                        ret.error = encoding_error::invalid_address;
+                        return;
+                    }
+
+                    ret.push(static_cast<std::uint8_t>(((reg & 7) << 3) | 5));
+                    displacement(4, true);
+                    return;
+                }
+
+                std::uint8_t scale_bits = 0;
+                switch (memory.scale)
+                {
+                    case 1: scale_bits = 0; break;
+                    case 2: scale_bits = 1; break;
+                    case 4: scale_bits = 2; break;
+                    case 8: scale_bits = 3; break;
+                    default:
+                        ret.error = encoding_error::invalid_address;
+                        return;
+                }
+
+                if (memory.index && (memory.index->code == 4))
+                {
+                    ret.error = encoding_error::invalid_address;
+                    return;
+                }
+
+                if (!memory.base)
+                {
+                    if (memory.index)
+                    {
+                        ret.push(static_cast<std::uint8_t>(((reg & 7) << 3) | 4));
+                        ret.push(static_cast<std::uint8_t>((scale_bits << 6) | ((memory.index->code & 7) << 3) | 5));
+                    }
+
+                    else if (M == mode::bits64)
+                    {
+                        ret.push(static_cast<std::uint8_t>(((reg & 7) << 3) | 4));
+                        ret.push(static_cast<std::uint8_t>(0x25));
+                    }
+
+                    else
+                    {
+                        ret.push(static_cast<std::uint8_t>(((reg & 7) << 3) | 5));
+                    }
+
+                    displacement(4, false);
+                    return;
+                }
+
+                std::uint8_t mod = 0x80;
+                if (!symbolic && memory.displacement == 0 && (memory.base->code & 7) != 5)
+                {
+                    mod = 0;
+                }
+
+                else if (!symbolic && _fits(memory.displacement, 8, false))
+                {
+                    mod = 0x40;
+                }
+
+                if (memory.index || (memory.base->code & 7) == 4)
+                {
+                    ret.push(static_cast<std::uint8_t>(mod | ((reg & 7) << 3) | 4));
+                    ret.push(static_cast<std::uint8_t>((scale_bits << 6) | ((memory.index ? memory.index->code & 7 : 4) << 3)
+                        | (memory.base->code & 7)));
+                }
+
+                else
+                {
+                    ret.push(static_cast<std::uint8_t>(mod | ((reg & 7) << 3) | (memory.base->code & 7)));
+                }
+
+                if (mod == 0x40)
+                {
+                    displacement(1, false);
+                }
+
+                else if (mod == 0x80)
+                {
+                    displacement(4, false);
+                }
+            }
+
+            template<mode M>
+            constexpr encoded _encode(const form & f, const instruction & instr)
+            {
+                encoded ret;
+                ret.matched = &f;
+
+                auto size = _operand_size<M>(f, instr);
+                bool has_v = _is_v(f.operands[0]) || _is_v(f.operands[1]);
+
+                for (std::size_t i = 0; i < 2; ++i)
+                {
+                    if (!_match<M>(f.operands[i], instr.operands[i], size))
+                    {
+                        ret.error = encoding_error::invalid_operands;
+                        return ret;
+                    }
+                }
+
+                if (has_v && !size)
+                {
+                    ret.error = encoding_error::ambiguous_size;
+                    return ret;
+                }
+
+                bool sized = false;
+                bool unsized_memory = false;
+
+                for (std::size_t i = 0; i < 2; ++i)
+                {
+                    auto type = f.operands[i];
+                    const auto & op = instr.operands[i];
+
+                    sized = sized || type == ot::r8 || type == ot::rv || type == ot::sreg || (op.kind == operand_kind::reg
+                        && (type == ot::rm8 || type == ot::rm16));
+                    unsized_memory = unsized_memory || ((type == ot::rm8 || type == ot::rm16) && op.kind == operand_kind::memory
+                        && !op.memory.size);
+                }
+
+                if (unsized_memory && !sized)
+                {
+                    ret.error = encoding_error::ambiguous_size;
+                    return ret;
+                }
+
+                if ((size == 64 && M != mode::bits64) || (f.default_64 && M == mode::bits64 && size == 32))
+                {
+                    ret.error = encoding_error::invalid_in_mode;
+                    return ret;
+                }
+
+                const operand * reg_operand = nullptr;
+                const operand * rm_operand = nullptr;
+                const operand * imm_operand = nullptr;
+                operand_type imm_type = ot::none;
+                std::uint8_t rm_index = 0;
+                std::uint8_t imm_index = 0;
+
+                for (std::size_t i = 0; i < 2; ++i)
+                {
+                    switch (f.operands[i])
+                    {
+                        case ot::r8:
+                        case ot::rv:
+                        case ot::sreg:
+                            if (f.register_in_opcode || f.extension != modrm_reg)
+                            {
+                                rm_operand = &instr.operands[i];
+                                rm_index = i;
+                            }
+
+                            else
+                            {
+                                reg_operand = &instr.operands[i];
+                            }
+                            break;
+
+                        case ot::rm8:
+                        case ot::rmv:
+                        case ot::rm16:
+                        case ot::m:
+                            rm_operand = &instr.operands[i];
+                            rm_index = i;
+                            break;
+
+                        case ot::none:
+                            break;
+
+                        default:
+                            imm_operand = &instr.operands[i];
+                            imm_type = f.operands[i];
+                            imm_index = i;
+                            break;
+                    }
+                }
+
+                _modrm_state state;
+
+                if (rm_operand && rm_operand->kind == operand_kind::memory)
+                {
+                    const auto & memory = rm_operand->memory;
+
+                    if (memory.segment)
+                    {
+                        ret.push(_segment_prefix(memory.segment));
+                    }
+
+                    auto address_size = _address_size<M>(memory);
+
+                    if ((address_size == 64 && M != mode::bits64) || (address_size == 16 && M == mode::bits64)
+                        || (memory.base && memory.index && memory.base->kind == register_kind::general
+                            && memory.base->size != memory.index->size))
+                    {
+                        ret.error = encoding_error::invalid_address;
+                        return ret;
+                    }
+
+                    if (address_size != _default_address_size<M>)
+                    {
+                        ret.push(std::uint8_t{ 0x67 });
+                    }
+
+                    if (memory.base && memory.base->kind == register_kind::general && memory.base->code >= 8)
+                    {
+                        state.rex |= 0x1;
+                    }
+
+                    if (memory.index && memory.index->code >= 8)
+                    {
+                        state.rex |= 0x2;
+                    }
+                }
+
+                else if (rm_operand && rm_operand->kind == operand_kind::reg)
+                {
+                    _track_register(state, rm_operand->reg);
+
+                    if (rm_operand->reg->code >= 8)
+                    {
+                        state.rex |= 0x1;
+                    }
+                }
+
+                if (reg_operand)
+                {
+                    _track_register(state, reg_operand->reg);
+
+                    if (reg_operand->reg->code >= 8)
+                    {
+                        state.rex |= 0x4;
+                    }
+                }
+
+                if (has_v && (size == 16 || size == 32) && size != _default_operand_size<M>)
+                {
+                    ret.push(std::uint8_t{ 0x66 });
+                }
+
+                if (size == 64 && has_v && !f.default_64)
+                {
+                    state.rex |= 0x8;
+                }
+
+                // storing a segment register into a general register writes as many bits as the register has, so the
+                // prefixes follow that register
+                if (f.operands[0] == ot::rm16 && instr.operands[0].kind == operand_kind::reg)
+                {
+                    auto bits = instr.operands[0].reg->size;
+
+                    if ((bits == 16 || bits == 32) && bits != _default_operand_size<M>)
+                    {
+                        ret.push(std::uint8_t{ 0x66 });
+                    }
+
+                    if (bits == 64)
+                    {
+                        state.rex |= 0x8;
+                    }
+                }
+
+                if (state.rex || state.rex_required)
+                {
+                    if constexpr (M != mode::bits64)
+                    {
+                        ret.error = encoding_error::invalid_in_mode;
+                        return ret;
+                    }
+
+                    if (state.rex_forbidden)
+                    {
+                        ret.error = encoding_error::rex_conflict;
+                        return ret;
+                    }
+
+                    ret.push(static_cast<std::uint8_t>(0x40 | state.rex));
+                }
+
+                for (std::uint8_t i = 0; i < f.opcode_size; ++i)
+                {
+                    auto byte = f.opcode[i];
+
+                    if (f.register_in_opcode && i + 1 == f.opcode_size)
+                    {
+                        byte += rm_operand->reg->code & 7;
+                    }
+
+                    ret.push(byte);
+                }
+
+                if (f.extension != no_modrm)
+                {
+                    std::uint8_t reg_field = f.extension >= 0 ? f.extension : reg_operand->reg->code;
+                    _emit_modrm<M>(ret, reg_field, *rm_operand, rm_index);
+                }
+
+                if (imm_operand)
+                {
+                    std::uint8_t width = 0;
+                    bool relative = false;
+
+                    switch (imm_type)
+                    {
+                        case ot::imm8:
+                        case ot::simm8:
+                            width = 1;
+                            break;
+
+                        case ot::immv:
+                            width = size == 16 ? 2 : 4;
+                            break;
+
+                        case ot::immq:
+                            width = size / 8;
+                            break;
+
+                        case ot::rel8:
+                            width = 1;
+                            relative = true;
+                            break;
+
+                        case ot::rel32:
+                            width = _default_operand_size<M> / 8;
+                            relative = true;
+                            break;
+
+                        default:
+                            break;
+                    }
+
+                    if (imm_operand->symbolic)
+                    {
+                        auto & fix = ret.fixups[ret.fixup_count++];
+                        fix.operand = imm_index;
+                        fix.offset = ret.size;
+                        fix.size = width;
+                        fix.relative = relative;
+                        fix.sign_extended = imm_type == ot::immv && size == 64;
+                        fix.addend = imm_operand->value;
+                        ret.push(std::int64_t{ 0 }, width);
+                    }
+
+                    else
+                    {
+                        ret.push(imm_operand->value, width);
+                    }
+                }
+
+                for (std::uint8_t i = 0; i < ret.fixup_count; ++i)
+                {
+                    if (ret.fixups[i].relative)
+                    {
+                        ret.fixups[i].addend -= ret.size - ret.fixups[i].offset;
+                    }
+                }
+
+                return ret;
+            }
+
+            template<mode M>
+            constexpr encoded encode(const instruction & instr)
+            {
+                encoded best;
+                best.error = encoding_error::unknown_mnemonic;
+
+                for (const auto & f : forms)
+                {
+                    if (!_iequal(f.mnemonic, instr.mnemonic))
+                    {
+                        continue;
+                    }
+
+                    if (best.error == encoding_error::unknown_mnemonic)
+                    {
+                        best.error = encoding_error::invalid_operands;
+                    }
+
+                    auto candidate = _encode<M>(f, instr);
+
+                    if (candidate.error == encoding_error::none)
+                    {
+                        if (best.error != encoding_error::none || candidate.size < best.size)
+                        {
+                            best = candidate;
+                        }
+                    }
+
+                    else if (best.error == encoding_error::invalid_operands)
+                    {
+                        best.error = candidate.error;
+                    }
+                }
+
+                return best;
+            }
+
+            using encoder = encoded (*)(const instruction &);
+
+            // picks the specialization once, when the mode changes, rather than on every instruction
+            constexpr encoder encoder_for(mode m)
+            {
+                switch (m)
+                {
+                    case mode::bits16:
+                        return &encode<mode::bits16>;
+
+                    case mode::bits32:
+                        return &encode<mode::bits32>;
+
+                    case mode::bits64:
+                        break;
+                }
+
+                return &encode<mode::bits64>;
+            }
+
+            constexpr encoded encode(const instruction & instr, mode m)
+            {
+                return encoder_for(m)(instr);
+            }
+
+            template<mode Mode, typename Instructions>
+            constexpr std::size_t _length(const Instructions & instructions)
+            {
+                std::size_t length = 0;
+
+                for (const auto & instr : instructions)
+                {
+                    auto enc = encode<Mode>(instr);
+
+                    if (enc.error != encoding_error::none)
+                    {
+                        throw std::invalid_argument{ "instruction cannot be encoded" };
+                    }
+
+                    if (enc.fixup_count)
+                    {
+                        throw std::invalid_argument{ "instruction requires a relocation" };
+                    }
+
+                    length += enc.size;
+                }
+
+                return length;
+            }
+
+            template<mode Mode = mode::bits64, typename Function>
+            constexpr auto assemble(Function function)
+            {
+                constexpr auto instructions = function();
+                std::array<std::uint8_t, _length<Mode>(instructions)> ret = {};
+
+                std::size_t offset = 0;
+                for (const auto & instr : instructions)
+                {
+                    auto enc = encode<Mode>(instr);
+
+                    for (std::uint8_t i = 0; i < enc.size; ++i)
+                    {
+                        ret[offset++] = enc.bytes[i];
+                    }
+                }
+
+                return ret;
+            }
+        }
+    }
+}
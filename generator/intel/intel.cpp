@@ -20,12 +20,674 @@
  *
  **/
 
+#include <iostream>
+#include <limits>
+#include <cstring>
+
+#include <sys/stat.h>
+
+#include <boost/variant/get.hpp>
+#include <boost/variant/apply_visitor.hpp>
+
 #include <reaver/exception.h>
 
 #include "../intel/intel.h"
 
-std::unique_ptr<reaver::format::executable::executable> reaver::assembler::intel_generator::operator()(const ast &) const
+namespace
+{
+    boost::optional<boost::multiprecision::cpp_int> _evaluate(const reaver::assembler::integer & value)
+    {
+        using namespace reaver::assembler;
+
+        if (auto literal = boost::get<integer_literal>(&value))
+        {
+            return literal->value;
+        }
+
+        if (auto constant = boost::get<reaver::assembler::constant>(&value))
+        {
+            return constant->value;
+        }
+
+        const auto & expression = boost::get<integer_expression>(value);
+
+        auto first = _evaluate(expression.first_operand.get());
+        auto second = _evaluate(expression.second_operand.get());
+
+        if (!first || !second)
+        {
+            return boost::none;
+        }
+
+        const auto & op = expression.op;
+        boost::multiprecision::cpp_int ret;
+
+        if (op == "+") ret = *first + *second;
+        else if (op == "-") ret = *first - *second;
+        else if (op == "*") ret = *first * *second;
+        else if (op == "&") ret = *first & *second;
+        else if (op == "|") ret = *first | *second;
+        else if (op == "^") ret = *first ^ *second;
+
+        else if ((op == "<<" || op == ">>") && *second >= 0 && *second < 128)
+        {
+            ret = op == "<<" ? boost::multiprecision::cpp_int{ *first << static_cast<unsigned>(*second) }
+                : boost::multiprecision::cpp_int{ *first >> static_cast<unsigned>(*second) };
+        }
+
+        else if ((op == "/" || op == "%") && *second != 0)
+        {
+            ret = op == "/" ? boost::multiprecision::cpp_int{ *first / *second }
+                : boost::multiprecision::cpp_int{ *first % *second };
+        }
+
+        else
+        {
+            return boost::none;
+        }
+
+        return ret;
+    }
+
+    boost::optional<std::int64_t> _narrow(const boost::optional<boost::multiprecision::cpp_int> & value)
+    {
+        if (!value || *value < std::numeric_limits<std::int64_t>::min() || *value > std::numeric_limits<std::uint64_t>::max())
+        {
+            return boost::none;
+        }
+
+        if (*value > std::numeric_limits<std::int64_t>::max())
+        {
+            return static_cast<std::int64_t>(static_cast<std::uint64_t>(*value));
+        }
+
+        return static_cast<std::int64_t>(*value);
+    }
+
+    reaver::assembler::relocation_type _relocation_type(const reaver::assembler::intel::fixup & fix)
+    {
+        using reaver::assembler::relocation_type;
+
+        switch (fix.size)
+        {
+            case 1:
+                return fix.relative ? relocation_type::relative8 : relocation_type::absolute8;
+            case 2:
+                return fix.relative ? relocation_type::relative16 : relocation_type::absolute16;
+            case 4:
+                if (fix.relative)
+                {
+                    return relocation_type::relative32;
+                }
+
+                return fix.sign_extended ? relocation_type::absolute32s : relocation_type::absolute32;
+            default:
+                return relocation_type::absolute64;
+        }
+    }
+}
+
+reaver::assembler::intel_generator::intel_generator(const frontend & front, error_engine & engine) : _front{ front },
+    _engine{ engine },
+    _mode{ front.target().arch() == target::arch::x86_64 ? intel::mode::bits64 : intel::mode::bits32 },
+    _debug_info{ front.debug_info() }, _compress_debug_sections{ front.compress_debug_sections() },
+    _warning_level{ front.warning_level() }, _error_limit{ front.error_limit() }, _statistics{ front.statistics() },
+    _trace{ front.trace() }
+{
+    if (front.performance_report())
+    {
+        _microarchitecture = intel::find_microarchitecture(front.microarchitecture());
+
+        if (!_microarchitecture)
+        {
+            _engine.push(exception(logger::error) << "unsupported microarchitecture requested: `" << front.microarchitecture()
+                << "`; supported microarchitectures: " << intel::microarchitecture_names() << ".");
+            throw std::move(_engine);
+        }
+    }
+}
+
+class reaver::assembler::intel_generator::_session : public generator::session
+{
+public:
+    _session(const intel_generator & owner) : _generator{ owner }, _object{ std::make_unique<object>() },
+        _report{ owner._microarchitecture ? std::make_unique<intel::performance_report>(*owner._microarchitecture)
+            : nullptr },
+        _lines{ owner._debug_info ? std::make_unique<dwarf::line_program>(owner._mode == intel::mode::bits64 ? 8 : 4)
+            : nullptr },
+        _current{ *_object, ".text", owner._mode, intel::encoder_for(owner._mode), { owner._warning_level, owner._error_limit }, {}, _report.get(),
+            _lines.get(), 0, {}, {}, {} }
+    {
+        _generator._begin_run(_current);
+    }
+
+    virtual void operator()(const ast & tree) override
+    {
+        for (const auto & statement : tree.statements())
+        {
+            boost::apply_visitor([&](const auto & stmt){ _generator._generate(_current, stmt); }, statement);
+        }
+    }
+
+    virtual std::unique_ptr<object> finish() override;
+
+private:
+    const intel_generator & _generator;
+    std::unique_ptr<object> _object;
+    std::unique_ptr<intel::performance_report> _report;
+    std::unique_ptr<dwarf::line_program> _lines;
+    _state _current;
+};
+
+std::unique_ptr<reaver::assembler::generator::session> reaver::assembler::intel_generator::start() const
+{
+    return std::make_unique<_session>(*this);
+}
+
+std::unique_ptr<reaver::assembler::object> reaver::assembler::intel_generator::_session::finish()
+{
+    auto & state = _current;
+    state.run.reset();
+
+    for (const auto & sym : _object->symbols())
+    {
+        if (!sym.second.defined() && !state.externs.count(sym.first))
+        {
+            state.diagnostics.push({ logger::error, utils::message::undefined_symbol, nullptr, 0, 0, { sym.first } });
+        }
+    }
+
+    state.diagnostics.render(_generator._engine);
+
+    if (state.diagnostics.errors())
+    {
+        throw std::move(_generator._engine);
+    }
+
+    if (_lines)
+    {
+        _lines->finish(*_object);
+
+        if (_generator._compress_debug_sections)
+        {
+            _object->get_section(".debug_line").compressed = true;
+        }
+    }
+
+    if (_report)
+    {
+        _report->print(std::cerr);
+    }
+
+    if (auto stats = _generator._statistics)
+    {
+        stats->add("generate/evaluation", state.evaluation.elapsed());
+        stats->add("generate/encoding", state.encoding.elapsed());
+        stats->count("instructions", state.instructions);
+        stats->count("symbols", _object->symbols().size());
+
+        std::size_t relocations = 0;
+        for (const auto & sect : _object->sections())
+        {
+            relocations += sect.relocations.size();
+            stats->count("bytes in " + sect.name, sect.size());
+        }
+
+        stats->count("relocations", relocations);
+    }
+
+    return std::move(_object);
+}
+
+void reaver::assembler::intel_generator::_generate(_state & state, const instruction & instr) const
+{
+    if (instr.operands.size() > 2)
+    {
+        _error(state, instr, utils::message::too_many_operands, { instr.mnemonic });
+        return;
+    }
+
+    std::array<std::string, 2> symbols;
+    std::array<intel::operand, 2> operands;
+
+    auto errors = state.diagnostics.errors();
+    for (std::size_t i = 0; i < instr.operands.size(); ++i)
+    {
+        operands[i] = _convert(state, instr, instr.operands[i], symbols[i]);
+    }
+
+    if (state.diagnostics.errors() != errors)
+    {
+        return;
+    }
+
+    intel::instruction encodable{ instr.mnemonic, operands[0], operands[1] };
+    if (_statistics)
+    {
+        state.encoding.start();
+    }
+
+    auto encoded = state.encode(encodable);
+
+    if (_statistics)
+    {
+        state.encoding.stop();
+    }
+
+    switch (encoded.error)
+    {
+        case intel::encoding_error::none:
+            break;
+
+        case intel::encoding_error::unknown_mnemonic:
+            _error(state, instr, utils::message::unknown_instruction, { instr.mnemonic });
+            return;
+
+        case intel::encoding_error::invalid_operands:
+            _error(state, instr, utils::message::invalid_operands, { instr.mnemonic });
+            return;
+
+        case intel::encoding_error::ambiguous_size:
+            _error(state, instr, utils::message::ambiguous_size, { instr.mnemonic });
+            return;
+
+        case intel::encoding_error::invalid_address:
+            _error(state, instr, utils::message::invalid_address);
+            return;
+
+        case intel::encoding_error::invalid_in_mode:
+            _error(state, instr, utils::message::invalid_in_mode, { instr.mnemonic, std::to_string(
+                static_cast<int>(state.mode)) });
+            return;
+
+        case intel::encoding_error::rex_conflict:
+            _error(state, instr, utils::message::rex_conflict);
+            return;
+    }
+
+    auto & sect = state.output.get_section(state.section);
+
+    if (state.lines && instr.include_chain)
+    {
+        state.lines->add(sect.name, sect.size(), *instr.include_chain);
+    }
+
+    if (instr.prefix)
+    {
+        const auto & name = instr.prefix->prefix;
+
+        if (name == "lock")
+        {
+            sect.blob.push_back(static_cast<char>(0xf0));
+        }
+
+        else if (name == "rep" || name == "repe" || name == "repz")
+        {
+            sect.blob.push_back(static_cast<char>(0xf3));
+        }
+
+        else if (name == "repne" || name == "repnz")
+        {
+            sect.blob.push_back(static_cast<char>(0xf2));
+        }
+
+        else
+        {
+            _error(state, *instr.prefix, utils::message::unknown_prefix, { name });
+            return;
+        }
+    }
+
+    auto offset = sect.size();
+    sect.blob.insert(sect.blob.end(), encoded.bytes.begin(), encoded.bytes.begin() + encoded.size);
+
+    for (std::uint8_t i = 0; i < encoded.fixup_count; ++i)
+    {
+        const auto & fix = encoded.fixups[i];
+        state.output.get_symbol(symbols[fix.operand]);
+        sect.relocations.push_back({ offset + fix.offset, symbols[fix.operand], _relocation_type(fix), fix.addend });
+    }
+
+    ++state.instructions;
+
+    if (state.report)
+    {
+        state.report->add(encodable, instr);
+    }
+}
+
+void reaver::assembler::intel_generator::_generate(_state & state, const label & l) const
+{
+    auto & sect = state.output.get_section(state.section);
+    auto & sym = state.output.get_symbol(l.label.name);
+
+    if (sym.defined())
+    {
+        _error(state, l, utils::message::label_redefinition, { l.label.name });
+        return;
+    }
+
+    sym.section = sect.name;
+    sym.offset = sect.size();
+
+    if (state.report)
+    {
+        state.report->label(l.label.name);
+    }
+}
+
+void reaver::assembler::intel_generator::_generate(_state & state, const bits_directive & bits) const
+{
+    switch (bits.bits)
+    {
+        case 16:
+            state.mode = intel::mode::bits16;
+            break;
+
+        case 32:
+            state.mode = intel::mode::bits32;
+            break;
+
+        case 64:
+            if (_mode != intel::mode::bits64)
+            {
+                _error(state, bits, utils::message::long_mode_unavailable);
+                return;
+            }
+
+            state.mode = intel::mode::bits64;
+            break;
+
+        default:
+            _error(state, bits, utils::message::invalid_mode, { std::to_string(bits.bits) });
+            return;
+    }
+
+    state.encode = intel::encoder_for(state.mode);
+}
+
+void reaver::assembler::intel_generator::_generate(_state & state, const section_directive & section) const
+{
+    state.section = section.name;
+    state.output.get_section(section.name);
+    _begin_run(state);
+
+    if (state.report)
+    {
+        state.report->boundary();
+    }
+}
+
+void reaver::assembler::intel_generator::_generate(_state & state, const global_directive & global) const
+{
+    state.output.get_symbol(global.name).global = true;
+}
+
+void reaver::assembler::intel_generator::_generate(_state & state, const extern_directive & ext) const
+{
+    state.output.get_symbol(ext.name).global = true;
+    state.externs.insert(ext.name);
+}
+
+void reaver::assembler::intel_generator::_generate(_state & state, const data_directive & data) const
+{
+    auto & sect = state.output.get_section(state.section);
+
+    if (state.lines && data.include_chain)
+    {
+        state.lines->add(sect.name, sect.size(), *data.include_chain);
+    }
+
+    sect.blob.insert(sect.blob.end(), data.bytes.begin(), data.bytes.end());
+}
+
+void reaver::assembler::intel_generator::_generate(_state & state, const incbin_directive & incbin) const
+{
+    auto path = _front.locate_file(incbin.file);
+
+    struct stat info;
+    if (path.empty() || ::stat(path.c_str(), &info) < 0)
+    {
+        _error(state, incbin, utils::message::file_not_found, { incbin.file });
+        return;
+    }
+
+    std::uint64_t length = info.st_size;
+
+    if (incbin.offset > length)
+    {
+        _error(state, incbin, utils::message::invalid_file_range, { std::to_string(incbin.offset), incbin.file,
+            std::to_string(length) });
+        return;
+    }
+
+    auto size = std::min(length - incbin.offset, incbin.size.value_or(length));
+    auto & sect = state.output.get_section(state.section);
+
+    if (state.lines && incbin.include_chain)
+    {
+        state.lines->add(sect.name, sect.size(), *incbin.include_chain);
+    }
+
+    sect.files.push_back({ sect.size(), { std::move(path), incbin.offset, size } });
+}
+
+void reaver::assembler::intel_generator::_generate(_state & state, const times_directive & times) const
+{
+    if (!times.count)
+    {
+        return;
+    }
+
+    auto & sect = state.output.get_section(state.section);
+    auto begin = sect.blob.size();
+
+    _generate(state, times.statement);
+
+    auto size = sect.blob.size() - begin;
+    if (!size)
+    {
+        return;
+    }
+
+    if (times.count > (std::numeric_limits<std::uint64_t>::max() - begin) / size)
+    {
+        _error(state, times, utils::message::invalid_integer);
+        return;
+    }
+
+    auto total = size * times.count;
+
+    if (size == 1)
+    {
+        sect.blob.insert(sect.blob.end(), total - 1, sect.blob.back());
+    }
+
+    else
+    {
+        // every copy doubles the filled part, so there are only log2(count) calls
+        sect.blob.resize(begin + total);
+
+        for (auto filled = size; filled < total; )
+        {
+            auto chunk = std::min(filled, total - filled);
+            std::memcpy(sect.blob.data() + begin + filled, sect.blob.data() + begin, chunk);
+            filled += chunk;
+        }
+    }
+}
+
+reaver::assembler::intel::operand reaver::assembler::intel_generator::_convert(_state & state, const instruction & instr,
+    const operand & op, std::string & symbol) const
+{
+    intel::operand ret;
+
+    auto evaluate = [&](const auto & value) -> std::int64_t
+    {
+        if (_statistics)
+        {
+            state.evaluation.start();
+        }
+
+        auto result = _narrow(_evaluate(value));
+
+        if (_statistics)
+        {
+            state.evaluation.stop();
+        }
+
+        if (!result)
+        {
+            _error(state, instr, utils::message::invalid_integer);
+            return 0;
+        }
+
+        return *result;
+    };
+
+    auto register_info = [&](const std::string & name, intel::register_kind kind) -> const intel::register_info *
+    {
+        auto info = intel::find_register(name);
+
+        if (!info || info->kind != kind)
+        {
+            _error(state, instr, utils::message::invalid_register, { name });
+            return nullptr;
+        }
+
+        return info;
+    };
+
+    if (auto value = boost::get<integer>(&op))
+    {
+        ret.kind = intel::operand_kind::immediate;
+        ret.value = evaluate(*value);
+    }
+
+    else if (auto value = boost::get<constant>(&op))
+    {
+        ret.kind = intel::operand_kind::immediate;
+        ret.value = evaluate(integer{ *value });
+    }
+
+    else if (auto reg = boost::get<cpu_register>(&op))
+    {
+        ret.kind = intel::operand_kind::reg;
+        ret.reg = intel::find_register(reg->name);
+
+        if (!ret.reg)
+        {
+            _error(state, instr, utils::message::invalid_register, { reg->name });
+        }
+    }
+
+    else if (auto id = boost::get<identifier>(&op))
+    {
+        if ((ret.reg = intel::find_register(id->name)))
+        {
+            ret.kind = intel::operand_kind::reg;
+        }
+
+        else
+        {
+            ret.kind = intel::operand_kind::immediate;
+            ret.symbolic = true;
+            symbol = id->name;
+        }
+    }
+
+    else if (auto addr = boost::get<address>(&op))
+    {
+        ret.kind = intel::operand_kind::memory;
+
+        if (addr->segment)
+        {
+            if (auto reg = boost::get<cpu_register>(&*addr->segment))
+            {
+                ret.memory.segment = register_info(reg->name, intel::register_kind::segment);
+            }
+
+            else
+            {
+                _error(state, instr, utils::message::far_address);
+            }
+        }
+
+        if (addr->base)
+        {
+            ret.memory.base = intel::find_register(addr->base->name);
+
+            if (!ret.memory.base || ret.memory.base->kind == intel::register_kind::segment)
+            {
+                _error(state, instr, utils::message::invalid_base_register, { addr->base->name });
+            }
+        }
+
+        if (addr->scale)
+        {
+            if (auto value = boost::get<integer>(&*addr->scale))
+            {
+                ret.memory.scale = static_cast<std::uint8_t>(evaluate(*value));
+            }
+
+            else
+            {
+                ret.memory.scale = static_cast<std::uint8_t>(evaluate(integer{ boost::get<constant>(*addr->scale) }));
+            }
+        }
+
+        if (addr->index)
+        {
+            if (auto reg = boost::get<cpu_register>(&*addr->index))
+            {
+                ret.memory.index = register_info(reg->name, intel::register_kind::general);
+            }
+
+            else if (auto value = boost::get<integer>(&*addr->index))
+            {
+                ret.memory.displacement = evaluate(*value);
+            }
+
+            else
+            {
+                ret.memory.displacement = evaluate(integer{ boost::get<constant>(*addr->index) });
+            }
+        }
+
+        if (addr->displacement)
+        {
+            ret.memory.displacement += evaluate(*addr->displacement);
+        }
+
+        if (addr->symbol)
+        {
+            ret.symbolic = true;
+            symbol = addr->symbol->name;
+        }
+
+        ret.memory.size = static_cast<std::uint8_t>(addr->size);
+    }
+
+    else
+    {
+        _error(state, instr, utils::message::floating_point_operand, { instr.mnemonic });
+    }
+
+    return ret;
+}
+
+void reaver::assembler::intel_generator::_begin_run(_state & state) const
+{
+    if (_trace)
+    {
+        state.run.reset();
+        state.run = std::make_unique<utils::trace::span>(_trace, "encode " + state.section, "encode");
+    }
+}
+
+void reaver::assembler::intel_generator::_error(_state & state, const location & loc, utils::message id,
+    std::vector<std::string> arguments) const
 {
-    _engine.push(exception(logger::crash) << "not implemented yet: " << __PRETTY_FUNCTION__);
-    throw std::move(_engine);
+    state.diagnostics.push({ logger::error, id, loc.include_chain, loc.include_chain ? loc.include_chain->line : 0,
+        loc.column, std::move(arguments) });
 }
@@ -22,9 +22,18 @@
 
 #pragma once
 
+#include <set>
+
 #include <reaver/error.h>
+#include <reaver/target.h>
 
 #include "../generator.h"
+#include "encoding.h"
+#include "performance.h"
+#include "../dwarf/line.h"
+#include "../../utils/diagnostics.h"
+#include "../../utils/statistics.h"
+#include "../../utils/trace.h"
 
 namespace reaver
 {
@@ -33,16 +42,56 @@ namespace reaver
         class intel_generator : public generator
         {
         public:
-            intel_generator(const frontend &, error_engine & engine) : _engine{ engine }
-            {
-            }
+            intel_generator(const frontend &, error_engine &);
 
             virtual ~intel_generator() {}
 
-            virtual std::unique_ptr<format::executable::executable> operator()(const ast &) const override;
+            virtual std::unique_ptr<session> start() const override;
 
         private:
+            class _session;
+
+            struct _state
+            {
+                object & output;
+                std::string section;
+                intel::mode mode;
+                // the encoder specialized for `mode`
+                intel::encoder encode;
+                utils::diagnostics diagnostics;
+                std::set<std::string> externs;
+                intel::performance_report * report;
+                dwarf::line_program * lines;
+                std::size_t instructions;
+                utils::statistics::stopwatch evaluation;
+                utils::statistics::stopwatch encoding;
+                std::unique_ptr<utils::trace::span> run;
+            };
+
+            void _generate(_state &, const instruction &) const;
+            void _generate(_state &, const label &) const;
+            void _generate(_state &, const bits_directive &) const;
+            void _generate(_state &, const section_directive &) const;
+            void _generate(_state &, const global_directive &) const;
+            void _generate(_state &, const extern_directive &) const;
+            void _generate(_state &, const data_directive &) const;
+            void _generate(_state &, const incbin_directive &) const;
+            void _generate(_state &, const times_directive &) const;
+
+            intel::operand _convert(_state &, const instruction &, const operand &, std::string &) const;
+            void _begin_run(_state &) const;
+            void _error(_state &, const location &, utils::message, std::vector<std::string> = {}) const;
+
+            const frontend & _front;
             error_engine & _engine;
+            intel::mode _mode;
+            const intel::microarchitecture * _microarchitecture = nullptr;
+            bool _debug_info;
+            bool _compress_debug_sections;
+            logger::level _warning_level;
+            std::size_t _error_limit;
+            utils::statistics * _statistics;
+            utils::trace * _trace;
         };
     }
 }
@@ -0,0 +1,431 @@
+/**
+ * Reaver Project Assembler License
+ *
+ * Copyright © 2014 Michał "Griwes" Dominiak
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation is required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ **/
+
+#include <algorithm>
+#include <iomanip>
+#include <numeric>
+
+#include "performance.h"
+
+namespace
+{
+    using namespace reaver::assembler::intel;
+
+    const microarchitecture & _skylake()
+    {
+        enum : std::uint16_t
+        {
+            p0 = 1 << 0, p1 = 1 << 1, p2 = 1 << 2, p3 = 1 << 3, p4 = 1 << 4, p5 = 1 << 5, p6 = 1 << 6, p7 = 1 << 7,
+            alu = p0 | p1 | p5 | p6, load = p2 | p3, store_address = p2 | p3 | p7, store_data = p4, branch = p6,
+            p06 = p0 | p6, p15 = p1 | p5
+        };
+
+        static const microarchitecture arch{ "skylake", 4, { "p0", "p1", "p2", "p3", "p4", "p5", "p6", "p7" }, {
+            { "mov", "r,r", { { { alu, 1 } } }, 1, writes_first },
+            { "mov", "r,i", { { { alu, 1 } } }, 1, writes_first },
+            { "mov", "r,m", { { { load, 1 } } }, 5, writes_first },
+            { "mov", "m,r", { { { store_address, 1 }, { store_data, 1 } } }, 0, 0 },
+            { "mov", "m,i", { { { store_address, 1 }, { store_data, 1 } } }, 0, 0 },
+
+            { "alu", "r,r", { { { alu, 1 } } }, 1, writes_first | reads_first },
+            { "alu", "r,i", { { { alu, 1 } } }, 1, writes_first | reads_first },
+            { "alu", "r,m", { { { alu, 1 }, { load, 1 } } }, 6, writes_first | reads_first },
+            { "alu", "m,r", { { { alu, 1 }, { load, 1 }, { store_address, 1 }, { store_data, 1 } } }, 6, 0 },
+            { "alu", "m,i", { { { alu, 1 }, { load, 1 }, { store_address, 1 }, { store_data, 1 } } }, 6, 0 },
+
+            { "cmp", "r,r", { { { alu, 1 } } }, 1, 0 },
+            { "cmp", "r,i", { { { alu, 1 } } }, 1, 0 },
+            { "cmp", "r,m", { { { alu, 1 }, { load, 1 } } }, 6, 0 },
+            { "cmp", "m,r", { { { alu, 1 }, { load, 1 } } }, 6, 0 },
+            { "cmp", "m,i", { { { alu, 1 }, { load, 1 } } }, 6, 0 },
+
+            { "adc", "r,r", { { { p06, 1 } } }, 1, writes_first | reads_first },
+            { "adc", "r,i", { { { p06, 1 } } }, 1, writes_first | reads_first },
+
+            { "lea", "r,m", { { { p15, 1 } } }, 1, writes_first },
+
+            { "unary", "r", { { { alu, 1 } } }, 1, writes_first | reads_first },
+            { "unary", "m", { { { alu, 1 }, { load, 1 }, { store_address, 1 }, { store_data, 1 } } }, 6, 0 },
+
+            { "imul", "r,r", { { { p1, 1 } } }, 3, writes_first | reads_first },
+            { "imul", "r,m", { { { p1, 1 }, { load, 1 } } }, 8, writes_first | reads_first },
+            { "imul", "r", { { { p1, 1 }, { p5, 1 } } }, 3, implicit_accumulator },
+            { "mul", "r", { { { p1, 1 }, { p5, 1 } } }, 3, implicit_accumulator },
+            { "mul", "m", { { { p1, 1 }, { p5, 1 }, { load, 1 } } }, 8, implicit_accumulator },
+            { "div", "r", { { { p0, 4 }, { alu, 6 } } }, 26, implicit_accumulator },
+            { "idiv", "r", { { { p0, 4 }, { alu, 6 } } }, 26, implicit_accumulator },
+
+            { "push", "r", { { { store_address, 1 }, { store_data, 1 } } }, 1, implicit_stack },
+            { "push", "i", { { { store_address, 1 }, { store_data, 1 } } }, 1, implicit_stack },
+            { "pop", "r", { { { load, 1 } } }, 5, writes_first | implicit_stack },
+
+            { "call", "i", { { { store_address, 1 }, { store_data, 1 }, { branch, 1 } } }, 0, implicit_stack },
+            { "call", "r", { { { store_address, 1 }, { store_data, 1 }, { branch, 1 } } }, 0, implicit_stack },
+            { "ret", "", { { { load, 1 }, { branch, 1 } } }, 0, implicit_stack },
+            { "jmp", "i", { { { branch, 1 } } }, 0, 0 },
+            { "jmp", "r", { { { branch, 1 } } }, 0, 0 },
+            { "jcc", "i", { { { p06, 1 } } }, 0, 0 },
+
+            { "nop", "", { { { 0, 1 } } }, 0, 0 }
+        } };
+
+        return arch;
+    }
+
+    const microarchitecture & _zen2()
+    {
+        enum : std::uint16_t
+        {
+            alu0 = 1 << 0, alu1 = 1 << 1, alu2 = 1 << 2, alu3 = 1 << 3, agu0 = 1 << 4, agu1 = 1 << 5, agu2 = 1 << 6,
+            alu = alu0 | alu1 | alu2 | alu3, load = agu0 | agu1 | agu2, store = agu0 | agu1 | agu2, branch = alu0 | alu3
+        };
+
+        static const microarchitecture arch{ "zen2", 5, { "alu0", "alu1", "alu2", "alu3", "agu0", "agu1", "agu2" }, {
+            { "mov", "r,r", { { { alu, 1 } } }, 1, writes_first },
+            { "mov", "r,i", { { { alu, 1 } } }, 1, writes_first },
+            { "mov", "r,m", { { { load, 1 } } }, 4, writes_first },
+            { "mov", "m,r", { { { store, 1 } } }, 0, 0 },
+            { "mov", "m,i", { { { store, 1 } } }, 0, 0 },
+
+            { "alu", "r,r", { { { alu, 1 } } }, 1, writes_first | reads_first },
+            { "alu", "r,i", { { { alu, 1 } } }, 1, writes_first | reads_first },
+            { "alu", "r,m", { { { alu, 1 }, { load, 1 } } }, 5, writes_first | reads_first },
+            { "alu", "m,r", { { { alu, 1 }, { load, 1 }, { store, 1 } } }, 6, 0 },
+            { "alu", "m,i", { { { alu, 1 }, { load, 1 }, { store, 1 } } }, 6, 0 },
+
+            { "cmp", "r,r", { { { alu, 1 } } }, 1, 0 },
+            { "cmp", "r,i", { { { alu, 1 } } }, 1, 0 },
+            { "cmp", "r,m", { { { alu, 1 }, { load, 1 } } }, 5, 0 },
+            { "cmp", "m,r", { { { alu, 1 }, { load, 1 } } }, 5, 0 },
+            { "cmp", "m,i", { { { alu, 1 }, { load, 1 } } }, 5, 0 },
+
+            { "adc", "r,r", { { { alu, 1 } } }, 1, writes_first | reads_first },
+            { "adc", "r,i", { { { alu, 1 } } }, 1, writes_first | reads_first },
+
+            { "lea", "r,m", { { { alu, 1 } } }, 1, writes_first },
+
+            { "unary", "r", { { { alu, 1 } } }, 1, writes_first | reads_first },
+            { "unary", "m", { { { alu, 1 }, { load, 1 }, { store, 1 } } }, 6, 0 },
+
+            { "imul", "r,r", { { { alu1, 1 } } }, 3, writes_first | reads_first },
+            { "imul", "r,m", { { { alu1, 1 }, { load, 1 } } }, 7, writes_first | reads_first },
+            { "imul", "r", { { { alu1, 2 } } }, 3, implicit_accumulator },
+            { "mul", "r", { { { alu1, 2 } } }, 3, implicit_accumulator },
+            { "mul", "m", { { { alu1, 2 }, { load, 1 } } }, 7, implicit_accumulator },
+            { "div", "r", { { { alu2, 2 } } }, 14, implicit_accumulator },
+            { "idiv", "r", { { { alu2, 2 } } }, 14, implicit_accumulator },
+
+            { "push", "r", { { { store, 1 } } }, 1, implicit_stack },
+            { "push", "i", { { { store, 1 } } }, 1, implicit_stack },
+            { "pop", "r", { { { load, 1 } } }, 4, writes_first | implicit_stack },
+
+            { "call", "i", { { { store, 1 }, { branch, 1 } } }, 0, implicit_stack },
+            { "call", "r", { { { store, 1 }, { branch, 1 } } }, 0, implicit_stack },
+            { "ret", "", { { { load, 1 }, { branch, 1 } } }, 0, implicit_stack },
+            { "jmp", "i", { { { branch, 1 } } }, 0, 0 },
+            { "jmp", "r", { { { branch, 1 } } }, 0, 0 },
+            { "jcc", "i", { { { branch, 1 } } }, 0, 0 },
+
+            { "nop", "", { { { 0, 1 } } }, 0, 0 }
+        } };
+
+        return arch;
+    }
+
+    const microarchitecture & (* const _microarchitectures[])() = { _skylake, _zen2 };
+
+    std::string _lower(std::string_view str)
+    {
+        std::string ret{ str };
+        std::transform(ret.begin(), ret.end(), ret.begin(), [](char c){ return c >= 'A' && c <= 'Z' ? c - 'A' + 'a' : c; });
+        return ret;
+    }
+
+    std::string _family(const std::string & mnemonic)
+    {
+        static const char * alu[] = { "add", "sub", "and", "or", "xor", "test", "sbb" };
+        static const char * unary[] = { "inc", "dec", "not", "neg" };
+
+        if (std::find(std::begin(alu), std::end(alu), mnemonic) != std::end(alu))
+        {
+            return mnemonic == "test" ? "cmp" : mnemonic == "sbb" ? "adc" : "alu";
+        }
+
+        if (std::find(std::begin(unary), std::end(unary), mnemonic) != std::end(unary))
+        {
+            return "unary";
+        }
+
+        if (mnemonic.size() > 1 && mnemonic[0] == 'j' && mnemonic != "jmp")
+        {
+            return "jcc";
+        }
+
+        return mnemonic;
+    }
+
+    std::string _signature(const reaver::assembler::intel::instruction & instr)
+    {
+        std::string ret;
+
+        for (std::size_t i = 0; i < instr.count; ++i)
+        {
+            if (i)
+            {
+                ret += ',';
+            }
+
+            switch (instr.operands[i].kind)
+            {
+                case operand_kind::reg:
+                    ret += instr.operands[i].reg->kind == register_kind::segment ? 's' : 'r';
+                    break;
+
+                case operand_kind::memory:
+                    ret += 'm';
+                    break;
+
+                default:
+                    ret += 'i';
+                    break;
+            }
+        }
+
+        return ret;
+    }
+}
+
+const reaver::assembler::intel::microarchitecture * reaver::assembler::intel::find_microarchitecture(const std::string & name)
+{
+    for (auto arch : _microarchitectures)
+    {
+        if (arch().name == name)
+        {
+            return &arch();
+        }
+    }
+
+    return nullptr;
+}
+
+std::string reaver::assembler::intel::microarchitecture_names()
+{
+    std::string ret;
+
+    for (auto arch : _microarchitectures)
+    {
+        ret += (ret.empty() ? "" : ", ") + std::string{ arch().name };
+    }
+
+    return ret;
+}
+
+void reaver::assembler::intel::performance_report::add(const instruction & instr, const location & loc)
+{
+    if (!_open)
+    {
+        _blocks.emplace_back();
+        _blocks.back().name = std::move(_pending_label);
+        _blocks.back().pressure.resize(_arch.ports.size());
+        _pending_label.clear();
+        _open = true;
+
+        if (loc.include_chain)
+        {
+            _blocks.back().where = loc.include_chain->file + ":" + std::to_string(loc.include_chain->line);
+        }
+    }
+
+    auto & block = _blocks.back();
+    auto mnemonic = _lower(instr.mnemonic);
+    auto family = _family(mnemonic);
+    auto signature = _signature(instr);
+
+    ++block.instructions;
+
+    auto entry = std::find_if(_arch.entries.begin(), _arch.entries.end(), [&](const performance_entry & e){
+        return e.mnemonic == family && e.operands == signature;
+    });
+
+    if (entry == _arch.entries.end())
+    {
+        block.unknown.push_back(mnemonic + (signature.empty() ? "" : " " + signature));
+        ++block.uops;
+    }
+
+    else
+    {
+        for (const auto & group : entry->uops)
+        {
+            block.uops += group.count;
+
+            auto ports = 0;
+            for (std::size_t i = 0; i < _arch.ports.size(); ++i)
+            {
+                ports += (group.ports >> i) & 1;
+            }
+
+            for (std::size_t i = 0; ports && i < _arch.ports.size(); ++i)
+            {
+                if ((group.ports >> i) & 1)
+                {
+                    block.pressure[i] += static_cast<double>(group.count) / ports;
+                }
+            }
+        }
+    }
+
+    std::uint8_t flags = entry == _arch.entries.end() ? writes_first | reads_first : entry->flags;
+    double latency = entry == _arch.entries.end() ? 1 : entry->latency;
+
+    std::vector<std::uint8_t> reads;
+    std::vector<std::uint8_t> writes;
+
+    for (std::size_t i = 0; i < instr.count; ++i)
+    {
+        const auto & op = instr.operands[i];
+
+        if (op.kind == operand_kind::reg && op.reg->kind == register_kind::general)
+        {
+            if (i != 0 || (flags & reads_first) || !(flags & writes_first))
+            {
+                reads.push_back(op.reg->code);
+            }
+
+            if (i == 0 && (flags & writes_first))
+            {
+                writes.push_back(op.reg->code);
+            }
+        }
+
+        else if (op.kind == operand_kind::memory)
+        {
+            for (auto reg : { op.memory.base, op.memory.index })
+            {
+                if (reg && reg->kind == register_kind::general)
+                {
+                    reads.push_back(reg->code);
+                }
+            }
+        }
+    }
+
+    if (flags & implicit_accumulator)
+    {
+        reads.push_back(0);
+        writes.push_back(0);
+        writes.push_back(2);
+    }
+
+    if (flags & implicit_stack)
+    {
+        reads.push_back(4);
+        writes.push_back(4);
+    }
+
+    double start = 0;
+    for (auto reg : reads)
+    {
+        start = std::max(start, block.ready[reg]);
+    }
+
+    for (auto reg : writes)
+    {
+        block.ready[reg] = start + latency;
+    }
+
+    block.chain = std::max(block.chain, start + latency);
+
+    if (family == "jmp" || family == "jcc" || family == "call" || family == "ret" || family == "int" || family == "syscall"
+        || family == "hlt")
+    {
+        boundary();
+    }
+}
+
+void reaver::assembler::intel::performance_report::label(const std::string & name)
+{
+    boundary();
+    _pending_label = name;
+}
+
+void reaver::assembler::intel::performance_report::boundary()
+{
+    _open = false;
+}
+
+void reaver::assembler::intel::performance_report::print(std::ostream & out)
+{
+    out << std::fixed << std::setprecision(2);
+    out << "Static performance report for " << _arch.name << " (" << _blocks.size() << " basic blocks)\n";
+
+    for (const auto & block : _blocks)
+    {
+        double front_end = static_cast<double>(block.uops) / _arch.issue_width;
+        auto busiest = std::max_element(block.pressure.begin(), block.pressure.end());
+        double throughput = std::max(front_end, busiest == block.pressure.end() ? 0. : *busiest);
+
+        out << "\nblock " << (block.name.empty() ? "<anonymous>" : block.name);
+        if (!block.where.empty())
+        {
+            out << " (" << block.where << ")";
+        }
+        out << ": " << block.instructions << " instructions\n";
+
+        out << "  uops: " << block.uops << ", latency chain: " << block.chain << " cycles, reciprocal throughput: "
+            << throughput << " cycles\n";
+
+        out << "  port pressure:";
+        for (std::size_t i = 0; i < _arch.ports.size(); ++i)
+        {
+            out << " " << _arch.ports[i] << "=" << block.pressure[i];
+        }
+        out << "\n";
+
+        out << "  bottleneck: ";
+        if (block.chain > throughput)
+        {
+            out << "dependency chain";
+        }
+
+        else if (busiest != block.pressure.end() && *busiest > front_end)
+        {
+            out << "port " << _arch.ports[busiest - block.pressure.begin()];
+        }
+
+        else
+        {
+            out << "front end";
+        }
+        out << "\n";
+
+        if (!block.unknown.empty())
+        {
+            out << "  no cost data for:";
+            for (const auto & unknown : block.unknown)
+            {
+                out << " `" << unknown << "`";
+            }
+            out << "\n";
+        }
+    }
+}
@@ -0,0 +1,106 @@
+/**
+ * Reaver Project Assembler License
+ *
+ * Copyright © 2014 Michał "Griwes" Dominiak
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation is required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ **/
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <ostream>
+
+#include "../../parser/ast.h"
+#include "encoding.h"
+
+namespace reaver
+{
+    namespace assembler
+    {
+        namespace intel
+        {
+            struct uop_group
+            {
+                std::uint16_t ports;
+                std::uint8_t count;
+            };
+
+            enum performance_flags : std::uint8_t
+            {
+                writes_first = 1,
+                reads_first = 2,
+                implicit_accumulator = 4,
+                implicit_stack = 8
+            };
+
+            struct performance_entry
+            {
+                std::string_view mnemonic;
+                std::string_view operands;
+                std::array<uop_group, 4> uops;
+                std::uint8_t latency;
+                std::uint8_t flags;
+            };
+
+            struct microarchitecture
+            {
+                std::string_view name;
+                std::uint8_t issue_width;
+                std::vector<std::string_view> ports;
+                std::vector<performance_entry> entries;
+            };
+
+            const microarchitecture * find_microarchitecture(const std::string &);
+            std::string microarchitecture_names();
+
+            class performance_report
+            {
+            public:
+                performance_report(const microarchitecture & arch) : _arch{ arch }
+                {
+                }
+
+                void add(const instruction &, const location &);
+                void label(const std::string &);
+                void boundary();
+
+                void print(std::ostream &);
+
+            private:
+                struct _block
+                {
+                    std::string name;
+                    std::string where;
+                    std::size_t instructions = 0;
+                    std::size_t uops = 0;
+                    std::vector<double> pressure;
+                    double chain = 0;
+                    double ready[16] = {};
+                    std::vector<std::string> unknown;
+                };
+
+                const microarchitecture & _arch;
+                std::vector<_block> _blocks;
+                std::string _pending_label;
+                bool _open = false;
+            };
+        }
+    }
+}
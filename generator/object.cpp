@@ -0,0 +1,93 @@
+/**
+ * Reaver Project Assembler License
+ *
+ * Copyright © 2014 Michał "Griwes" Dominiak
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation is required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ **/
+
+#include <cstring>
+#include <limits>
+#include <type_traits>
+
+#include "object.h"
+
+namespace
+{
+    // which values a field of the relocated width can hold: narrow absolute fields take either interpretation, like in
+    // the linkers, while sign or zero extended ones only take what the cpu extends back to the same value
+    enum class _range
+    {
+        either,
+        signed_values,
+        unsigned_values
+    };
+
+    template<typename T>
+    bool _write(char * where, std::int64_t value, _range range)
+    {
+        using unsigned_type = std::make_unsigned_t<T>;
+
+        bool fits_signed = value >= std::numeric_limits<T>::min() && value <= std::numeric_limits<T>::max();
+        bool fits_unsigned = value >= 0 && static_cast<std::uint64_t>(value) <= std::numeric_limits<unsigned_type>::max();
+
+        if ((range == _range::signed_values && !fits_signed) || (range == _range::unsigned_values && !fits_unsigned)
+            || (range == _range::either && !fits_signed && !fits_unsigned))
+        {
+            return false;
+        }
+
+        auto raw = static_cast<unsigned_type>(value);
+        std::memcpy(where, &raw, sizeof(raw));
+        return true;
+    }
+}
+
+bool reaver::assembler::relocate(char * field, const relocation & reloc, std::uint64_t symbol, std::uint64_t address)
+{
+    std::int64_t value = symbol + reloc.addend;
+    std::int64_t place = address + reloc.offset;
+
+    switch (reloc.type)
+    {
+        case relocation_type::absolute8:
+            return _write<std::int8_t>(field, value, _range::either);
+
+        case relocation_type::absolute16:
+            return _write<std::int16_t>(field, value, _range::either);
+
+        case relocation_type::absolute32:
+            return _write<std::int32_t>(field, value, _range::unsigned_values);
+
+        case relocation_type::absolute32s:
+            return _write<std::int32_t>(field, value, _range::signed_values);
+
+        case relocation_type::absolute64:
+            return _write<std::int64_t>(field, value, _range::either);
+
+        case relocation_type::relative8:
+            return _write<std::int8_t>(field, value - place, _range::signed_values);
+
+        case relocation_type::relative16:
+            return _write<std::int16_t>(field, value - place, _range::signed_values);
+
+        case relocation_type::relative32:
+            return _write<std::int32_t>(field, value - place, _range::signed_values);
+    }
+
+    return false;
+}
@@ -0,0 +1,268 @@
+/**
+ * Reaver Project Assembler License
+ *
+ * Copyright © 2014 Michał "Griwes" Dominiak
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation is required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ **/
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <map>
+#include <algorithm>
+
+#include "../utils/descriptor.h"
+
+namespace reaver
+{
+    namespace assembler
+    {
+        enum class relocation_type
+        {
+            absolute8,
+            absolute16,
+            absolute32,
+            // sign extended to 64 bits when used
+            absolute32s,
+            absolute64,
+            relative8,
+            relative16,
+            relative32
+        };
+
+        struct relocation
+        {
+            std::uint64_t offset;
+            std::string symbol;
+            relocation_type type;
+            std::int64_t addend;
+        };
+
+        struct symbol
+        {
+            std::string name;
+            std::string section;
+            std::uint64_t offset = 0;
+            bool global = false;
+
+            bool defined() const
+            {
+                return !section.empty();
+            }
+        };
+
+        // bytes taken verbatim from a file, at `offset` in the section; they are never loaded into the blob
+        struct file_range
+        {
+            std::uint64_t offset;
+            utils::file_extent source;
+        };
+
+        struct section
+        {
+            section(std::string n) : name{ std::move(n) }
+            {
+                if (name == ".text" || name.compare(0, 6, ".text.") == 0)
+                {
+                    executable = true;
+                }
+
+                else if (name == ".data" || name.compare(0, 6, ".data.") == 0 || name == ".bss")
+                {
+                    writable = true;
+                }
+
+                else if (name.compare(0, 7, ".debug_") == 0)
+                {
+                    allocated = false;
+                    alignment = 1;
+                }
+            }
+
+            std::string name;
+            std::vector<char> blob;
+            std::vector<file_range> files;
+            std::vector<relocation> relocations;
+
+            bool allocated = true;
+            bool writable = false;
+            bool executable = false;
+            std::uint64_t alignment = 16;
+            bool compressed = false;
+
+            std::uint64_t size() const
+            {
+                std::uint64_t ret = blob.size();
+
+                for (const auto & range : files)
+                {
+                    ret += range.source.size;
+                }
+
+                return ret;
+            }
+
+            // translates an offset in the section into an index into the blob; it must not fall into a file range
+            std::uint64_t blob_offset(std::uint64_t offset) const
+            {
+                auto ret = offset;
+
+                for (const auto & range : files)
+                {
+                    if (range.offset >= offset)
+                    {
+                        break;
+                    }
+
+                    ret -= range.source.size;
+                }
+
+                return ret;
+            }
+
+            // calls `bytes(data, size)` and `file(extent)` for the contents of [begin, end), in order
+            template<typename Bytes, typename File>
+            void visit(std::uint64_t begin, std::uint64_t end, Bytes && bytes, File && file) const
+            {
+                std::uint64_t skipped = 0;
+
+                for (const auto & range : files)
+                {
+                    auto range_end = range.offset + range.source.size;
+
+                    if (range.offset >= end)
+                    {
+                        break;
+                    }
+
+                    if (range_end > begin)
+                    {
+                        if (begin < range.offset)
+                        {
+                            bytes(blob.data() + begin - skipped, range.offset - begin);
+                            begin = range.offset;
+                        }
+
+                        auto last = std::min(end, range_end);
+                        file(utils::file_extent{ range.source.path, range.source.offset + (begin - range.offset), last - begin });
+                        begin = last;
+                    }
+
+                    skipped += range.source.size;
+                }
+
+                if (begin < end)
+                {
+                    bytes(blob.data() + begin - skipped, end - begin);
+                }
+            }
+
+            template<typename Bytes, typename File>
+            void visit(Bytes && bytes, File && file) const
+            {
+                visit(0, size(), std::forward<Bytes>(bytes), std::forward<File>(file));
+            }
+
+            // the contents with the file ranges read in, for the few consumers that need them in memory
+            std::vector<char> contents() const
+            {
+                if (files.empty())
+                {
+                    return blob;
+                }
+
+                std::vector<char> ret;
+                ret.reserve(size());
+
+                visit([&](const char * data, std::size_t size){ ret.insert(ret.end(), data, data + size); },
+                    [&](const utils::file_extent & extent)
+                    {
+                        ret.resize(ret.size() + extent.size);
+                        utils::read_extent(extent, ret.data() + ret.size() - extent.size);
+                    });
+
+                return ret;
+            }
+        };
+
+        bool relocate(char *, const relocation &, std::uint64_t, std::uint64_t);
+
+        class object
+        {
+        public:
+            section & get_section(const std::string & name)
+            {
+                auto it = _section_indices.find(name);
+
+                if (it == _section_indices.end())
+                {
+                    it = _section_indices.emplace(name, _sections.size()).first;
+                    _sections.emplace_back(name);
+                }
+
+                return _sections[it->second];
+            }
+
+            const std::vector<section> & sections() const
+            {
+                return _sections;
+            }
+
+            std::vector<section> & sections()
+            {
+                return _sections;
+            }
+
+            template<typename F>
+            void remove_sections(F && predicate)
+            {
+                _sections.erase(std::remove_if(_sections.begin(), _sections.end(), predicate), _sections.end());
+
+                _section_indices.clear();
+                for (std::size_t i = 0; i < _sections.size(); ++i)
+                {
+                    _section_indices.emplace(_sections[i].name, i);
+                }
+            }
+
+            symbol & get_symbol(const std::string & name)
+            {
+                auto & ret = _symbols[name];
+                ret.name = name;
+                return ret;
+            }
+
+            const std::map<std::string, symbol> & symbols() const
+            {
+                return _symbols;
+            }
+
+            std::map<std::string, symbol> & symbols()
+            {
+                return _symbols;
+            }
+
+        private:
+            std::vector<section> _sections;
+            std::map<std::string, std::size_t> _section_indices;
+            std::map<std::string, symbol> _symbols;
+        };
+    }
+}
@@ -0,0 +1,85 @@
+/**
+ * Reaver Project Assembler License
+ *
+ * Copyright © 2014 Michał "Griwes" Dominiak
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation is required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ **/
+
+#include <utility>
+#include <system_error>
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "buffer.h"
+
+reaver::assembler::jit::buffer::buffer(std::size_t size) : _size{ (size + page_size() - 1) / page_size() * page_size() }
+{
+    if (!_size)
+    {
+        return;
+    }
+
+    void * ptr = ::mmap(nullptr, _size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+    if (ptr == MAP_FAILED)
+    {
+        throw std::system_error{ errno, std::system_category(), "mmap" };
+    }
+
+    _data = static_cast<char *>(ptr);
+}
+
+reaver::assembler::jit::buffer::buffer(buffer && other) noexcept : _data{ std::exchange(other._data, nullptr) },
+    _size{ std::exchange(other._size, 0) }
+{
+}
+
+reaver::assembler::jit::buffer & reaver::assembler::jit::buffer::operator=(buffer && other) noexcept
+{
+    std::swap(_data, other._data);
+    std::swap(_size, other._size);
+    return *this;
+}
+
+reaver::assembler::jit::buffer::~buffer()
+{
+    if (_data)
+    {
+        ::munmap(_data, _size);
+    }
+}
+
+void reaver::assembler::jit::buffer::protect(std::size_t offset, std::size_t size, bool writable, bool executable)
+{
+    if (!size)
+    {
+        return;
+    }
+
+    if (::mprotect(_data + offset, size, PROT_READ | (writable ? PROT_WRITE : 0) | (executable ? PROT_EXEC : 0)))
+    {
+        throw std::system_error{ errno, std::system_category(), "mprotect" };
+    }
+}
+
+std::size_t reaver::assembler::jit::buffer::page_size()
+{
+    static const std::size_t size = ::sysconf(_SC_PAGESIZE);
+    return size;
+}
@@ -0,0 +1,68 @@
+/**
+ * Reaver Project Assembler License
+ *
+ * Copyright © 2014 Michał "Griwes" Dominiak
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation is required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ **/
+
+#pragma once
+
+#include <cstddef>
+
+namespace reaver
+{
+    namespace assembler
+    {
+        namespace jit
+        {
+            class buffer
+            {
+            public:
+                buffer()
+                {
+                }
+
+                buffer(std::size_t);
+                buffer(buffer &&) noexcept;
+                buffer & operator=(buffer &&) noexcept;
+                ~buffer();
+
+                buffer(const buffer &) = delete;
+                buffer & operator=(const buffer &) = delete;
+
+                char * data() const
+                {
+                    return _data;
+                }
+
+                std::size_t size() const
+                {
+                    return _size;
+                }
+
+                void protect(std::size_t, std::size_t, bool writable, bool executable);
+
+                static std::size_t page_size();
+
+            private:
+                char * _data = nullptr;
+                std::size_t _size = 0;
+            };
+        }
+    }
+}
@@ -0,0 +1,153 @@
+/**
+ * Reaver Project Assembler License
+ *
+ * Copyright © 2014 Michał "Griwes" Dominiak
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation is required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ **/
+
+#include <cstring>
+
+#include "jit.h"
+#include "../frontend/memory.h"
+#include "../parser/parser.h"
+#include "../generator/generator.h"
+
+namespace
+{
+    std::uint64_t _align(std::uint64_t value, std::uint64_t alignment)
+    {
+        return alignment ? (value + alignment - 1) / alignment * alignment : value;
+    }
+}
+
+reaver::assembler::jit::code reaver::assembler::jit::assemble(std::string source, const externals & ext,
+    error_engine & engine)
+{
+    memory_frontend front{ std::move(source) };
+    return assemble(front, ext, engine);
+}
+
+reaver::assembler::jit::code reaver::assembler::jit::assemble(const frontend & front, const externals & ext,
+    error_engine & engine)
+{
+    auto parser = create_parser(front, engine);
+    auto generator = create_generator(front, engine);
+
+    auto parsed = (*parser)();
+    auto generated = (*generator)(parsed);
+
+    return load(*generated, ext, engine);
+}
+
+reaver::assembler::jit::code reaver::assembler::jit::load(const object & obj, const externals & ext, error_engine & engine)
+{
+    std::map<std::string, std::uint64_t> offsets;
+    std::uint64_t size = 0;
+
+    for (auto pass : { true, false })
+    {
+        for (const auto & sect : obj.sections())
+        {
+            if (sect.allocated && sect.executable == pass)
+            {
+                size = _align(size, sect.alignment);
+                offsets[sect.name] = size;
+                size += sect.size();
+            }
+        }
+
+        if (pass)
+        {
+            size = _align(size, buffer::page_size());
+        }
+    }
+
+    std::uint64_t executable_size = 0;
+    for (const auto & sect : obj.sections())
+    {
+        if (sect.allocated && sect.executable)
+        {
+            executable_size = _align(offsets[sect.name] + sect.size(), buffer::page_size());
+        }
+    }
+
+    buffer buf{ size };
+    auto base = reinterpret_cast<std::uintptr_t>(buf.data());
+
+    std::map<std::string, std::uintptr_t> symbols;
+    std::size_t errors = 0;
+
+    for (const auto & sym : obj.symbols())
+    {
+        if (sym.second.defined())
+        {
+            symbols[sym.first] = base + offsets.at(sym.second.section) + sym.second.offset;
+        }
+
+        else if (ext.count(sym.first))
+        {
+            symbols[sym.first] = ext.at(sym.first);
+        }
+
+        else
+        {
+            engine.push(exception(logger::error) << "undefined reference to `" << sym.first << "`.");
+            ++errors;
+        }
+    }
+
+    if (errors)
+    {
+        throw std::move(engine);
+    }
+
+    for (const auto & sect : obj.sections())
+    {
+        if (!offsets.count(sect.name))
+        {
+            continue;
+        }
+
+        char * data = buf.data() + offsets[sect.name];
+        auto position = data;
+        sect.visit([&](const char * bytes, std::size_t size){ position = std::copy(bytes, bytes + size, position); },
+            [&](const utils::file_extent & extent){ utils::read_extent(extent, position); position += extent.size; });
+
+        for (const auto & reloc : sect.relocations)
+        {
+            bool fits = relocate(data + reloc.offset, reloc, symbols.at(reloc.symbol), base + offsets[sect.name]);
+
+            if (!fits)
+            {
+                engine.push(exception(logger::error) << "relocation against `" << reloc.symbol << "` in section `"
+                    << sect.name << "` does not fit in its field.");
+                ++errors;
+            }
+        }
+    }
+
+    if (errors)
+    {
+        throw std::move(engine);
+    }
+
+    buf.protect(0, executable_size, false, true);
+    buf.protect(executable_size, buf.size() - executable_size, true, false);
+
+    return { std::move(buf), std::move(symbols) };
+}
@@ -0,0 +1,82 @@
+/**
+ * Reaver Project Assembler License
+ *
+ * Copyright © 2014 Michał "Griwes" Dominiak
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation is required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ **/
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <map>
+
+#include <reaver/error.h>
+
+#include "../frontend/frontend.h"
+#include "../generator/object.h"
+#include "buffer.h"
+
+namespace reaver
+{
+    namespace assembler
+    {
+        namespace jit
+        {
+            using externals = std::map<std::string, std::uintptr_t>;
+
+            class code
+            {
+            public:
+                code(buffer buf, std::map<std::string, std::uintptr_t> symbols) : _buffer{ std::move(buf) },
+                    _symbols{ std::move(symbols) }
+                {
+                }
+
+                std::uintptr_t address(const std::string & name) const
+                {
+                    return _symbols.at(name);
+                }
+
+                template<typename T>
+                T * get(const std::string & name) const
+                {
+                    return reinterpret_cast<T *>(address(name));
+                }
+
+                const std::map<std::string, std::uintptr_t> & symbols() const
+                {
+                    return _symbols;
+                }
+
+                const buffer & memory() const
+                {
+                    return _buffer;
+                }
+
+            private:
+                buffer _buffer;
+                std::map<std::string, std::uintptr_t> _symbols;
+            };
+
+            code assemble(std::string, const externals &, error_engine &);
+            code assemble(const frontend &, const externals &, error_engine &);
+            code load(const object &, const externals &, error_engine &);
+        }
+    }
+}
@@ -23,30 +23,30 @@
 #include <reaver/logger.h>
 
 #include "frontend/console.h"
-#include "parser/parser.h"
-#include "generator/generator.h"
-#include "output/output.h"
+#include "driver/driver.h"
+#include "server/server.h"
+#include "server/client.h"
 
 using reaver::logger::dlog;
 using reaver::logger::crash;
 
 int main(int argc, char ** argv) try
 {
+    if (auto result = reaver::assembler::forward(argc, argv))
+    {
+        return *result;
+    }
+
     reaver::error_engine engine;
 
     reaver::assembler::console_frontend frontend{ argc, argv, engine };
-    auto parser = reaver::assembler::create_parser(frontend, engine);
-    auto generator = reaver::assembler::create_generator(frontend, engine);
-    auto output = reaver::assembler::create_output(frontend, engine);
 
-    auto parsed = (*parser)();
-    auto generated = (*generator)(parsed);
-    (*output)(generated);
-
-    if (engine.size())
+    if (frontend.server())
     {
-        engine.print(dlog);
+        return reaver::assembler::serve(frontend);
     }
+
+    return reaver::assembler::run(frontend, engine, dlog);
 }
 
 catch (reaver::exception & e)
@@ -0,0 +1,425 @@
+/**
+ * Reaver Project Assembler License
+ *
+ * Copyright © 2014 Michał "Griwes" Dominiak
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation is required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ **/
+
+#include <array>
+
+#include <sys/stat.h>
+
+#include "linker.h"
+#include "sections.h"
+#include "../object/elf_traits.h"
+#include "../../utils/descriptor.h"
+#include "../../utils/statistics.h"
+#include "../../utils/trace.h"
+
+namespace
+{
+    constexpr std::uint64_t _page_size = 0x1000;
+
+    // umask() can only be read by setting it, which races with files created by other threads (batch workers, the
+    // server); it is read once, while the library is loaded and nothing else runs yet
+    const mode_t _umask = []()
+    {
+        auto mask = ::umask(0);
+        ::umask(mask);
+        return mask;
+    }();
+
+    std::uint64_t _align(std::uint64_t value, std::uint64_t alignment)
+    {
+        return alignment > 1 ? (value + alignment - 1) / alignment * alignment : value;
+    }
+
+    template<typename T>
+    void _append(std::vector<char> & buffer, const T & value)
+    {
+        auto begin = reinterpret_cast<const char *>(&value);
+        buffer.insert(buffer.end(), begin, begin + sizeof(T));
+    }
+}
+
+void reaver::assembler::linker_output::operator()(const std::unique_ptr<reaver::assembler::object> & obj) const
+{
+    if (_format != format::executable::format::elf32 && _format != format::executable::format::elf64)
+    {
+        _engine.push(exception(logger::crash) << "linking is only implemented for ELF formats, use -s to disable it.");
+        throw std::move(_engine);
+    }
+
+    bool elf64 = _format == format::executable::format::elf64;
+
+    if (elf64 != (_triple.arch() == target::arch::x86_64))
+    {
+        _engine.push(exception(logger::error) << "output format " << (elf64 ? "elf64" : "elf32")
+            << " does not match the target architecture.");
+        throw std::move(_engine);
+    }
+
+    if (elf64)
+    {
+        _link<elf::elf64_traits>(*obj, EM_X86_64, 0x400000);
+    }
+
+    else
+    {
+        _link<elf::elf32_traits>(*obj, EM_386, 0x8048000);
+    }
+}
+
+template<typename Elf>
+void reaver::assembler::linker_output::_link(object & obj, std::uint16_t machine, std::uint64_t base) const
+{
+    if (_front.gc_sections())
+    {
+        utils::statistics::scope timer{ _front.statistics(), "output/gc-sections" };
+        collect_sections(obj, "_start");
+    }
+
+    if (_front.icf())
+    {
+        utils::statistics::scope timer{ _front.statistics(), "output/icf" };
+        fold_identical_sections(obj);
+    }
+
+    auto & sections = obj.sections();
+
+    std::vector<std::size_t> code, data, bss, other;
+    for (std::size_t i = 0; i < sections.size(); ++i)
+    {
+        if (!sections[i].allocated)
+        {
+            other.push_back(i);
+        }
+
+        else if (sections[i].executable)
+        {
+            code.push_back(i);
+        }
+
+        else if (sections[i].name == ".bss")
+        {
+            bss.push_back(i);
+        }
+
+        else
+        {
+            data.push_back(i);
+        }
+    }
+
+    std::size_t segments = 1 + !(data.empty() && bss.empty());
+    std::vector<std::uint64_t> addresses(sections.size()), offsets(sections.size());
+
+    std::uint64_t offset = sizeof(typename Elf::header) + segments * sizeof(typename Elf::program_header);
+    for (auto i : code)
+    {
+        offset = _align(offset, sections[i].alignment);
+        offsets[i] = offset;
+        addresses[i] = base + offset;
+        offset += sections[i].size();
+    }
+
+    auto code_size = offset;
+
+    auto data_offset = offset;
+    auto data_address = _align(base + offset, _page_size) + offset % _page_size;
+    for (auto i : data)
+    {
+        offset = _align(offset, sections[i].alignment);
+        offsets[i] = offset;
+        addresses[i] = data_address + (offset - data_offset);
+        offset += sections[i].size();
+    }
+
+    auto data_file_size = offset - data_offset;
+    auto data_end = data_address + data_file_size;
+    for (auto i : bss)
+    {
+        data_end = _align(data_end, sections[i].alignment);
+        offsets[i] = offset;
+        addresses[i] = data_end;
+        data_end += sections[i].size();
+    }
+
+    for (auto i : other)
+    {
+        offset = _align(offset, sections[i].alignment);
+        offsets[i] = offset;
+        offset += sections[i].size();
+    }
+
+    std::map<std::string, std::uint64_t> values;
+    std::size_t errors = 0;
+
+    for (std::size_t i = 0; i < sections.size(); ++i)
+    {
+        values[sections[i].name] = addresses[i];
+    }
+
+    std::map<std::string, std::size_t> indices;
+    for (std::size_t i = 0; i < sections.size(); ++i)
+    {
+        indices[sections[i].name] = i;
+    }
+
+    for (const auto & sym : obj.symbols())
+    {
+        if (!sym.second.defined())
+        {
+            _engine.push(exception(logger::error) << "undefined reference to `" << sym.first << "`.");
+            ++errors;
+            continue;
+        }
+
+        values[sym.first] = addresses[indices.at(sym.second.section)] + sym.second.offset;
+    }
+
+    if (!obj.symbols().count("_start") || !obj.symbols().at("_start").defined())
+    {
+        _engine.push(exception(logger::error) << "entry symbol `_start` is not defined.");
+        ++errors;
+    }
+
+    if (errors)
+    {
+        throw std::move(_engine);
+    }
+
+    {
+        utils::statistics::scope timer{ _front.statistics(), "output/relocation" };
+
+        for (std::size_t i = 0; i < sections.size(); ++i)
+        {
+            auto & sect = sections[i];
+
+            for (const auto & reloc : sect.relocations)
+            {
+                if (!relocate(sect.blob.data() + sect.blob_offset(reloc.offset), reloc, values.at(reloc.symbol), addresses[i]))
+                {
+                    _engine.push(exception(logger::error) << "relocation against `" << reloc.symbol << "` in section `"
+                        << sect.name << "` does not fit in its field.");
+                    ++errors;
+                }
+            }
+        }
+    }
+
+    if (errors)
+    {
+        throw std::move(_engine);
+    }
+
+    utils::statistics::scope timer{ _front.statistics(), "output/elf" };
+
+    std::string section_names{ '\0' };
+    std::vector<std::uint32_t> name_offsets;
+    for (const auto & sect : sections)
+    {
+        name_offsets.push_back(section_names.size());
+        section_names.append(sect.name).push_back('\0');
+    }
+
+    for (auto name : { ".symtab", ".strtab", ".shstrtab" })
+    {
+        name_offsets.push_back(section_names.size());
+        section_names.append(name).push_back('\0');
+    }
+
+    std::vector<char> symbols, strings{ '\0' };
+    std::size_t first_global = 1;
+    _append(symbols, typename Elf::symbol{});
+
+    for (auto global : { false, true })
+    {
+        if (global)
+        {
+            first_global = symbols.size() / sizeof(typename Elf::symbol);
+        }
+
+        for (const auto & sym : obj.symbols())
+        {
+            if (sym.second.global != global)
+            {
+                continue;
+            }
+
+            typename Elf::symbol entry{};
+            entry.st_name = strings.size();
+            entry.st_info = Elf::symbol_info(global ? STB_GLOBAL : STB_LOCAL, STT_NOTYPE);
+            entry.st_shndx = indices.at(sym.second.section) + 1;
+            entry.st_value = values.at(sym.first);
+            _append(symbols, entry);
+
+            strings.insert(strings.end(), sym.first.begin(), sym.first.end());
+            strings.push_back('\0');
+        }
+    }
+
+    offset = _align(offset, Elf::word_size);
+    auto symbols_offset = offset;
+    auto strings_offset = symbols_offset + symbols.size();
+    auto names_offset = strings_offset + strings.size();
+    auto section_headers_offset = _align(names_offset + section_names.size(), Elf::word_size);
+
+    std::vector<char> headers;
+
+    typename Elf::header header{};
+    std::copy(ELFMAG, ELFMAG + SELFMAG, header.e_ident);
+    header.e_ident[EI_CLASS] = Elf::elf_class;
+    header.e_ident[EI_DATA] = ELFDATA2LSB;
+    header.e_ident[EI_VERSION] = EV_CURRENT;
+    header.e_ident[EI_OSABI] = ELFOSABI_SYSV;
+    header.e_type = ET_EXEC;
+    header.e_machine = machine;
+    header.e_version = EV_CURRENT;
+    header.e_entry = values.at("_start");
+    header.e_phoff = sizeof(typename Elf::header);
+    header.e_shoff = section_headers_offset;
+    header.e_ehsize = sizeof(typename Elf::header);
+    header.e_phentsize = sizeof(typename Elf::program_header);
+    header.e_phnum = segments;
+    header.e_shentsize = sizeof(typename Elf::section_header);
+    header.e_shnum = sections.size() + 4;
+    header.e_shstrndx = sections.size() + 3;
+    _append(headers, header);
+
+    typename Elf::program_header text{};
+    text.p_type = PT_LOAD;
+    text.p_flags = PF_R | PF_X;
+    text.p_offset = 0;
+    text.p_vaddr = text.p_paddr = base;
+    text.p_filesz = text.p_memsz = code_size;
+    text.p_align = _page_size;
+    _append(headers, text);
+
+    if (segments > 1)
+    {
+        typename Elf::program_header rw{};
+        rw.p_type = PT_LOAD;
+        rw.p_flags = PF_R | PF_W;
+        rw.p_offset = data_offset;
+        rw.p_vaddr = rw.p_paddr = data_address;
+        rw.p_filesz = data_file_size;
+        rw.p_memsz = data_end - data_address;
+        rw.p_align = _page_size;
+        _append(headers, rw);
+    }
+
+    std::vector<char> section_headers;
+    _append(section_headers, typename Elf::section_header{});
+
+    for (std::size_t i = 0; i < sections.size(); ++i)
+    {
+        const auto & sect = sections[i];
+        bool nobits = sect.name == ".bss";
+
+        typename Elf::section_header entry{};
+        entry.sh_name = name_offsets[i];
+        entry.sh_type = nobits ? SHT_NOBITS : SHT_PROGBITS;
+        entry.sh_flags = (sect.allocated ? SHF_ALLOC : 0) | (sect.writable ? SHF_WRITE : 0)
+            | (sect.executable ? SHF_EXECINSTR : 0);
+        entry.sh_addr = addresses[i];
+        entry.sh_offset = offsets[i];
+        entry.sh_size = sect.size();
+        entry.sh_addralign = sect.alignment;
+        _append(section_headers, entry);
+    }
+
+    typename Elf::section_header symtab{};
+    symtab.sh_name = name_offsets[sections.size()];
+    symtab.sh_type = SHT_SYMTAB;
+    symtab.sh_offset = symbols_offset;
+    symtab.sh_size = symbols.size();
+    symtab.sh_link = sections.size() + 2;
+    symtab.sh_info = first_global;
+    symtab.sh_addralign = Elf::word_size;
+    symtab.sh_entsize = sizeof(typename Elf::symbol);
+    _append(section_headers, symtab);
+
+    typename Elf::section_header strtab{};
+    strtab.sh_name = name_offsets[sections.size() + 1];
+    strtab.sh_type = SHT_STRTAB;
+    strtab.sh_offset = strings_offset;
+    strtab.sh_size = strings.size();
+    strtab.sh_addralign = 1;
+    _append(section_headers, strtab);
+
+    typename Elf::section_header shstrtab{};
+    shstrtab.sh_name = name_offsets[sections.size() + 2];
+    shstrtab.sh_type = SHT_STRTAB;
+    shstrtab.sh_offset = names_offset;
+    shstrtab.sh_size = section_names.size();
+    shstrtab.sh_addralign = 1;
+    _append(section_headers, shstrtab);
+
+    static const std::array<char, _page_size> zeros = {};
+
+    std::vector<iovec> iovecs;
+    std::vector<utils::file_extent> files;
+    std::uint64_t position = 0;
+
+    auto emit = [&](std::uint64_t at, const char * data, std::size_t size)
+    {
+        while (position < at)
+        {
+            auto gap = std::min<std::uint64_t>(at - position, zeros.size());
+            iovecs.push_back({ const_cast<char *>(zeros.data()), gap });
+            position += gap;
+        }
+
+        if (size)
+        {
+            iovecs.push_back({ const_cast<char *>(data), size });
+            position += size;
+        }
+    };
+
+    emit(0, headers.data(), headers.size());
+
+    for (auto group : { &code, &data, &other })
+    {
+        for (auto i : *group)
+        {
+            emit(offsets[i], nullptr, 0);
+            sections[i].visit([&](const char * data, std::size_t size){ emit(position, data, size); },
+                [&](const utils::file_extent & extent)
+                {
+                    iovecs.push_back({ nullptr, extent.size });
+                    files.push_back(extent);
+                    position += extent.size;
+                });
+        }
+    }
+
+    emit(symbols_offset, symbols.data(), symbols.size());
+    emit(strings_offset, strings.data(), strings.size());
+    emit(names_offset, section_names.data(), section_names.size());
+    emit(section_headers_offset, section_headers.data(), section_headers.size());
+
+    utils::trace::span span{ _front.trace(), "write", "output" };
+    utils::write_all(_front.output(), _front.output_descriptor(), std::move(iovecs), files);
+
+    if (_front.output_descriptor() >= 0 && utils::seekable(_front.output_descriptor()))
+    {
+        ::fchmod(_front.output_descriptor(), 0777 & ~_umask);
+    }
+}
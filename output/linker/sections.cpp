@@ -0,0 +1,282 @@
+/**
+ * Reaver Project Assembler License
+ *
+ * Copyright © 2014 Michał "Griwes" Dominiak
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation is required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ **/
+
+#include <set>
+#include <string_view>
+#include <functional>
+
+#include <boost/optional.hpp>
+
+#include "sections.h"
+#include "../../utils/parallel.h"
+
+namespace
+{
+    boost::optional<std::size_t> _target(const reaver::assembler::object & obj, const std::map<std::string, std::size_t> & indices,
+        const std::string & name)
+    {
+        auto sym = obj.symbols().find(name);
+        if (sym != obj.symbols().end() && sym->second.defined())
+        {
+            return indices.at(sym->second.section);
+        }
+
+        auto sect = indices.find(name);
+        if (sect != indices.end())
+        {
+            return sect->second;
+        }
+
+        return {};
+    }
+
+    std::map<std::string, std::size_t> _indices(const reaver::assembler::object & obj)
+    {
+        std::map<std::string, std::size_t> ret;
+
+        for (std::size_t i = 0; i < obj.sections().size(); ++i)
+        {
+            ret.emplace(obj.sections()[i].name, i);
+        }
+
+        return ret;
+    }
+}
+
+void reaver::assembler::collect_sections(object & obj, const std::string & entry)
+{
+    auto & sections = obj.sections();
+    auto indices = _indices(obj);
+
+    auto root = obj.symbols().find(entry);
+    if (root == obj.symbols().end() || !root->second.defined())
+    {
+        return;
+    }
+
+    std::vector<bool> live(sections.size());
+    std::vector<std::size_t> worklist{ indices.at(root->second.section) };
+    live[worklist.back()] = true;
+
+    for (std::size_t i = 0; i < sections.size(); ++i)
+    {
+        if (!sections[i].allocated)
+        {
+            live[i] = true;
+        }
+    }
+
+    while (!worklist.empty())
+    {
+        auto current = worklist.back();
+        worklist.pop_back();
+
+        for (const auto & reloc : sections[current].relocations)
+        {
+            auto target = _target(obj, indices, reloc.symbol);
+
+            if (target && !live[*target])
+            {
+                live[*target] = true;
+                worklist.push_back(*target);
+            }
+        }
+    }
+
+    for (auto & sect : sections)
+    {
+        if (sect.allocated)
+        {
+            continue;
+        }
+
+        sect.relocations.erase(std::remove_if(sect.relocations.begin(), sect.relocations.end(), [&](const relocation & reloc){
+            auto target = _target(obj, indices, reloc.symbol);
+            return target && !live[*target];
+        }), sect.relocations.end());
+    }
+
+    std::set<std::string> referenced;
+    for (std::size_t i = 0; i < sections.size(); ++i)
+    {
+        if (live[i])
+        {
+            for (const auto & reloc : sections[i].relocations)
+            {
+                referenced.insert(reloc.symbol);
+            }
+        }
+    }
+
+    auto & symbols = obj.symbols();
+    for (auto it = symbols.begin(); it != symbols.end(); )
+    {
+        if (it->second.defined() ? !live[indices.at(it->second.section)] : !referenced.count(it->first))
+        {
+            it = symbols.erase(it);
+        }
+
+        else
+        {
+            ++it;
+        }
+    }
+
+    obj.remove_sections([&](const section & sect){ return !live[indices.at(sect.name)]; });
+}
+
+void reaver::assembler::fold_identical_sections(object & obj)
+{
+    auto & sections = obj.sections();
+    auto indices = _indices(obj);
+
+    std::vector<std::size_t> candidates;
+    for (std::size_t i = 0; i < sections.size(); ++i)
+    {
+        // sections embedding files are left alone; comparing them would mean reading the files in
+        if (sections[i].allocated && sections[i].executable && !sections[i].blob.empty() && sections[i].files.empty())
+        {
+            candidates.push_back(i);
+        }
+    }
+
+    std::vector<std::size_t> hashes(candidates.size());
+    utils::parallel_for(candidates.size(), [&](std::size_t i)
+    {
+        const auto & blob = sections[candidates[i]].blob;
+        hashes[i] = std::hash<std::string_view>{}({ blob.data(), blob.size() });
+    });
+
+    std::vector<std::size_t> replacement(sections.size());
+    for (std::size_t i = 0; i < sections.size(); ++i)
+    {
+        replacement[i] = i;
+    }
+
+    auto resolve = [&](const std::string & name, std::int64_t addend)
+    {
+        auto sym = obj.symbols().find(name);
+        if (sym != obj.symbols().end() && sym->second.defined())
+        {
+            return std::make_pair(replacement[indices.at(sym->second.section)], addend + static_cast<std::int64_t>(
+                sym->second.offset));
+        }
+
+        auto sect = indices.find(name);
+        if (sect != indices.end())
+        {
+            return std::make_pair(replacement[sect->second], addend);
+        }
+
+        return std::make_pair(sections.size(), addend);
+    };
+
+    auto equal = [&](const section & lhs, const section & rhs)
+    {
+        if (lhs.blob != rhs.blob || lhs.alignment != rhs.alignment || lhs.writable != rhs.writable
+            || lhs.relocations.size() != rhs.relocations.size())
+        {
+            return false;
+        }
+
+        for (std::size_t i = 0; i < lhs.relocations.size(); ++i)
+        {
+            const auto & l = lhs.relocations[i];
+            const auto & r = rhs.relocations[i];
+
+            if (l.offset != r.offset || l.type != r.type)
+            {
+                return false;
+            }
+
+            auto lt = resolve(l.symbol, l.addend);
+            auto rt = resolve(r.symbol, r.addend);
+
+            if (lt != rt || (lt.first == sections.size() && l.symbol != r.symbol))
+            {
+                return false;
+            }
+        }
+
+        return true;
+    };
+
+    std::map<std::size_t, std::vector<std::size_t>> groups;
+    for (std::size_t i = 0; i < candidates.size(); ++i)
+    {
+        groups[hashes[i]].push_back(candidates[i]);
+    }
+
+    bool changed = true;
+    while (changed)
+    {
+        changed = false;
+
+        for (auto & group : groups)
+        {
+            auto & members = group.second;
+
+            for (std::size_t i = 0; i < members.size(); ++i)
+            {
+                for (std::size_t j = i + 1; j < members.size(); )
+                {
+                    if (equal(sections[members[i]], sections[members[j]]))
+                    {
+                        replacement[members[j]] = members[i];
+                        members.erase(members.begin() + j);
+                        changed = true;
+                    }
+
+                    else
+                    {
+                        ++j;
+                    }
+                }
+            }
+        }
+    }
+
+    for (auto & sym : obj.symbols())
+    {
+        if (sym.second.defined())
+        {
+            sym.second.section = sections[replacement[indices.at(sym.second.section)]].name;
+        }
+    }
+
+    for (auto & sect : sections)
+    {
+        for (auto & reloc : sect.relocations)
+        {
+            auto it = indices.find(reloc.symbol);
+            if (it != indices.end() && !obj.symbols().count(reloc.symbol))
+            {
+                reloc.symbol = sections[replacement[it->second]].name;
+            }
+        }
+    }
+
+    obj.remove_sections([&](const section & sect){
+        auto index = indices.at(sect.name);
+        return replacement[index] != index;
+    });
+}
@@ -0,0 +1,624 @@
+/**
+ * Reaver Project Assembler License
+ *
+ * Copyright © 2014 Michał "Griwes" Dominiak
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation is required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ **/
+
+#include <cstring>
+#include <array>
+#include <algorithm>
+
+#include <elf.h>
+#include <zlib.h>
+
+#include "elf.h"
+#include "elf_traits.h"
+#include "../../utils/descriptor.h"
+#include "../../utils/parallel.h"
+
+namespace
+{
+    std::uint64_t _align(std::uint64_t value, std::uint64_t alignment)
+    {
+        return alignment > 1 ? (value + alignment - 1) / alignment * alignment : value;
+    }
+
+    bool _nobits(const reaver::assembler::section & sect)
+    {
+        return sect.name == ".bss";
+    }
+
+    std::size_t _relocation_width(reaver::assembler::relocation_type type)
+    {
+        using reaver::assembler::relocation_type;
+
+        switch (type)
+        {
+            case relocation_type::absolute8:
+            case relocation_type::relative8:
+                return 1;
+
+            case relocation_type::absolute16:
+            case relocation_type::relative16:
+                return 2;
+
+            case relocation_type::absolute64:
+                return 8;
+
+            default:
+                return 4;
+        }
+    }
+
+    template<typename T>
+    void _append(std::vector<char> & buffer, const T & value)
+    {
+        auto begin = reinterpret_cast<const char *>(&value);
+        buffer.insert(buffer.end(), begin, begin + sizeof(T));
+    }
+
+    template<typename Elf>
+    std::vector<char> _compress(const reaver::assembler::section & sect, reaver::error_engine & engine)
+    {
+        std::vector<char> contents;
+        const char * data = sect.blob.data();
+
+        if (!sect.files.empty() || (!Elf::explicit_addends && !sect.relocations.empty()))
+        {
+            contents = sect.contents();
+            data = contents.data();
+        }
+
+        if (!Elf::explicit_addends)
+        {
+            for (const auto & reloc : sect.relocations)
+            {
+                auto addend = static_cast<std::uint64_t>(reloc.addend);
+
+                for (std::size_t byte = 0; byte < _relocation_width(reloc.type); ++byte)
+                {
+                    contents[reloc.offset + byte] = static_cast<char>(addend >> (byte * 8));
+                }
+            }
+        }
+
+        typename Elf::compression_header header{};
+        header.ch_type = ELFCOMPRESS_ZLIB;
+        header.ch_size = sect.size();
+        header.ch_addralign = sect.alignment;
+
+        std::vector<char> ret;
+        _append(ret, header);
+
+        auto bound = ::compressBound(sect.size());
+        ret.resize(sizeof(header) + bound);
+
+        if (::compress2(reinterpret_cast<Bytef *>(ret.data() + sizeof(header)), &bound, reinterpret_cast<const Bytef *>(data),
+            sect.size(), Z_BEST_SPEED) != Z_OK)
+        {
+            engine.push(reaver::exception(reaver::logger::error) << "failed to compress section `" << sect.name << "`.");
+            throw std::move(engine);
+        }
+
+        ret.resize(sizeof(header) + bound);
+        return ret;
+    }
+}
+
+reaver::assembler::elf_writer::elf_writer(const object & obj, bool elf64, std::uint16_t machine, error_engine & engine)
+    : _object{ obj }, _elf64{ elf64 }, _machine{ machine }
+{
+    if (_elf64)
+    {
+        _layout<elf::elf64_traits>(engine);
+    }
+
+    else
+    {
+        _layout<elf::elf32_traits>(engine);
+    }
+}
+
+template<typename Elf>
+void reaver::assembler::elf_writer::_layout(error_engine & engine)
+{
+    const auto & sections = _object.sections();
+    std::size_t errors = 0;
+
+    _symbols.push_back(nullptr);
+    for (std::size_t i = 0; i < sections.size(); ++i)
+    {
+        _symbols.push_back(nullptr);
+    }
+
+    for (auto global : { false, true })
+    {
+        if (global)
+        {
+            _first_global = _symbols.size();
+        }
+
+        for (const auto & sym : _object.symbols())
+        {
+            if (sym.second.global == global)
+            {
+                _symbol_indices[sym.first] = _symbols.size();
+                _symbols.push_back(&sym.second);
+                _strings_size += sym.first.size() + 1;
+            }
+        }
+    }
+
+    for (std::size_t i = 0; i < sections.size(); ++i)
+    {
+        _symbol_indices.emplace(sections[i].name, i + 1);
+    }
+
+    ++_strings_size;
+
+    _section_names_table.push_back('\0');
+    auto add_name = [&](const std::string & name)
+    {
+        _section_names.push_back(_section_names_table.size());
+        _section_names_table.append(name);
+        _section_names_table.push_back('\0');
+    };
+
+    _section_names.push_back(0);
+    for (const auto & sect : sections)
+    {
+        add_name(sect.name);
+    }
+
+    _relocation_types.resize(sections.size());
+    for (std::size_t i = 0; i < sections.size(); ++i)
+    {
+        if (sections[i].relocations.empty())
+        {
+            continue;
+        }
+
+        _relocation_sections.push_back(i);
+        add_name(Elf::relocation_prefix + sections[i].name);
+
+        for (const auto & reloc : sections[i].relocations)
+        {
+            std::uint32_t type = 0;
+
+            if (!Elf::relocation_type(reloc.type, type))
+            {
+                engine.push(exception(logger::error) << "relocation against `" << reloc.symbol << "` in section `"
+                    << sections[i].name << "` cannot be represented in " << (_elf64 ? "elf64" : "elf32") << ".");
+                ++errors;
+            }
+
+            _relocation_types[i].push_back(type);
+        }
+    }
+
+    add_name(".symtab");
+    add_name(".strtab");
+    add_name(".shstrtab");
+    _section_count = _section_names.size();
+
+    if (errors)
+    {
+        throw std::move(engine);
+    }
+
+    std::uint64_t offset = 0;
+    auto add_piece = [&](_kind kind, std::size_t section, std::uint64_t size, std::uint64_t alignment)
+    {
+        offset = _align(offset, alignment);
+        _pieces.push_back({ kind, section, offset, size, {}, {}, {} });
+        offset += size;
+    };
+
+    add_piece(_kind::header, 0, sizeof(typename Elf::header), 1);
+
+    for (std::size_t i = 0; i < sections.size(); ++i)
+    {
+        if (sections[i].compressed && sections[i].size())
+        {
+            auto compressed = _compress<Elf>(sections[i], engine);
+            add_piece(_kind::section, i, compressed.size(), Elf::word_size);
+            _pieces.back().buffer = std::move(compressed);
+            continue;
+        }
+
+        add_piece(_kind::section, i, _nobits(sections[i]) ? 0 : sections[i].size(), sections[i].alignment);
+    }
+
+    for (auto i : _relocation_sections)
+    {
+        add_piece(_kind::relocations, i, sections[i].relocations.size() * sizeof(typename Elf::relocation), Elf::word_size);
+    }
+
+    add_piece(_kind::symbols, 0, _symbols.size() * sizeof(typename Elf::symbol), Elf::word_size);
+    add_piece(_kind::strings, 0, _strings_size, 1);
+    add_piece(_kind::section_names, 0, _section_names_table.size(), 1);
+    add_piece(_kind::section_headers, 0, _section_count * sizeof(typename Elf::section_header), Elf::word_size);
+
+    _size = offset;
+}
+
+void reaver::assembler::elf_writer::serialize(std::size_t i)
+{
+    if (_elf64)
+    {
+        _serialize<elf::elf64_traits>(_pieces[i]);
+    }
+
+    else
+    {
+        _serialize<elf::elf32_traits>(_pieces[i]);
+    }
+}
+
+template<typename Elf>
+void reaver::assembler::elf_writer::_serialize(_piece & piece)
+{
+    const auto & sections = _object.sections();
+    auto & buffer = piece.buffer;
+
+    // the bytes of a section are written from the section itself; only the relocation patches of elf32 are copied, and
+    // those reserve their own space
+    if (piece.kind != _kind::section)
+    {
+        buffer.reserve(piece.size);
+    }
+
+    switch (piece.kind)
+    {
+        case _kind::header:
+        {
+            typename Elf::header header{};
+
+            std::memcpy(header.e_ident, ELFMAG, SELFMAG);
+            header.e_ident[EI_CLASS] = Elf::elf_class;
+            header.e_ident[EI_DATA] = ELFDATA2LSB;
+            header.e_ident[EI_VERSION] = EV_CURRENT;
+            header.e_ident[EI_OSABI] = ELFOSABI_SYSV;
+            header.e_type = ET_REL;
+            header.e_machine = _machine;
+            header.e_version = EV_CURRENT;
+            header.e_shoff = _pieces.back().offset;
+            header.e_ehsize = sizeof(typename Elf::header);
+            header.e_shentsize = sizeof(typename Elf::section_header);
+            header.e_shnum = _section_count;
+            header.e_shstrndx = _section_count - 1;
+
+            _append(buffer, header);
+            break;
+        }
+
+        case _kind::section:
+        {
+            const auto & sect = sections[piece.section];
+
+            if (_nobits(sect) || !sect.size() || sect.compressed)
+            {
+                break;
+            }
+
+            auto bytes = [&](const char * data, std::size_t size){ piece.data.push_back({ const_cast<char *>(data), size }); };
+            auto file = [&](const utils::file_extent & extent)
+            {
+                piece.data.push_back({ nullptr, extent.size });
+                piece.files.push_back(extent);
+            };
+
+            if (Elf::explicit_addends || sect.relocations.empty())
+            {
+                sect.visit(bytes, file);
+                break;
+            }
+
+            std::vector<const relocation *> patches;
+            std::size_t patch_size = 0;
+            for (const auto & reloc : sect.relocations)
+            {
+                patches.push_back(&reloc);
+                patch_size += _relocation_width(reloc.type);
+            }
+
+            std::sort(patches.begin(), patches.end(), [](auto lhs, auto rhs){ return lhs->offset < rhs->offset; });
+            buffer.reserve(patch_size);
+
+            std::uint64_t position = 0;
+            for (auto reloc : patches)
+            {
+                auto width = _relocation_width(reloc->type);
+                auto addend = static_cast<std::uint64_t>(reloc->addend);
+
+                sect.visit(position, reloc->offset, bytes, file);
+
+                auto patch = buffer.data() + buffer.size();
+                for (std::size_t byte = 0; byte < width; ++byte)
+                {
+                    buffer.push_back(static_cast<char>(addend >> (byte * 8)));
+                }
+
+                piece.data.push_back({ patch, width });
+                position = reloc->offset + width;
+            }
+
+            sect.visit(position, sect.size(), bytes, file);
+            return;
+        }
+
+        case _kind::relocations:
+        {
+            const auto & sect = sections[piece.section];
+
+            for (std::size_t i = 0; i < sect.relocations.size(); ++i)
+            {
+                const auto & reloc = sect.relocations[i];
+
+                typename Elf::relocation entry{};
+                entry.r_offset = reloc.offset;
+                entry.r_info = Elf::relocation_info(_symbol_indices.at(reloc.symbol), _relocation_types[piece.section][i]);
+
+                if constexpr (Elf::explicit_addends)
+                {
+                    entry.r_addend = reloc.addend;
+                }
+
+                _append(buffer, entry);
+            }
+
+            break;
+        }
+
+        case _kind::symbols:
+        {
+            std::uint32_t name = 1;
+
+            for (std::size_t i = 0; i < _symbols.size(); ++i)
+            {
+                typename Elf::symbol entry{};
+
+                if (i == 0)
+                {
+                }
+
+                else if (!_symbols[i])
+                {
+                    entry.st_info = Elf::symbol_info(STB_LOCAL, STT_SECTION);
+                    entry.st_shndx = i;
+                }
+
+                else
+                {
+                    const auto & sym = *_symbols[i];
+
+                    entry.st_name = name;
+                    entry.st_info = Elf::symbol_info(sym.global ? STB_GLOBAL : STB_LOCAL, STT_NOTYPE);
+                    entry.st_value = sym.offset;
+                    entry.st_shndx = SHN_UNDEF;
+
+                    if (sym.defined())
+                    {
+                        for (std::size_t j = 0; j < sections.size(); ++j)
+                        {
+                            if (sections[j].name == sym.section)
+                            {
+                                entry.st_shndx = j + 1;
+                                break;
+                            }
+                        }
+                    }
+
+                    name += sym.name.size() + 1;
+                }
+
+                _append(buffer, entry);
+            }
+
+            break;
+        }
+
+        case _kind::strings:
+        {
+            buffer.push_back('\0');
+
+            for (std::size_t i = 1; i < _symbols.size(); ++i)
+            {
+                if (_symbols[i])
+                {
+                    buffer.insert(buffer.end(), _symbols[i]->name.begin(), _symbols[i]->name.end());
+                    buffer.push_back('\0');
+                }
+            }
+
+            break;
+        }
+
+        case _kind::section_names:
+        {
+            piece.data.push_back({ const_cast<char *>(_section_names_table.data()), _section_names_table.size() });
+            return;
+        }
+
+        case _kind::section_headers:
+        {
+            typename Elf::section_header null{};
+            _append(buffer, null);
+
+            auto piece_of = [&](_kind kind, std::size_t section) -> const _piece &
+            {
+                return *std::find_if(_pieces.begin(), _pieces.end(), [&](const _piece & p){
+                    return p.kind == kind && p.section == section;
+                });
+            };
+
+            for (std::size_t i = 0; i < sections.size(); ++i)
+            {
+                const auto & sect = sections[i];
+                const auto & data = piece_of(_kind::section, i);
+
+                typename Elf::section_header header{};
+                header.sh_name = _section_names[i + 1];
+                header.sh_type = _nobits(sect) ? SHT_NOBITS : SHT_PROGBITS;
+                header.sh_flags = (sect.allocated ? SHF_ALLOC : 0) | (sect.writable ? SHF_WRITE : 0)
+                    | (sect.executable ? SHF_EXECINSTR : 0);
+                header.sh_offset = data.offset;
+                header.sh_size = sect.size();
+                header.sh_addralign = sect.alignment;
+
+                if (sect.compressed && sect.size())
+                {
+                    header.sh_flags |= SHF_COMPRESSED;
+                    header.sh_size = data.size;
+                    header.sh_addralign = Elf::word_size;
+                }
+
+                _append(buffer, header);
+            }
+
+            auto symbols_index = sections.size() + _relocation_sections.size() + 1;
+
+            for (std::size_t i = 0; i < _relocation_sections.size(); ++i)
+            {
+                const auto & data = piece_of(_kind::relocations, _relocation_sections[i]);
+
+                typename Elf::section_header header{};
+                header.sh_name = _section_names[sections.size() + 1 + i];
+                header.sh_type = Elf::explicit_addends ? SHT_RELA : SHT_REL;
+                header.sh_flags = SHF_INFO_LINK;
+                header.sh_offset = data.offset;
+                header.sh_size = data.size;
+                header.sh_link = symbols_index;
+                header.sh_info = _relocation_sections[i] + 1;
+                header.sh_addralign = Elf::word_size;
+                header.sh_entsize = sizeof(typename Elf::relocation);
+
+                _append(buffer, header);
+            }
+
+            typename Elf::section_header symbols{};
+            symbols.sh_name = _section_names[symbols_index];
+            symbols.sh_type = SHT_SYMTAB;
+            symbols.sh_offset = piece_of(_kind::symbols, 0).offset;
+            symbols.sh_size = piece_of(_kind::symbols, 0).size;
+            symbols.sh_link = symbols_index + 1;
+            symbols.sh_info = _first_global;
+            symbols.sh_addralign = Elf::word_size;
+            symbols.sh_entsize = sizeof(typename Elf::symbol);
+            _append(buffer, symbols);
+
+            typename Elf::section_header strings{};
+            strings.sh_name = _section_names[symbols_index + 1];
+            strings.sh_type = SHT_STRTAB;
+            strings.sh_offset = piece_of(_kind::strings, 0).offset;
+            strings.sh_size = piece_of(_kind::strings, 0).size;
+            strings.sh_addralign = 1;
+            _append(buffer, strings);
+
+            typename Elf::section_header names{};
+            names.sh_name = _section_names[symbols_index + 2];
+            names.sh_type = SHT_STRTAB;
+            names.sh_offset = piece_of(_kind::section_names, 0).offset;
+            names.sh_size = piece_of(_kind::section_names, 0).size;
+            names.sh_addralign = 1;
+            _append(buffer, names);
+
+            break;
+        }
+    }
+
+    if (!buffer.empty())
+    {
+        piece.data.push_back({ buffer.data(), buffer.size() });
+    }
+}
+
+void reaver::assembler::elf_writer::write(const frontend & front)
+{
+    static const std::array<char, 4096> zeros = {};
+
+    if (front.output_descriptor() >= 0 && front.parallel_output() && utils::seekable(front.output_descriptor()))
+    {
+        write_parallel(front.output_descriptor(), front.trace());
+        return;
+    }
+
+    std::vector<iovec> iovecs;
+    std::vector<utils::file_extent> files;
+    std::uint64_t position = 0;
+
+    for (std::size_t i = 0; i < _pieces.size(); ++i)
+    {
+        {
+            utils::trace::span span{ front.trace(), front.trace() ? "serialize " + _piece_name(i) : "", "output" };
+            serialize(i);
+        }
+
+        while (position < _pieces[i].offset)
+        {
+            auto gap = std::min<std::uint64_t>(_pieces[i].offset - position, zeros.size());
+            iovecs.push_back({ const_cast<char *>(zeros.data()), gap });
+            position += gap;
+        }
+
+        iovecs.insert(iovecs.end(), _pieces[i].data.begin(), _pieces[i].data.end());
+        files.insert(files.end(), _pieces[i].files.begin(), _pieces[i].files.end());
+        position += _pieces[i].size;
+    }
+
+    utils::trace::span span{ front.trace(), "write", "output" };
+    utils::write_all(front.output(), front.output_descriptor(), std::move(iovecs), files);
+}
+
+void reaver::assembler::elf_writer::write_parallel(int fd, utils::trace * trace)
+{
+    utils::preallocate(fd, _size);
+
+    utils::parallel_for(_pieces.size(), [&](std::size_t i)
+    {
+        utils::trace::span span{ trace, trace ? "write " + _piece_name(i) : "", "output" };
+        serialize(i);
+        utils::pwrite_all(fd, _pieces[i].data, _pieces[i].offset, _pieces[i].files);
+    });
+}
+
+std::string reaver::assembler::elf_writer::_piece_name(std::size_t i) const
+{
+    const auto & piece = _pieces[i];
+
+    switch (piece.kind)
+    {
+        case _kind::header:
+            return "ELF header";
+        case _kind::section:
+            return _object.sections()[piece.section].name;
+        case _kind::relocations:
+            return "relocations for " + _object.sections()[piece.section].name;
+        case _kind::symbols:
+            return ".symtab";
+        case _kind::strings:
+            return ".strtab";
+        case _kind::section_names:
+            return ".shstrtab";
+        case _kind::section_headers:
+            return "section headers";
+    }
+
+    return "";
+}
@@ -0,0 +1,129 @@
+/**
+ * Reaver Project Assembler License
+ *
+ * Copyright © 2014 Michał "Griwes" Dominiak
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation is required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ **/
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <map>
+
+#include <sys/uio.h>
+
+#include <reaver/error.h>
+
+#include "../../frontend/frontend.h"
+#include "../../generator/object.h"
+#include "../../utils/descriptor.h"
+#include "../../utils/trace.h"
+
+namespace reaver
+{
+    namespace assembler
+    {
+        class elf_writer
+        {
+        public:
+            elf_writer(const object &, bool, std::uint16_t, error_engine &);
+
+            std::uint64_t size() const
+            {
+                return _size;
+            }
+
+            std::size_t pieces() const
+            {
+                return _pieces.size();
+            }
+
+            std::uint64_t offset(std::size_t i) const
+            {
+                return _pieces[i].offset;
+            }
+
+            void serialize(std::size_t);
+
+            const std::vector<iovec> & iovecs(std::size_t i) const
+            {
+                return _pieces[i].data;
+            }
+
+            // the extents for the iovecs with a null base in `iovecs(i)`
+            const std::vector<utils::file_extent> & files(std::size_t i) const
+            {
+                return _pieces[i].files;
+            }
+
+            void write(const frontend &);
+            void write_parallel(int, utils::trace * = nullptr);
+
+        private:
+            enum class _kind
+            {
+                header,
+                section,
+                relocations,
+                symbols,
+                strings,
+                section_names,
+                section_headers
+            };
+
+            struct _piece
+            {
+                _kind kind;
+                std::size_t section;
+                std::uint64_t offset;
+                std::uint64_t size;
+                std::vector<char> buffer;
+                std::vector<iovec> data;
+                std::vector<utils::file_extent> files;
+            };
+
+            template<typename Elf>
+            void _layout(error_engine &);
+
+            template<typename Elf>
+            void _serialize(_piece &);
+
+            std::string _piece_name(std::size_t) const;
+
+            const object & _object;
+            bool _elf64;
+            std::uint16_t _machine;
+
+            std::vector<_piece> _pieces;
+            std::uint64_t _size = 0;
+
+            std::vector<const symbol *> _symbols;
+            std::map<std::string, std::size_t> _symbol_indices;
+            std::size_t _first_global = 0;
+            std::uint64_t _strings_size = 0;
+
+            std::vector<std::size_t> _relocation_sections;
+            std::vector<std::vector<std::uint32_t>> _relocation_types;
+            std::vector<std::uint32_t> _section_names;
+            std::string _section_names_table;
+            std::size_t _section_count = 0;
+        };
+    }
+}
@@ -0,0 +1,120 @@
+/**
+ * Reaver Project Assembler License
+ *
+ * Copyright © 2014 Michał "Griwes" Dominiak
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation is required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ **/
+
+#pragma once
+
+#include <cstdint>
+
+#include <elf.h>
+
+#include "../../generator/object.h"
+
+namespace reaver
+{
+    namespace assembler
+    {
+        namespace elf
+        {
+            struct elf32_traits
+            {
+                using header = Elf32_Ehdr;
+                using section_header = Elf32_Shdr;
+                using symbol = Elf32_Sym;
+                using program_header = Elf32_Phdr;
+                using relocation = Elf32_Rel;
+                using compression_header = Elf32_Chdr;
+
+                static constexpr unsigned char elf_class = ELFCLASS32;
+                static constexpr std::uint64_t word_size = 4;
+                static constexpr bool explicit_addends = false;
+                static constexpr const char * relocation_prefix = ".rel";
+
+                static auto relocation_info(std::uint32_t symbol, std::uint32_t type)
+                {
+                    return ELF32_R_INFO(symbol, type);
+                }
+
+                static auto symbol_info(unsigned char bind, unsigned char type)
+                {
+                    return ELF32_ST_INFO(bind, type);
+                }
+
+                static bool relocation_type(assembler::relocation_type type, std::uint32_t & ret)
+                {
+                    switch (type)
+                    {
+                        case relocation_type::absolute8: ret = R_386_8; return true;
+                        case relocation_type::absolute16: ret = R_386_16; return true;
+                        case relocation_type::absolute32: ret = R_386_32; return true;
+                        case relocation_type::absolute32s: ret = R_386_32; return true;
+                        case relocation_type::relative8: ret = R_386_PC8; return true;
+                        case relocation_type::relative16: ret = R_386_PC16; return true;
+                        case relocation_type::relative32: ret = R_386_PC32; return true;
+                        default: return false;
+                    }
+                }
+            };
+
+            struct elf64_traits
+            {
+                using header = Elf64_Ehdr;
+                using section_header = Elf64_Shdr;
+                using symbol = Elf64_Sym;
+                using program_header = Elf64_Phdr;
+                using relocation = Elf64_Rela;
+                using compression_header = Elf64_Chdr;
+
+                static constexpr unsigned char elf_class = ELFCLASS64;
+                static constexpr std::uint64_t word_size = 8;
+                static constexpr bool explicit_addends = true;
+                static constexpr const char * relocation_prefix = ".rela";
+
+                static auto relocation_info(std::uint64_t symbol, std::uint64_t type)
+                {
+                    return ELF64_R_INFO(symbol, type);
+                }
+
+                static auto symbol_info(unsigned char bind, unsigned char type)
+                {
+                    return ELF64_ST_INFO(bind, type);
+                }
+
+                static bool relocation_type(assembler::relocation_type type, std::uint32_t & ret)
+                {
+                    switch (type)
+                    {
+                        case relocation_type::absolute8: ret = R_X86_64_8; return true;
+                        case relocation_type::absolute16: ret = R_X86_64_16; return true;
+                        case relocation_type::absolute32: ret = R_X86_64_32; return true;
+                        case relocation_type::absolute32s: ret = R_X86_64_32S; return true;
+                        case relocation_type::absolute64: ret = R_X86_64_64; return true;
+                        case relocation_type::relative8: ret = R_X86_64_PC8; return true;
+                        case relocation_type::relative16: ret = R_X86_64_PC16; return true;
+                        case relocation_type::relative32: ret = R_X86_64_PC32; return true;
+                    }
+
+                    return false;
+                }
+            };
+        }
+    }
+}
@@ -20,10 +20,31 @@
 *
 **/
 
+#include <elf.h>
+
 #include "object.h"
+#include "elf.h"
+#include "../../utils/statistics.h"
 
-void reaver::assembler::object_output::operator()(const std::unique_ptr<reaver::format::executable::executable> &) const
+void reaver::assembler::object_output::operator()(const std::unique_ptr<reaver::assembler::object> & obj) const
 {
-    _engine.push(exception(logger::crash) << "not implemented yet: " << __PRETTY_FUNCTION__);
-    throw std::move(_engine);
+    if (_format != format::executable::format::elf32 && _format != format::executable::format::elf64)
+    {
+        _engine.push(exception(logger::crash) << "not implemented yet: " << __PRETTY_FUNCTION__);
+        throw std::move(_engine);
+    }
+
+    bool elf64 = _format == format::executable::format::elf64;
+
+    if (elf64 != (_triple.arch() == target::arch::x86_64))
+    {
+        _engine.push(exception(logger::error) << "output format " << (elf64 ? "elf64" : "elf32")
+            << " does not match the target architecture.");
+        throw std::move(_engine);
+    }
+
+    utils::statistics::scope timer{ _front.statistics(), "output/elf" };
+
+    elf_writer writer{ *obj, elf64, static_cast<std::uint16_t>(elf64 ? EM_X86_64 : EM_386), _engine };
+    writer.write(_front);
 }
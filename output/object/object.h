@@ -38,7 +38,7 @@ namespace reaver
 
             virtual ~object_output() {}
 
-            virtual void operator()(const std::unique_ptr<format::executable::executable> &) const override;
+            virtual void operator()(const std::unique_ptr<object> &) const override;
 
         private:
             const frontend & _front;
@@ -24,6 +24,7 @@
 
 #include "output.h"
 #include "object/object.h"
+#include "linker/linker.h"
 
 std::unique_ptr<reaver::assembler::output> reaver::assembler::create_output(const reaver::assembler::frontend & front,
     reaver::error_engine & engine)
@@ -33,8 +34,5 @@ std::unique_ptr<reaver::assembler::output> reaver::assembler::create_output(cons
         return std::make_unique<object_output>(front, engine);
     }
 
-    engine.push(exception(logger::crash) << "linker plugin not implemented yet, use -s to disable it.");
-    throw std::move(engine);
-//    std::unique_ptr<linker::frontend> linker_front{ new linker::assembler_frontend{ front, engine } };
-//    return std::unique_ptr<output>{ new linker_output{ linker_front, gen, engine } };
+    return std::make_unique<linker_output>(front, engine);
 }
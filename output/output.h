@@ -43,7 +43,7 @@ namespace reaver
 
             virtual ~output() {}
 
-            virtual void operator()(const std::unique_ptr<format::executable::executable> &) const = 0;
+            virtual void operator()(const std::unique_ptr<object> &) const = 0;
         };
 
         std::unique_ptr<output> create_output(const frontend &, error_engine &);
@@ -22,7 +22,12 @@
 
 #pragma once
 
+#include <array>
+#include <cstdint>
 #include <string>
+#include <vector>
+#include <map>
+#include <iterator>
 
 #include <boost/fusion/adapted.hpp>
 #include <boost/optional.hpp>
@@ -72,10 +77,13 @@ namespace reaver
             boost::recursive_wrapper<integer> second_operand;
         };
 
+        // converted to every supported format as soon as it is parsed
         struct floating_point : location
         {
             std::string literal;
-            boost::multiprecision::cpp_rational value;
+            std::uint32_t binary32;
+            std::uint64_t binary64;
+            std::array<std::uint8_t, 10> extended;
         };
 
         struct prefix : location
@@ -92,12 +100,17 @@ namespace reaver
         struct address;
         using operand = boost::variant<integer, floating_point, address, cpu_register, identifier, constant>;
 
+        // the constant terms are folded into the displacement; a symbol is added to it by a relocation
         struct address : location
         {
             boost::optional<boost::variant<integer, cpu_register, constant>> segment;
             boost::optional<cpu_register> base;
             boost::optional<boost::variant<integer, constant>> scale;
             boost::optional<boost::variant<cpu_register, integer, constant>> index;
+            boost::optional<integer> displacement;
+            boost::optional<identifier> symbol;
+            // in bits; 0 if not given
+            std::size_t size = 0;
         };
 
         struct label : location
@@ -108,9 +121,56 @@ namespace reaver
         struct instruction : location
         {
             boost::optional<prefix> prefix;
+            std::string mnemonic;
             std::vector<operand> operands;
         };
 
+        struct bits_directive : location
+        {
+            std::size_t bits;
+        };
+
+        struct section_directive : location
+        {
+            std::string name;
+        };
+
+        struct global_directive : location
+        {
+            std::string name;
+        };
+
+        struct extern_directive : location
+        {
+            std::string name;
+        };
+
+        // db, dw, dd, dq and dt; the items are encoded as they are parsed, so a long list is a single blob
+        struct data_directive : location
+        {
+            std::size_t unit;
+            std::string bytes;
+        };
+
+        // the file is not read until the output is written
+        struct incbin_directive : location
+        {
+            std::string file;
+            std::uint64_t offset = 0;
+            boost::optional<std::uint64_t> size;
+        };
+
+        // the data is generated once and its bytes are copied, so the tree does not grow with the count; instructions cannot
+        // be repeated yet
+        struct times_directive : location
+        {
+            std::uint64_t count;
+            data_directive statement;
+        };
+
+        using statement = boost::variant<instruction, label, bits_directive, section_directive, global_directive,
+            extern_directive, data_directive, incbin_directive, times_directive>;
+
         class ast
         {
         public:
@@ -118,11 +178,62 @@ namespace reaver
             {
             }
 
-            void append(const ast &);
-            void append(ast &&);
+            void append(const ast & other)
+            {
+                _statements.insert(_statements.end(), other._statements.begin(), other._statements.end());
+                _constants.insert(other._constants.begin(), other._constants.end());
+            }
+
+            void append(ast && other)
+            {
+                _statements.insert(_statements.end(), std::make_move_iterator(other._statements.begin()),
+                    std::make_move_iterator(other._statements.end()));
+                _constants.insert(other._constants.begin(), other._constants.end());
+            }
+
+            // moves the statements into a new tree; the constants stay in both, since later statements can still use them
+            ast split()
+            {
+                ast ret;
+                ret._statements = std::move(_statements);
+                ret._constants = _constants;
+                _statements.clear();
+                return ret;
+            }
+
+            void push(statement s)
+            {
+                _statements.push_back(std::move(s));
+            }
+
+            const std::vector<statement> & statements() const
+            {
+                return _statements;
+            }
+
+            void define_constant(const std::string & name, boost::multiprecision::cpp_int value)
+            {
+                _constants[name] = std::move(value);
+            }
+
+            const std::map<std::string, boost::multiprecision::cpp_int> & constants() const
+            {
+                return _constants;
+            }
+
+            bool has_constant(const std::string & name) const
+            {
+                return _constants.count(name);
+            }
+
+            boost::multiprecision::cpp_int get_constant(const std::string & name) const
+            {
+                return _constants.at(name);
+            }
 
-            bool has_constant(const std::string &) { throw std::runtime_error("TODO"); }
-            boost::multiprecision::cpp_int get_constant(const std::string &) { throw std::runtime_error("TODO"); }
+        private:
+            std::vector<statement> _statements;
+            std::map<std::string, boost::multiprecision::cpp_int> _constants;
         };
     }
 }
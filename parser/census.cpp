@@ -0,0 +1,263 @@
+/**
+ * Reaver Project Assembler License
+ *
+ * Copyright © 2014 Michał "Griwes" Dominiak
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation is required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ **/
+
+#include <set>
+
+#include "census.h"
+
+namespace
+{
+    struct _kind
+    {
+        std::uint64_t nodes = 0;
+        std::uint64_t blocks = 0;
+        std::uint64_t bytes = 0;
+
+        void block(std::size_t size)
+        {
+            ++blocks;
+            bytes += size;
+        }
+    };
+
+    class _census
+    {
+    public:
+        void operator()(const reaver::assembler::instruction & instr)
+        {
+            ++_instructions.nodes;
+            _location(instr);
+            _string(_instructions, instr.mnemonic);
+
+            if (instr.prefix)
+            {
+                _location(*instr.prefix);
+                _string(_instructions, instr.prefix->prefix);
+            }
+
+            if (instr.operands.capacity())
+            {
+                _instructions.block(instr.operands.capacity() * sizeof(reaver::assembler::operand));
+            }
+
+            for (const auto & op : instr.operands)
+            {
+                ++_operands.nodes;
+                boost::apply_visitor(*this, op);
+            }
+        }
+
+        void operator()(const reaver::assembler::label & l)
+        {
+            ++_directives.nodes;
+            _location(l);
+            _location(l.label);
+            _string(_directives, l.label.name);
+        }
+
+        void operator()(const reaver::assembler::bits_directive & bits)
+        {
+            ++_directives.nodes;
+            _location(bits);
+        }
+
+        void operator()(const reaver::assembler::data_directive & data)
+        {
+            ++_directives.nodes;
+            _location(data);
+            _string(_directives, data.bytes);
+        }
+
+        void operator()(const reaver::assembler::incbin_directive & incbin)
+        {
+            ++_directives.nodes;
+            _location(incbin);
+            _string(_directives, incbin.file);
+        }
+
+        void operator()(const reaver::assembler::times_directive & times)
+        {
+            ++_directives.nodes;
+            _location(times);
+            (*this)(times.statement);
+        }
+
+        template<typename Directive>
+        void operator()(const Directive & directive)
+        {
+            ++_directives.nodes;
+            _location(directive);
+            _string(_directives, directive.name);
+        }
+
+        void operator()(const reaver::assembler::integer & value)
+        {
+            boost::apply_visitor(*this, value);
+        }
+
+        void operator()(const reaver::assembler::integer_literal & literal)
+        {
+            ++_literals.nodes;
+            _location(literal);
+            _string(_literals, literal.literal);
+            _number(literal.value);
+        }
+
+        void operator()(const reaver::assembler::integer_expression & expression)
+        {
+            _location(expression);
+            _string(_literals, expression.literal);
+            _string(_operands, expression.op);
+
+            _operands.block(sizeof(reaver::assembler::integer));
+            (*this)(expression.first_operand.get());
+            _operands.block(sizeof(reaver::assembler::integer));
+            (*this)(expression.second_operand.get());
+        }
+
+        void operator()(const reaver::assembler::constant & constant)
+        {
+            _location(constant);
+            _string(_operands, constant.name);
+            _number(constant.value);
+        }
+
+        void operator()(const reaver::assembler::floating_point & value)
+        {
+            ++_literals.nodes;
+            _location(value);
+            _string(_literals, value.literal);
+        }
+
+        void operator()(const reaver::assembler::address & addr)
+        {
+            _location(addr);
+
+            if (addr.segment)
+            {
+                boost::apply_visitor(*this, *addr.segment);
+            }
+
+            if (addr.base)
+            {
+                (*this)(*addr.base);
+            }
+
+            if (addr.scale)
+            {
+                boost::apply_visitor(*this, *addr.scale);
+            }
+
+            if (addr.index)
+            {
+                boost::apply_visitor(*this, *addr.index);
+            }
+
+            if (addr.displacement)
+            {
+                (*this)(*addr.displacement);
+            }
+
+            if (addr.symbol)
+            {
+                (*this)(*addr.symbol);
+            }
+        }
+
+        void operator()(const reaver::assembler::cpu_register & reg)
+        {
+            _string(_operands, reg.name);
+        }
+
+        void operator()(const reaver::assembler::identifier & id)
+        {
+            _location(id);
+            _string(_operands, id.name);
+        }
+
+        void report(reaver::assembler::utils::statistics & stats) const
+        {
+            for (const auto & kind : { std::make_pair("instruction", &_instructions), std::make_pair("operand", &_operands),
+                std::make_pair("literal", &_literals), std::make_pair("location", &_locations), std::make_pair("directive",
+                &_directives) })
+            {
+                stats.count(std::string{ "AST nodes: " } + kind.first, kind.second->nodes);
+                stats.count(std::string{ "AST heap blocks: " } + kind.first, kind.second->blocks);
+                stats.count(std::string{ "AST heap bytes: " } + kind.first, kind.second->bytes);
+            }
+        }
+
+    private:
+        void _string(_kind & kind, const std::string & str)
+        {
+            static const auto inline_capacity = std::string{}.capacity();
+
+            if (str.capacity() > inline_capacity)
+            {
+                kind.block(str.capacity() + 1);
+            }
+        }
+
+        void _number(const boost::multiprecision::cpp_int & value)
+        {
+            const auto & backend = value.backend();
+            auto limbs = reinterpret_cast<const char *>(backend.limbs());
+            auto self = reinterpret_cast<const char *>(&backend);
+
+            if (limbs < self || limbs >= self + sizeof(backend))
+            {
+                _literals.block(backend.capacity() * sizeof(*backend.limbs()));
+            }
+        }
+
+        void _location(const reaver::assembler::location & loc)
+        {
+            for (auto chain = loc.include_chain.get(); chain && _chains.insert(chain).second; chain = chain->up.get())
+            {
+                ++_locations.nodes;
+                // make_shared places the control block and the object in a single allocation
+                _locations.block(sizeof(reaver::assembler::utils::include_chain) + 2 * sizeof(long));
+                _string(_locations, chain->file);
+            }
+        }
+
+        _kind _instructions;
+        _kind _operands;
+        _kind _literals;
+        _kind _locations;
+        _kind _directives;
+
+        std::set<const reaver::assembler::utils::include_chain *> _chains;
+    };
+}
+
+void reaver::assembler::ast_census(const ast & tree, utils::statistics & stats)
+{
+    _census census;
+
+    for (const auto & statement : tree.statements())
+    {
+        boost::apply_visitor(census, statement);
+    }
+
+    census.report(stats);
+}
@@ -24,10 +24,14 @@
 
 #include <functional>
 #include <memory>
+#include <map>
+#include <limits>
 
 #include <boost/spirit/include/qi.hpp>
 
 #include "../ast.h"
+#include "../../utils/floating_point.h"
+#include "../../generator/intel/encoding.h"
 
 namespace qi = boost::spirit::qi;
 
@@ -39,8 +43,8 @@ namespace reaver
         struct intel_grammar : qi::grammar<Iterator, void(), Skipper>
         {
             template<typename Tokens>
-            intel_grammar(const Tokens & tok, ast & ast, std::function<std::shared_ptr<utils::include_chain> ()> /*chain*/,
-                std::size_t & /*line*/) : intel_grammar::base_type(line)
+            intel_grammar(const Tokens & tok, ast & ast, std::function<std::shared_ptr<utils::include_chain> ()> chain,
+                std::size_t & /*line*/) : intel_grammar::base_type(line), _tree{ ast }, _chain{ std::move(chain) }
             {
                 identifier %= qi::eps >> tok.identifier;
 
@@ -127,11 +131,409 @@ namespace reaver
                         return ret;
                     })];
 
+                floating_point = tok.floating_literal[([&](const std::string & attr, const auto &, bool & parsed)
+                    {
+                        assembler::floating_point ret;
+                        ret.literal = attr;
+
+                        auto value = utils::parse_decimal(attr);
+                        parsed = static_cast<bool>(value);
+
+                        if (value)
+                        {
+                            ret.binary32 = utils::to_binary32(*value);
+                            ret.binary64 = utils::to_binary64(*value);
+                            ret.extended = utils::to_extended(*value);
+                        }
+
+                        return ret;
+                    })];
+
                 integer_expression %= addsub | muldiv | shift | bit_and | bit_xor | bit_or;
 
                 term %= integer | (qi::lit('(') >> integer_expression >> qi::lit(')'));
 
                 integer %= integer_literal | constant | integer_expression;
+
+                // the directives below are built in place by their actions; `line` pushes them once the whole line matched
+                auto digits = [this](unsigned base, std::size_t prefix)
+                {
+                    return [this, base, prefix](const std::string & attr, const auto &, bool &)
+                    {
+                        _number = 0;
+
+                        for (auto it = attr.begin() + prefix; it != attr.end(); ++it)
+                        {
+                            _number *= base;
+                            _number += *it <= '9' ? *it - '0' : (*it | 0x20) - 'a' + 10;
+                        }
+
+                        if (_negative)
+                        {
+                            _number = -_number;
+                        }
+                    };
+                };
+
+                auto sign = [this](const std::string &, const auto &, bool &)
+                {
+                    _negative = true;
+                };
+
+                auto unsigned_ = [this](const auto &, const auto &, bool &)
+                {
+                    _negative = false;
+                };
+
+                number = qi::eps[unsigned_] >> -tok.minus[sign] >> (tok.binary_literal[digits(2, 2)]
+                    | tok.hexadecimal_literal[digits(16, 2)] | tok.decimal_literal[digits(10, 0)]);
+
+                real = qi::eps[unsigned_] >> -tok.minus[sign] >> tok.floating_literal[([this](const std::string & attr,
+                    const auto &, bool & parsed)
+                {
+                    auto value = utils::parse_decimal(attr);
+                    parsed = value && (_data.unit == 4 || _data.unit == 8 || _data.unit == 10);
+
+                    if (!parsed)
+                    {
+                        return;
+                    }
+
+                    value->negative = _negative;
+
+                    if (_data.unit == 10)
+                    {
+                        auto bytes = utils::to_extended(*value);
+                        _data.bytes.append(bytes.begin(), bytes.end());
+                        return;
+                    }
+
+                    _append(_data.bytes, _data.unit == 4 ? boost::multiprecision::cpp_int{ utils::to_binary32(*value) }
+                        : boost::multiprecision::cpp_int{ utils::to_binary64(*value) }, _data.unit);
+                })];
+
+                auto text = [this](const std::string & attr, const auto &, bool &)
+                {
+                    auto bytes = _unescape(attr);
+                    bytes.resize((bytes.size() + _data.unit - 1) / _data.unit * _data.unit, '\0');
+                    _data.bytes += bytes;
+                };
+
+                data_item = tok.string_literal[text] | tok.character_literal[text] | real
+                    | number[([this](const auto &, const auto &, bool &){ _append(_data.bytes, _number, _data.unit); })];
+
+                data = tok.identifier[([this](const std::string & attr, const auto &, bool & parsed)
+                {
+                    static const std::map<std::string, std::size_t> units = {
+                        { "db", 1 }, { "dw", 2 }, { "dd", 4 }, { "dq", 8 }, { "dt", 10 }
+                    };
+
+                    auto it = units.find(attr);
+                    parsed = it != units.end();
+
+                    if (parsed)
+                    {
+                        _data = {};
+                        _data.include_chain = _chain();
+                        _data.unit = it->second;
+                    }
+                })] >> (data_item % tok.comma);
+
+                auto size = [this](const auto &, const auto &, bool & parsed)
+                {
+                    parsed = _number >= 0 && _number <= std::numeric_limits<std::uint64_t>::max();
+                };
+
+                incbin = tok.identifier[([this](const std::string & attr, const auto &, bool & parsed)
+                {
+                    parsed = attr == "incbin";
+
+                    if (parsed)
+                    {
+                        _incbin = {};
+                        _incbin.include_chain = _chain();
+                    }
+                })] >> tok.string_literal[([this](const std::string & attr, const auto &, bool &)
+                {
+                    _incbin.file = _unescape(attr);
+                })] >> -(tok.comma >> number[size][([this](const auto &, const auto &, bool &)
+                {
+                    _incbin.offset = static_cast<std::uint64_t>(_number);
+                })] >> -(tok.comma >> number[size][([this](const auto &, const auto &, bool &)
+                {
+                    _incbin.size = static_cast<std::uint64_t>(_number);
+                })]));
+
+                times = tok.identifier[([this](const std::string & attr, const auto &, bool & parsed)
+                {
+                    parsed = attr == "times";
+
+                    if (parsed)
+                    {
+                        _times = {};
+                        _times.include_chain = _chain();
+                    }
+                })] >> number[size][([this](const auto &, const auto &, bool &)
+                {
+                    _times.count = static_cast<std::uint64_t>(_number);
+                })] >> data[([this](const auto &, const auto &, bool &){ _times.statement = std::move(_data); })];
+
+                bits = tok.identifier[([this](const std::string & attr, const auto &, bool & parsed)
+                {
+                    parsed = attr == "bits";
+
+                    if (parsed)
+                    {
+                        _bits = {};
+                        _bits.include_chain = _chain();
+                    }
+                })] >> number[size][([this](const auto &, const auto &, bool &)
+                {
+                    _bits.bits = static_cast<std::size_t>(_number);
+                })];
+
+                auto keyword = [](const char * word)
+                {
+                    return [word](const std::string & attr, const auto &, bool & parsed)
+                    {
+                        parsed = attr == word;
+                    };
+                };
+
+                auto name = [this](const std::string & attr, const auto &, bool &)
+                {
+                    _name = attr;
+                };
+
+                global = tok.identifier[keyword("global")] >> tok.identifier[name];
+                extern_ = tok.identifier[keyword("extern")] >> tok.identifier[name];
+                equ = tok.identifier[name] >> tok.identifier[keyword("equ")] >> number;
+
+                auto declare = [this](auto declaration)
+                {
+                    return [this, declaration](const auto &, const auto &, bool &)
+                    {
+                        auto ret = declaration;
+                        ret.include_chain = _chain();
+                        ret.name = std::move(_name);
+                        _push(std::move(ret));
+                    };
+                };
+
+                label = tok.identifier[name] >> tok.colon[([this](const auto &, const auto &, bool &)
+                {
+                    _label = {};
+                    _label.include_chain = _chain();
+                    _label.label.include_chain = _label.include_chain;
+                    _label.label.name = std::move(_name);
+                    _labelled = true;
+                })];
+
+                section = tok.identifier[keyword("section")] >> tok.identifier[name];
+
+                // registers are told apart from symbols by name, and names defined with equ are replaced by their values
+                auto literal = [](const boost::multiprecision::cpp_int & value)
+                {
+                    assembler::integer_literal ret;
+                    ret.literal = value.str();
+                    ret.value = value;
+                    return assembler::integer{ std::move(ret) };
+                };
+
+                auto memory_size = [this](const std::string & attr, const auto &, bool & parsed)
+                {
+                    static const std::map<std::string, std::size_t> sizes = {
+                        { "byte", 8 }, { "word", 16 }, { "dword", 32 }, { "qword", 64 }
+                    };
+
+                    auto it = sizes.find(attr);
+                    parsed = it != sizes.end();
+
+                    if (parsed)
+                    {
+                        _address.size = it->second;
+                    }
+                };
+
+                auto register_name = [this](const std::string & attr, const auto &, bool & parsed)
+                {
+                    parsed = intel::find_register(attr);
+                    _register = attr;
+                };
+
+                auto scaled = [this, literal](const auto &, const auto &, bool & parsed)
+                {
+                    parsed = !_subtract && !_address.index && _number > 0 && _number <= 8;
+
+                    if (parsed)
+                    {
+                        _address.index = assembler::cpu_register{ _register };
+                        _address.scale = literal(_number);
+                    }
+                };
+
+                auto named_term = [this](const std::string & attr, const auto &, bool & parsed)
+                {
+                    if (intel::find_register(attr))
+                    {
+                        parsed = !_subtract && (!_address.base || !_address.index);
+
+                        if (parsed && !_address.base)
+                        {
+                            _address.base = assembler::cpu_register{ attr };
+                        }
+
+                        else if (parsed)
+                        {
+                            _address.index = assembler::cpu_register{ attr };
+                        }
+                    }
+
+                    else if (_tree.has_constant(attr))
+                    {
+                        _offset += _subtract ? -_tree.get_constant(attr) : _tree.get_constant(attr);
+                        _displaced = true;
+                    }
+
+                    else
+                    {
+                        parsed = !_subtract && !_address.symbol;
+
+                        if (parsed)
+                        {
+                            _address.symbol = assembler::identifier{};
+                            _address.symbol->include_chain = _address.include_chain;
+                            _address.symbol->name = attr;
+                        }
+                    }
+                };
+
+                auto sign_of = [this](bool subtract)
+                {
+                    return [this, subtract](const std::string &, const auto &, bool &)
+                    {
+                        _subtract = subtract;
+                    };
+                };
+
+                address_term = (tok.identifier[register_name] >> tok.star >> number)[scaled]
+                    | (number >> tok.star >> tok.identifier[register_name])[scaled]
+                    | tok.identifier[named_term]
+                    | number[([this](const auto &, const auto &, bool &)
+                    {
+                        _offset += _subtract ? -_number : _number;
+                        _displaced = true;
+                    })];
+
+                address = qi::eps[([this](const auto &, const auto &, bool &)
+                {
+                    _address = {};
+                    _address.include_chain = _chain();
+                    _offset = 0;
+                    _displaced = false;
+                    _subtract = false;
+                })] >> -tok.identifier[memory_size] >> tok.open_square >> -(tok.identifier[([this](const std::string & attr,
+                    const auto &, bool & parsed)
+                {
+                    auto info = intel::find_register(attr);
+                    parsed = info && info->kind == intel::register_kind::segment;
+                    _register = attr;
+                })] >> tok.colon[([this](const auto &, const auto &, bool &)
+                {
+                    _address.segment = boost::variant<assembler::integer, assembler::cpu_register, assembler::constant>{
+                        assembler::cpu_register{ _register } };
+                })]) >> address_term >> *((tok.plus[sign_of(false)] | tok.minus[sign_of(true)]) >> address_term)
+                    >> tok.close_square[([this, literal](const auto &, const auto &, bool &)
+                {
+                    if (_displaced)
+                    {
+                        _address.displacement = literal(_offset);
+                    }
+                })];
+
+                operand = address[([this](const auto &, const auto &, bool &)
+                    {
+                        _instruction.operands.push_back(std::move(_address));
+                    })]
+                    | tok.identifier[([this](const std::string & attr, const auto &, bool &)
+                    {
+                        if (intel::find_register(attr))
+                        {
+                            _instruction.operands.push_back(assembler::cpu_register{ attr });
+                        }
+
+                        else if (_tree.has_constant(attr))
+                        {
+                            assembler::constant ret;
+                            ret.include_chain = _instruction.include_chain;
+                            ret.name = attr;
+                            ret.value = _tree.get_constant(attr);
+                            _instruction.operands.push_back(std::move(ret));
+                        }
+
+                        else
+                        {
+                            assembler::identifier ret;
+                            ret.include_chain = _instruction.include_chain;
+                            ret.name = attr;
+                            _instruction.operands.push_back(std::move(ret));
+                        }
+                    })]
+                    | number[([this, literal](const auto &, const auto &, bool &)
+                    {
+                        _instruction.operands.push_back(literal(_number));
+                    })]
+                    | tok.character_literal[([this, literal](const std::string & attr, const auto &, bool &)
+                    {
+                        auto bytes = _unescape(attr);
+                        boost::multiprecision::cpp_int value = 0;
+
+                        for (auto it = bytes.rbegin(); it != bytes.rend(); ++it)
+                        {
+                            value <<= 8;
+                            value += static_cast<std::uint8_t>(*it);
+                        }
+
+                        _instruction.operands.push_back(literal(value));
+                    })];
+
+                instruction = qi::eps[([this](const auto &, const auto &, bool &)
+                {
+                    _instruction = {};
+                    _instruction.include_chain = _chain();
+                })] >> -tok.identifier[([this](const std::string & attr, const auto &, bool & parsed)
+                {
+                    parsed = attr == "lock" || attr == "rep" || attr == "repe" || attr == "repz" || attr == "repne"
+                        || attr == "repnz";
+
+                    if (parsed)
+                    {
+                        _instruction.prefix = assembler::prefix{};
+                        _instruction.prefix->include_chain = _instruction.include_chain;
+                        _instruction.prefix->prefix = attr;
+                    }
+                })] >> tok.identifier[([this](const std::string & attr, const auto &, bool &)
+                {
+                    _instruction.mnemonic = attr;
+                })] >> -(operand % tok.comma);
+
+                // a label is pushed together with the statement that follows it; anything that is not a directive is an
+                // instruction, and the generator rejects unknown mnemonics
+                line = qi::eps[([this](const auto &, const auto &, bool &){ _labelled = false; })] >> -label >> (
+                    (data >> qi::eoi)[([this](const auto &, const auto &, bool &){ _push(std::move(_data)); })]
+                    | (incbin >> qi::eoi)[([this](const auto &, const auto &, bool &){ _push(std::move(_incbin)); })]
+                    | (times >> qi::eoi)[([this](const auto &, const auto &, bool &){ _push(std::move(_times)); })]
+                    | (bits >> qi::eoi)[([this](const auto &, const auto &, bool &){ _push(std::move(_bits)); })]
+                    | (global >> qi::eoi)[declare(global_directive{})]
+                    | (extern_ >> qi::eoi)[declare(extern_directive{})]
+                    | (section >> qi::eoi)[declare(section_directive{})]
+                    | (equ >> qi::eoi)[([this](const auto &, const auto &, bool &)
+                    {
+                        _push_label();
+                        _tree.define_constant(_name, _number);
+                    })]
+                    | (instruction >> qi::eoi)[([this](const auto &, const auto &, bool &){ _push(std::move(_instruction)); })]
+                    | qi::eoi[([this](const auto &, const auto &, bool &){ _push_label(); })]);
             }
 
             qi::rule<Iterator, assembler::identifier(), Skipper> identifier;
@@ -140,11 +542,6 @@ namespace reaver
             qi::rule<Iterator, assembler::integer_expression(), Skipper> integer_expression;
             qi::rule<Iterator, assembler::integer(), Skipper> integer;
             qi::rule<Iterator, assembler::floating_point(), Skipper> floating_point;
-            qi::rule<Iterator, assembler::prefix(), Skipper> prefix;
-            qi::rule<Iterator, assembler::cpu_register(), Skipper> cpu_register;
-            qi::rule<Iterator, assembler::operand(), Skipper> operand;
-            qi::rule<Iterator, assembler::address(), Skipper> address;
-            qi::rule<Iterator, assembler::instruction(), Skipper> instruction;
 
             qi::rule<Iterator, assembler::integer(), Skipper> term;
             qi::rule<Iterator, assembler::integer_expression(), Skipper> addsub;
@@ -155,13 +552,105 @@ namespace reaver
             qi::rule<Iterator, assembler::integer_expression(), Skipper> bit_or;
 
 //            qi::rule<Iterator, org_directive(), Skipper> org;
-  //          qi::rule<Iterator, bits_directive(), Skipper> bits;
-    //        qi::rule<Iterator, section_directive(), Skipper> section;
-      //      qi::rule<Iterator, global_directive(), Skipper> global;
-        //    qi::rule<Iterator, extern_directive(), Skipper> extern_;
             qi::rule<Iterator, void(), Skipper> include;
 
+            qi::rule<Iterator, void(), Skipper> number;
+            qi::rule<Iterator, void(), Skipper> real;
+            qi::rule<Iterator, void(), Skipper> data_item;
+            qi::rule<Iterator, void(), Skipper> data;
+            qi::rule<Iterator, void(), Skipper> incbin;
+            qi::rule<Iterator, void(), Skipper> times;
+            qi::rule<Iterator, void(), Skipper> bits;
+            qi::rule<Iterator, void(), Skipper> global;
+            qi::rule<Iterator, void(), Skipper> extern_;
+            qi::rule<Iterator, void(), Skipper> equ;
+            qi::rule<Iterator, void(), Skipper> label;
+            qi::rule<Iterator, void(), Skipper> section;
+            qi::rule<Iterator, void(), Skipper> address_term;
+            qi::rule<Iterator, void(), Skipper> address;
+            qi::rule<Iterator, void(), Skipper> operand;
+            qi::rule<Iterator, void(), Skipper> instruction;
+
             qi::rule<Iterator, void(), Skipper> line;
+
+        private:
+            void _push_label()
+            {
+                if (_labelled)
+                {
+                    _labelled = false;
+                    _tree.push(std::move(_label));
+                }
+            }
+
+            void _push(statement s)
+            {
+                _push_label();
+                _tree.push(std::move(s));
+            }
+
+            // strips the quotes of a string or character literal and resolves its escape sequences
+            static std::string _unescape(const std::string & literal)
+            {
+                static const std::map<char, char> escapes = {
+                    { 'n', '\n' }, { 't', '\t' }, { 'r', '\r' }, { '0', '\0' }
+                };
+
+                std::string ret;
+
+                for (auto it = literal.begin() + 1; it + 1 < literal.end(); ++it)
+                {
+                    if (*it == '\\' && it + 2 < literal.end())
+                    {
+                        ++it;
+                        ret.push_back(escapes.count(*it) ? escapes.at(*it) : *it);
+                        continue;
+                    }
+
+                    ret.push_back(*it);
+                }
+
+                return ret;
+            }
+
+            // little endian, truncated to the unit like any other two's complement value
+            static void _append(std::string & bytes, boost::multiprecision::cpp_int value, std::size_t unit)
+            {
+                boost::multiprecision::cpp_int modulus = 1;
+                modulus <<= unit * 8;
+
+                value %= modulus;
+                if (value < 0)
+                {
+                    value += modulus;
+                }
+
+                for (std::size_t i = 0; i < unit; ++i)
+                {
+                    bytes.push_back(static_cast<char>(static_cast<std::uint8_t>(value & 0xff)));
+                    value >>= 8;
+                }
+            }
+
+            ast & _tree;
+            std::function<std::shared_ptr<utils::include_chain> ()> _chain;
+
+            bool _negative = false;
+            boost::multiprecision::cpp_int _number;
+            data_directive _data;
+            incbin_directive _incbin;
+            times_directive _times;
+            bits_directive _bits;
+            std::string _name;
+
+            assembler::label _label;
+            bool _labelled = false;
+            assembler::instruction _instruction;
+            assembler::address _address;
+            std::string _register;
+            boost::multiprecision::cpp_int _offset;
+            bool _displaced = false;
+            bool _subtract = false;
         };
     }
 }
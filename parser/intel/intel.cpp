@@ -20,20 +20,101 @@
  *
  **/
 
-#include <boost/spirit/include/lex_lexertl.hpp>
-
 #include "intel.h"
 #include "../../utils/include_chain.h"
+#include "../../utils/diagnostics.h"
+#include "../../utils/statistics.h"
+#include "../../utils/trace.h"
+#include "../precompiled.h"
 #include "grammar.h"
-#include "tokens.h"
+#include "lexer.h"
 
-reaver::assembler::ast reaver::assembler::intel_parser::operator()() const
+namespace
 {
-    return _parse_stream(_front.input(), std::make_shared<utils::include_chain>(_front.input_name()));
+    using lexer_type = reaver::assembler::intel_lexer_type;
+    using skipper_type = qi::in_state_skipper<reaver::assembler::intel_tokens<lexer_type>::lexer_def>;
+
+    constexpr std::size_t _chunk_lines = 4096;
+
+    struct _shared_lexer : reaver::assembler::intel_tokens<lexer_type>
+    {
+        _shared_lexer()
+        {
+            this->init_dfa();
+        }
+    };
+
+    const reaver::assembler::intel_tokens<lexer_type> & _lexer()
+    {
+        static const _shared_lexer lexer;
+        return lexer;
+    }
+
+    // returns the position of the first character no token or skip pattern matches, or `end` if there is none
+    std::string::const_iterator _scan(const reaver::assembler::intel_tokens<lexer_type> & lexer,
+        std::string::const_iterator begin, std::string::const_iterator end, std::size_t & tokens)
+    {
+        while (begin != end)
+        {
+            auto position = begin;
+
+            lex::tokenize(begin, end, lexer, [&](const auto &){ ++tokens; return true; });
+            lex::tokenize(begin, end, lexer, "skip");
+
+            if (begin == position)
+            {
+                return begin;
+            }
+        }
+
+        return end;
+    }
 }
 
-reaver::assembler::ast reaver::assembler::intel_parser::_parse_stream(std::istream & is, std::shared_ptr<
-    reaver::assembler::utils::include_chain> ic) const
+void reaver::assembler::intel_parser::operator()(std::function<void (ast &&)> sink) const
+{
+    utils::diagnostics diags{ _front.warning_level(), _front.error_limit() };
+
+    // precompiled headers are neither lexed nor parsed; their declarations lead the first batch and their constants are
+    // visible to the whole input
+    ast header;
+    for (const auto & path : _front.precompiled_includes())
+    {
+        utils::trace::span span{ _front.trace(), path, "include" };
+        precompiled_header pch{ path };
+
+        if (!pch.valid())
+        {
+            diags.push({ logger::error, utils::message::invalid_precompiled_header, nullptr, 0, 0, { path } });
+            continue;
+        }
+
+        auto setting = pch.mismatch(_front);
+        if (!setting.empty())
+        {
+            diags.push({ logger::error, utils::message::stale_precompiled_header, nullptr, 0, 0, { path, setting } });
+            continue;
+        }
+
+        if (!pch.load(header))
+        {
+            diags.push({ logger::error, utils::message::invalid_precompiled_header, nullptr, 0, 0, { path } });
+        }
+    }
+
+    _parse_stream(_front.input(), std::make_shared<utils::include_chain>(_front.input_name()), diags, std::move(header),
+        sink);
+    diags.render(_engine);
+
+    if (diags.errors())
+    {
+        throw std::move(_engine);
+    }
+}
+
+void reaver::assembler::intel_parser::_parse_stream(std::istream & is, std::shared_ptr<
+    reaver::assembler::utils::include_chain> ic, utils::diagnostics & diags, ast ret, const std::function<void (ast &&)> & sink)
+    const
 {
     std::string buffer;
     std::size_t current_line = 0;
@@ -45,14 +126,23 @@ reaver::assembler::ast reaver::assembler::intel_parser::_parse_stream(std::istre
         return i;
     };
 
-    ast ret;
+    auto flush = [&](){
+        if (!ret.statements().empty())
+        {
+            sink(ret.split());
+        }
+    };
+
+    auto stats = _front.statistics();
+    utils::statistics::stopwatch lexing, parsing;
+    std::size_t tokens = 0;
 
-    using iterator = std::string::const_iterator;
-    using token_type = lex::lexertl::token<iterator, boost::mpl::vector<lex::omit, std::string>>;
-    using lexer_type = lex::lexertl::lexer<token_type>;
-    using skipper_type = qi::in_state_skipper<intel_tokens<lexer_type>::lexer_def>;
+    auto trace = _front.trace();
+    utils::trace::span file{ trace, ic->file, ic->up ? "include" : "file" };
+    std::unique_ptr<utils::trace::span> chunk;
+    std::size_t chunk_lines = 0;
 
-    intel_tokens<lexer_type> lexer;
+    const auto & lexer = _lexer();
     intel_grammar<intel_tokens<lexer_type>::iterator_type, skipper_type> grammar{ lexer, ret, chain, current_line };
 
     while (std::getline(is, buffer))
@@ -60,7 +150,21 @@ reaver::assembler::ast reaver::assembler::intel_parser::_parse_stream(std::istre
         current_line += more_lines + 1;
         more_lines = 0;
 
-        while (buffer.back() == '\\')
+        if (chunk_lines++ % _chunk_lines == 0)
+        {
+            flush();
+
+            if (trace)
+            {
+                chunk.reset();
+                chunk = std::make_unique<utils::trace::span>(trace, "lines " + std::to_string(current_line) + "+", "parse");
+            }
+        }
+
+        bool broken = false;
+        bool stop = false;
+
+        while (!buffer.empty() && buffer.back() == '\\')
         {
             std::string b;
 
@@ -73,22 +177,86 @@ reaver::assembler::ast reaver::assembler::intel_parser::_parse_stream(std::istre
 
             if (is.eof() || !std::getline(is,  b))
             {
-                _engine.push({
-                    chain()->exception(buffer.size() + 1),
-                    exception(logger::error) << "invalid `\\` at the end of file."
-                  });
+                broken = true;
+                stop = !diags.push({ logger::error, utils::message::invalid_line_continuation, ic, current_line,
+                    buffer.size() + 1, {} });
+                break;
             }
 
-            else
+            buffer.append(b);
+            ++more_lines;
+        }
+
+        if (stop)
+        {
+            break;
+        }
+
+        if (broken)
+        {
+            continue;
+        }
+
+        // the parser lexes on demand, so lexing is timed (and tokens are counted) with a separate pass
+        if (stats)
+        {
+            lexing.start();
+            _scan(lexer, buffer.cbegin(), buffer.cend(), tokens);
+            lexing.stop();
+            parsing.start();
+        }
+
+        auto begin = buffer.cbegin();
+        bool parsed = lex::tokenize_and_phrase_parse(begin, buffer.cend(), lexer, grammar, qi::in_state("skip")[lexer.self]);
+
+        if (stats)
+        {
+            parsing.stop();
+        }
+
+        if (parsed)
+        {
+            continue;
+        }
+
+        // every rejected line is reported, and parsing resumes with the next one; lines with nothing but whitespace and
+        // comments are not statements
+        std::size_t line_tokens = 0;
+        auto invalid = _scan(lexer, buffer.cbegin(), buffer.cend(), line_tokens);
+
+        if (invalid == buffer.cend() && !line_tokens)
+        {
+            continue;
+        }
+
+        if (invalid != buffer.cend())
+        {
+            if (!diags.push({ logger::error, utils::message::unexpected_character, ic, current_line,
+                static_cast<std::size_t>(invalid - buffer.cbegin() + 1), { std::string(1, *invalid) } }))
             {
-                buffer.append(b);
-                ++more_lines;
+                break;
             }
+
+            continue;
         }
 
-        auto begin = buffer.cbegin();
-        lex::tokenize_and_phrase_parse(begin, buffer.cend(), lexer, grammar, qi::in_state("skip")[lexer.self]);
+        auto first = buffer.find_first_not_of(" \t\r\v\f");
+        auto word = buffer.substr(first, buffer.find_first_of(" \t\r\v\f,;", first) - first);
+
+        auto id = word == "times" ? utils::message::unsupported_repetition : utils::message::unsupported_statement;
+        if (!diags.push({ logger::error, id, ic, current_line, first + 1, { word } }))
+        {
+            break;
+        }
+    }
+
+    if (stats)
+    {
+        stats->add("parse/lexing", lexing.elapsed());
+        stats->add("parse/grammar", parsing.elapsed());
+        stats->count("lines", current_line + more_lines);
+        stats->count("tokens", tokens);
     }
 
-    return ret;
+    flush();
 }
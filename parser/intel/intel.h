@@ -26,6 +26,7 @@
 
 #include "../parser.h"
 #include "../../utils/include_chain.h"
+#include "../../utils/diagnostics.h"
 
 namespace reaver
 {
@@ -40,13 +41,15 @@ namespace reaver
 
             virtual ~intel_parser() {}
 
-            virtual ast operator()() const override;
+            using parser::operator();
+            virtual void operator()(std::function<void (ast &&)>) const override;
 
         private:
             const frontend & _front;
             error_engine & _engine;
 
-            ast _parse_stream(std::istream &, std::shared_ptr<utils::include_chain>) const;
+            void _parse_stream(std::istream &, std::shared_ptr<utils::include_chain>, utils::diagnostics &, ast,
+                const std::function<void (ast &&)> &) const;
         };
     }
 }
@@ -0,0 +1,49 @@
+/**
+ * Reaver Project Assembler License
+ *
+ * Copyright © 2014 Michał "Griwes" Dominiak
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation is required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ **/
+
+#pragma once
+
+#include <string>
+
+#include <boost/spirit/include/lex_lexertl.hpp>
+
+#if __has_include("static_lexer.h")
+#include <boost/spirit/include/lex_static_lexertl.hpp>
+#include "static_lexer.h"
+#define REAVER_ASSEMBLER_STATIC_LEXER
+#endif
+
+#include "tokens.h"
+
+namespace reaver
+{
+    namespace assembler
+    {
+        using intel_token_type = lex::lexertl::token<std::string::const_iterator, boost::mpl::vector<lex::omit, std::string>>;
+
+#ifdef REAVER_ASSEMBLER_STATIC_LEXER
+        using intel_lexer_type = lex::lexertl::static_lexer<intel_token_type, lex::lexertl::static_::lexer_intel>;
+#else
+        using intel_lexer_type = lex::lexertl::lexer<intel_token_type>;
+#endif
+    }
+}
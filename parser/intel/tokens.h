@@ -35,16 +35,17 @@ namespace reaver
         {
             intel_tokens()
             {
-                identifier = "[a-zA-Z@_.][a-zA-Z0-9@_]*";
+                identifier = "[a-zA-Z@_.][a-zA-Z0-9@_.]*";
 
                 binary_literal = "0b[01]+";
                 decimal_literal = "[0-9]+";
                 hexadecimal_literal = "0x[0-9a-fA-F]+";
+                floating_literal = R"([0-9]+\.[0-9]*([eE][+\-]?[0-9]+)?|[0-9]+[eE][+\-]?[0-9]+)";
 
-                string_literal = R"~("([^"\\]*(\\.[^\"\\]*)*)")~";
+                string_literal = R"~(\"([^\"\\]*(\\.[^\"\\]*)*)\")~";
                 character_literal = R"('\\?.')";
 
-                comma = R"(\.)";
+                comma = ",";
                 plus = R"(\+)";
                 minus = R"(\-)";
                 slash = R"(\/)";
@@ -59,16 +60,16 @@ namespace reaver
                 exclamation_mark = R"(\!)";
                 open_paren = R"(\()";
                 close_paren = R"(\))";
-                open_square = R"([)";
-                close_square = R"(])";
+                open_square = R"(\[)";
+                close_square = R"(\])";
                 colon = R"(\:)";
                 left_shift = R"(\<\<)";
                 right_shift = R"(\>\>)";
 
                 skip = "[ \t\r\n\v\f]+|;.*";
 
-                this->self.add(identifier)(binary_literal)(decimal_literal)(hexadecimal_literal)(string_literal)
-                    (character_literal)(comma)(plus)(minus)(slash)(star)(percent)(dollar)(ampersand)(pipe)(dash)(tilde)
+                this->self.add(identifier)(binary_literal)(decimal_literal)(hexadecimal_literal)(floating_literal)
+                    (string_literal)(character_literal)(comma)(plus)(minus)(slash)(star)(percent)(dollar)(ampersand)(pipe)(dash)(tilde)
                     (question_mark)(exclamation_mark)(open_paren)(close_paren)(open_square)(close_square)(colon)(left_shift)
                     (right_shift);
                 this->self("skip") = skip;
@@ -78,6 +79,7 @@ namespace reaver
             lex::token_def<std::string> binary_literal;
             lex::token_def<std::string> decimal_literal;
             lex::token_def<std::string> hexadecimal_literal;
+            lex::token_def<std::string> floating_literal;
             lex::token_def<std::string> string_literal;
             lex::token_def<std::string> character_literal;
 
@@ -23,6 +23,7 @@
 #pragma once
 
 #include <memory>
+#include <functional>
 
 #include <reaver/error.h>
 
@@ -42,7 +43,15 @@ namespace reaver
 
             virtual ~parser() {}
 
-            virtual ast operator()() const = 0;
+            // hands statements to the callback in batches, as soon as each batch has been parsed
+            virtual void operator()(std::function<void (ast &&)>) const = 0;
+
+            ast operator()() const
+            {
+                ast ret;
+                (*this)([&](ast && batch){ ret.append(std::move(batch)); });
+                return ret;
+            }
         };
 
         std::unique_ptr<parser> create_parser(const frontend &, error_engine &);
@@ -0,0 +1,350 @@
+/**
+ * Reaver Project Assembler License
+ *
+ * Copyright © 2014 Michał "Griwes" Dominiak
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation is required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ **/
+
+#include <cstring>
+#include <cstdint>
+#include <sstream>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <boost/variant/get.hpp>
+#include <boost/variant/apply_visitor.hpp>
+
+#include "precompiled.h"
+
+namespace
+{
+    // every field is 8 byte aligned, so the snapshot can be read in place from the mapping
+    const char _magic[8] = { 'R', 'A', 'S', 'M', 'P', 'C', 'H', 1 };
+    const std::uint64_t _byte_order = 0x0102030405060708;
+
+    enum : std::uint64_t
+    {
+        _global,
+        _extern
+    };
+
+    std::size_t _padded(std::size_t size)
+    {
+        return (size + 7) & ~static_cast<std::size_t>(7);
+    }
+
+    struct _writer
+    {
+        std::ostream & out;
+
+        void integer(std::uint64_t value)
+        {
+            out.write(reinterpret_cast<const char *>(&value), sizeof(value));
+        }
+
+        void string(const std::string & value)
+        {
+            static const char padding[8] = {};
+
+            integer(value.size());
+            out.write(value.data(), value.size());
+            out.write(padding, _padded(value.size()) - value.size());
+        }
+    };
+
+    struct _reader
+    {
+        const char * position;
+        const char * end;
+
+        bool integer(std::uint64_t & value)
+        {
+            if (static_cast<std::size_t>(end - position) < sizeof(value))
+            {
+                return false;
+            }
+
+            std::memcpy(&value, position, sizeof(value));
+            position += sizeof(value);
+            return true;
+        }
+
+        bool string(boost::string_ref & value)
+        {
+            std::uint64_t size;
+            if (!integer(size) || static_cast<std::uint64_t>(end - position) < _padded(size))
+            {
+                return false;
+            }
+
+            value = { position, size };
+            position += _padded(size);
+            return true;
+        }
+    };
+
+    struct _location : boost::static_visitor<const reaver::assembler::location &>
+    {
+        template<typename T>
+        const reaver::assembler::location & operator()(const T & statement) const
+        {
+            return statement;
+        }
+    };
+
+    std::string _triple(const reaver::assembler::frontend & front)
+    {
+        std::ostringstream ret;
+        ret << front.target();
+        return ret.str();
+    }
+}
+
+void reaver::assembler::precompile(const frontend & front, error_engine & engine, const ast & header)
+{
+    utils::diagnostics diags{ front.warning_level(), front.error_limit() };
+    std::size_t declarations = 0;
+
+    for (const auto & statement : header.statements())
+    {
+        if (boost::get<global_directive>(&statement) || boost::get<extern_directive>(&statement))
+        {
+            ++declarations;
+            continue;
+        }
+
+        const auto & loc = boost::apply_visitor(_location{}, statement);
+        if (!diags.push({ logger::error, utils::message::not_a_declaration, loc.include_chain, loc.include_chain
+            ? loc.include_chain->line : 0, loc.column, {} }))
+        {
+            break;
+        }
+    }
+
+    diags.render(engine);
+
+    if (diags.errors())
+    {
+        throw std::move(engine);
+    }
+
+    auto & out = front.output();
+    _writer write{ out };
+
+    out.write(_magic, sizeof(_magic));
+    write.integer(_byte_order);
+    write.string(_triple(front));
+    write.string(front.syntax());
+
+    write.integer(front.defines().size());
+    for (const auto & define : front.defines())
+    {
+        write.string(define.first);
+    }
+
+    write.integer(header.constants().size());
+    for (const auto & constant : header.constants())
+    {
+        write.string(constant.first);
+        write.string(constant.second.str());
+    }
+
+    write.integer(declarations);
+    for (const auto & statement : header.statements())
+    {
+        const auto & loc = boost::apply_visitor(_location{}, statement);
+
+        if (auto global = boost::get<global_directive>(&statement))
+        {
+            write.integer(_global);
+            write.string(global->name);
+        }
+
+        else
+        {
+            write.integer(_extern);
+            write.string(boost::get<extern_directive>(statement).name);
+        }
+
+        write.integer(loc.include_chain ? loc.include_chain->line : 0);
+        write.integer(loc.column);
+    }
+
+    if (!out.flush())
+    {
+        engine.push(exception(logger::error) << "failed to write precompiled header.");
+        throw std::move(engine);
+    }
+}
+
+reaver::assembler::precompiled_header::precompiled_header(std::string path) : _path{ std::move(path) }
+{
+    int descriptor = ::open(_path.c_str(), O_RDONLY);
+    if (descriptor < 0)
+    {
+        return;
+    }
+
+    struct stat info;
+    if (::fstat(descriptor, &info) == 0 && info.st_size > 0)
+    {
+        auto data = ::mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+        if (data != MAP_FAILED)
+        {
+            _data = static_cast<const char *>(data);
+            _size = info.st_size;
+        }
+    }
+
+    ::close(descriptor);
+
+    if (!_data || _size < sizeof(_magic) || std::memcmp(_data, _magic, sizeof(_magic)) != 0)
+    {
+        return;
+    }
+
+    _reader read{ _data + sizeof(_magic), _data + _size };
+
+    std::uint64_t byte_order, defines;
+    if (!read.integer(byte_order) || byte_order != _byte_order || !read.string(_target) || !read.string(_syntax)
+        || !read.integer(defines))
+    {
+        return;
+    }
+
+    for (std::uint64_t i = 0; i < defines; ++i)
+    {
+        boost::string_ref define;
+        if (!read.string(define))
+        {
+            return;
+        }
+
+        _defines.push_back(define);
+    }
+
+    _body = read.position;
+    _valid = true;
+}
+
+reaver::assembler::precompiled_header::~precompiled_header()
+{
+    if (_data)
+    {
+        ::munmap(const_cast<char *>(_data), _size);
+    }
+}
+
+std::string reaver::assembler::precompiled_header::mismatch(const frontend & front) const
+{
+    if (_target != _triple(front))
+    {
+        return "target";
+    }
+
+    if (_syntax != front.syntax())
+    {
+        return "syntax";
+    }
+
+    if (_defines.size() != front.defines().size() || !std::equal(_defines.begin(), _defines.end(), front.defines().begin(),
+        [](const boost::string_ref & name, const auto & define){ return name == define.first; }))
+    {
+        return "set of defines";
+    }
+
+    return "";
+}
+
+bool reaver::assembler::precompiled_header::load(ast & ret) const
+{
+    _reader read{ _body, _data + _size };
+    ast tree;
+
+    std::uint64_t count;
+    if (!read.integer(count))
+    {
+        return false;
+    }
+
+    for (std::uint64_t i = 0; i < count; ++i)
+    {
+        boost::string_ref name, value;
+        if (!read.string(name) || !read.string(value))
+        {
+            return false;
+        }
+
+        try
+        {
+            tree.define_constant(name.to_string(), boost::multiprecision::cpp_int{ value.to_string() });
+        }
+
+        catch (std::runtime_error &)
+        {
+            return false;
+        }
+    }
+
+    if (!read.integer(count))
+    {
+        return false;
+    }
+
+    for (std::uint64_t i = 0; i < count; ++i)
+    {
+        std::uint64_t kind, line, column;
+        boost::string_ref name;
+
+        if (!read.integer(kind) || !read.string(name) || !read.integer(line) || !read.integer(column))
+        {
+            return false;
+        }
+
+        auto chain = std::make_shared<utils::include_chain>(_path, nullptr, line);
+
+        if (kind == _global)
+        {
+            global_directive declaration;
+            declaration.include_chain = chain;
+            declaration.column = column;
+            declaration.name = name.to_string();
+            tree.push(std::move(declaration));
+        }
+
+        else if (kind == _extern)
+        {
+            extern_directive declaration;
+            declaration.include_chain = chain;
+            declaration.column = column;
+            declaration.name = name.to_string();
+            tree.push(std::move(declaration));
+        }
+
+        else
+        {
+            return false;
+        }
+    }
+
+    ret.append(std::move(tree));
+    return true;
+}
@@ -0,0 +1,78 @@
+/**
+ * Reaver Project Assembler License
+ *
+ * Copyright © 2014 Michał "Griwes" Dominiak
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation is required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ **/
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+
+#include <boost/utility/string_ref.hpp>
+
+#include <reaver/error.h>
+
+#include "ast.h"
+#include "../frontend/frontend.h"
+#include "../utils/diagnostics.h"
+
+namespace reaver
+{
+    namespace assembler
+    {
+        // writes a snapshot of a parsed header (its constants and symbol declarations), tagged with the target, syntax and
+        // defines it was parsed with, to the output of the frontend
+        void precompile(const frontend &, error_engine &, const ast &);
+
+        // a snapshot written by precompile(); the file is mapped, not read, and only the declarations are copied out of it
+        class precompiled_header
+        {
+        public:
+            precompiled_header(std::string path);
+            ~precompiled_header();
+
+            precompiled_header(const precompiled_header &) = delete;
+            precompiled_header & operator=(const precompiled_header &) = delete;
+
+            bool valid() const
+            {
+                return _valid;
+            }
+
+            // returns the name of the first setting of the frontend the snapshot was not built with, or an empty string
+            std::string mismatch(const frontend &) const;
+
+            // appends the constants and declarations of the snapshot to the tree; false if the snapshot is truncated
+            bool load(ast &) const;
+
+        private:
+            std::string _path;
+            const char * _data = nullptr;
+            std::size_t _size = 0;
+            bool _valid = false;
+
+            boost::string_ref _target;
+            boost::string_ref _syntax;
+            std::vector<boost::string_ref> _defines;
+            const char * _body = nullptr;
+        };
+    }
+}
@@ -0,0 +1,107 @@
+/**
+ * Reaver Project Assembler License
+ *
+ * Copyright © 2014 Michał "Griwes" Dominiak
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation is required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ **/
+
+#include <cstring>
+#include <iostream>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include <boost/filesystem.hpp>
+
+#include "client.h"
+#include "protocol.h"
+
+boost::optional<int> reaver::assembler::forward(int argc, char ** argv)
+{
+    std::vector<std::string> request{ boost::filesystem::current_path().string() };
+    std::string path = default_socket_path();
+    bool connect = false;
+
+    for (int i = 0; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+
+        if (arg == "--connect" || arg == "-connect")
+        {
+            connect = true;
+            continue;
+        }
+
+        if (arg == "-h" || arg == "--help" || arg == "-v" || arg == "--version" || arg == "--server" || arg == "-")
+        {
+            return {};
+        }
+
+        if ((arg == "--socket" || arg == "-socket") && i + 1 < argc)
+        {
+            path = argv[i + 1];
+        }
+
+        else if (arg.compare(0, 9, "--socket=") == 0)
+        {
+            path = arg.substr(9);
+        }
+
+        request.push_back(std::move(arg));
+    }
+
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+
+    if (!connect || path.size() >= sizeof(address.sun_path))
+    {
+        return {};
+    }
+
+    std::copy(path.begin(), path.end(), address.sun_path);
+
+    // a socket served by another user is never trusted; that server would read the inputs and write the outputs with
+    // its own rights
+    ucred peer{};
+    socklen_t size = sizeof(peer);
+
+    int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0 || ::connect(fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) < 0
+        || ::getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &peer, &size) < 0 || peer.uid != ::getuid())
+    {
+        if (fd >= 0)
+        {
+            ::close(fd);
+        }
+
+        return {};
+    }
+
+    std::vector<std::string> response;
+    send_message(fd, request);
+    bool received = receive_message(fd, response);
+    ::close(fd);
+
+    if (!received || response.size() != 2)
+    {
+        return {};
+    }
+
+    std::cerr << response[1];
+    return std::stoi(response[0]);
+}
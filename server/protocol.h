@@ -0,0 +1,120 @@
+/**
+ * Reaver Project Assembler License
+ *
+ * Copyright © 2014 Michał "Griwes" Dominiak
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation is required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ **/
+
+#pragma once
+
+#include <cstdint>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <system_error>
+
+#include <unistd.h>
+
+#include "../utils/descriptor.h"
+
+namespace reaver
+{
+    namespace assembler
+    {
+        // the runtime directory belongs to the user alone; /tmp is only a fallback for systems that do not have one
+        inline std::string default_socket_path()
+        {
+            auto runtime = std::getenv("XDG_RUNTIME_DIR");
+            if (runtime && *runtime)
+            {
+                return std::string{ runtime } + "/rasm.socket";
+            }
+
+            return "/tmp/rasm-" + std::to_string(::getuid()) + ".socket";
+        }
+
+        inline void send_message(int fd, const std::vector<std::string> & fields)
+        {
+            std::string buffer;
+
+            auto append = [&](std::uint32_t value)
+            {
+                buffer.append(reinterpret_cast<const char *>(&value), sizeof(value));
+            };
+
+            append(fields.size());
+            for (const auto & field : fields)
+            {
+                append(field.size());
+                buffer.append(field);
+            }
+
+            utils::write_all(fd, buffer.data(), buffer.size());
+        }
+
+        inline bool receive_message(int fd, std::vector<std::string> & fields)
+        {
+            auto read = [&](char * data, std::size_t size)
+            {
+                while (size)
+                {
+                    auto received = ::read(fd, data, size);
+
+                    if (received < 0 && errno == EINTR)
+                    {
+                        continue;
+                    }
+
+                    if (received <= 0)
+                    {
+                        return false;
+                    }
+
+                    data += received;
+                    size -= received;
+                }
+
+                return true;
+            };
+
+            std::uint32_t count;
+            if (!read(reinterpret_cast<char *>(&count), sizeof(count)))
+            {
+                return false;
+            }
+
+            fields.clear();
+            for (std::uint32_t i = 0; i < count; ++i)
+            {
+                std::uint32_t size;
+                if (!read(reinterpret_cast<char *>(&size), sizeof(size)))
+                {
+                    return false;
+                }
+
+                fields.emplace_back(size, '\0');
+                if (!read(&fields.back()[0], size))
+                {
+                    return false;
+                }
+            }
+
+            return true;
+        }
+    }
+}
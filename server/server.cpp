@@ -0,0 +1,200 @@
+/**
+ * Reaver Project Assembler License
+ *
+ * Copyright © 2014 Michał "Griwes" Dominiak
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation is required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ **/
+
+#include <sstream>
+
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+#include "server.h"
+#include "protocol.h"
+#include "../driver/driver.h"
+#include "../frontend/memory.h"
+#include "../parser/parser.h"
+#include "../generator/generator.h"
+#include "../utils/file_cache.h"
+#include "../utils/thread_pool.h"
+
+namespace
+{
+    // only a socket left behind by a server that is gone is removed; anything else at the path is an error
+    void _remove_stale(const std::string & path, const sockaddr_un & address)
+    {
+        struct stat info;
+        if (::lstat(path.c_str(), &info) != 0)
+        {
+            return;
+        }
+
+        if (!S_ISSOCK(info.st_mode))
+        {
+            throw std::system_error{ EEXIST, std::system_category(), path + " exists and is not a socket" };
+        }
+
+        int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd < 0)
+        {
+            throw std::system_error{ errno, std::system_category(), "socket" };
+        }
+
+        bool listening = ::connect(fd, reinterpret_cast<const sockaddr *>(&address), sizeof(address)) == 0;
+        ::close(fd);
+
+        if (listening)
+        {
+            throw std::system_error{ EADDRINUSE, std::system_category(), path };
+        }
+
+        ::unlink(path.c_str());
+    }
+
+    void _warm_up()
+    {
+        reaver::error_engine engine;
+        reaver::assembler::memory_frontend front{ "" };
+
+        auto parser = reaver::assembler::create_parser(front, engine);
+        auto generator = reaver::assembler::create_generator(front, engine);
+        (*generator)((*parser)());
+    }
+
+    void _handle(int client, reaver::assembler::utils::file_cache & cache)
+    {
+        using reaver::logger::crash;
+
+        std::vector<std::string> request;
+        if (!reaver::assembler::receive_message(client, request) || request.size() < 2)
+        {
+            return;
+        }
+
+        std::vector<char *> argv;
+        for (auto it = request.begin() + 1; it != request.end(); ++it)
+        {
+            argv.push_back(&(*it)[0]);
+        }
+        argv.push_back(nullptr);
+
+        std::ostringstream diagnostics;
+        int result = 0;
+
+        {
+            reaver::logger::logger log;
+            log.add_stream(diagnostics);
+
+            reaver::error_engine engine;
+
+            try
+            {
+                reaver::assembler::console_frontend front{ static_cast<int>(argv.size() - 1), argv.data(), engine, request[0],
+                    &cache };
+
+                if (front.server())
+                {
+                    engine.push(reaver::exception(reaver::logger::error) << "cannot start a server from within a server.");
+                    throw std::move(engine);
+                }
+
+                result = reaver::assembler::run(front, engine, log);
+            }
+
+            catch (reaver::exception & e)
+            {
+                e.print(log);
+                result = e.level() == crash ? 2 : 1;
+            }
+
+            catch (std::exception & e)
+            {
+                log(crash) << e.what();
+                result = 2;
+            }
+        }
+
+        reaver::assembler::send_message(client, { std::to_string(result), diagnostics.str() });
+    }
+}
+
+int reaver::assembler::serve(const console_frontend & front)
+{
+    auto path = front.socket();
+
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+
+    if (path.size() >= sizeof(address.sun_path))
+    {
+        throw std::system_error{ ENAMETOOLONG, std::system_category(), path };
+    }
+
+    std::copy(path.begin(), path.end(), address.sun_path);
+
+    int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+    {
+        throw std::system_error{ errno, std::system_category(), "socket" };
+    }
+
+    _remove_stale(path, address);
+
+    // other users must not be able to connect: a request names files that are then read with this user's rights
+    if (::bind(fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) < 0 || ::chmod(path.c_str(), 0600) < 0
+        || ::listen(fd, SOMAXCONN) < 0)
+    {
+        throw std::system_error{ errno, std::system_category(), path };
+    }
+
+    _warm_up();
+
+    utils::file_cache cache;
+    utils::thread_pool pool{ front.threads() ? front.threads() : std::max(std::thread::hardware_concurrency(), 1u) };
+
+    while (true)
+    {
+        int client = ::accept4(fd, nullptr, nullptr, SOCK_CLOEXEC);
+
+        if (client < 0)
+        {
+            if (errno == EINTR || errno == ECONNABORTED)
+            {
+                continue;
+            }
+
+            throw std::system_error{ errno, std::system_category(), "accept" };
+        }
+
+        pool.push([&cache, client]()
+        {
+            try
+            {
+                _handle(client, cache);
+            }
+
+            catch (...)
+            {
+            }
+
+            ::close(client);
+        });
+    }
+}
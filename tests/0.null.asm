@@ -1 +1 @@
-foo;barbaz
+; nothing to assemble
@@ -8,12 +8,12 @@ section .text
 global _start
 
 _start:
-    mov     eax, 4
-    mov     ebx, 1
-    mov     ecx, text
+    mov     eax, 1
+    mov     edi, 1
+    mov     esi, text
     mov     edx, 13
-    int     0x80
+    syscall
 
-    mov     eax, 1
-    mov     ebx, 0
-    int     0x80
+    mov     eax, 60
+    mov     edi, 0
+    syscall
@@ -18,6 +18,5 @@ _start:
     mov     edi, format
     call    printf
 
-    mov     eax, 1
-    mov     ebx, 0
+    mov     edi, 0
     call    exit
@@ -0,0 +1,13 @@
+db      1, 2, -1, 0x41, 0b101
+dw      'a', "abc", -2
+dd      1.5, -2.0, 0xdeadbeef
+dq      1.0
+dt      1.0
+db      "a\n\"b", 0
+
+incbin  "0.null.asm"
+incbin  "0.null.asm", 4
+incbin  "0.null.asm", 4, 2
+
+times   3 dw 1, 2
+times   1048576 db 0
@@ -0,0 +1,336 @@
+/**
+ * Reaver Project Assembler License
+ *
+ * Copyright © 2014 Michał "Griwes" Dominiak
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation is required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ **/
+
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include <elf.h>
+
+#include "../frontend/console.h"
+#include "../frontend/memory.h"
+#include "../driver/driver.h"
+#include "../generator/generator.h"
+
+namespace
+{
+    using namespace reaver::assembler;
+
+    std::size_t checked = 0;
+    std::size_t failed = 0;
+
+    void expect(const std::string & what, bool condition)
+    {
+        ++checked;
+
+        if (!condition)
+        {
+            ++failed;
+            std::cerr << "failed: " << what << '\n';
+        }
+    }
+
+    const std::string input = "tests/debug_line.asm";
+    const std::string output = "tests/debug_line.o";
+
+    // runs `rasm` on the source with the given options, like the command line does; the object file it wrote, or
+    // nothing if the input was rejected
+    std::string assemble(const std::string & source, std::vector<std::string> options)
+    {
+        std::ofstream{ input } << source;
+
+        options.insert(options.begin(), { "rasm", input, "-s", "-o", output });
+        std::vector<char *> argv;
+        for (auto & option : options)
+        {
+            argv.push_back(&option[0]);
+        }
+
+        std::string ret;
+
+        try
+        {
+            reaver::error_engine engine;
+            console_frontend front{ static_cast<int>(argv.size()), argv.data(), engine };
+
+            if (run(front, engine, reaver::logger::dlog) == 0)
+            {
+                std::ifstream in{ output, std::ios::binary };
+                ret.assign(std::istreambuf_iterator<char>{ in }, std::istreambuf_iterator<char>{});
+            }
+        }
+
+        catch (reaver::error_engine &)
+        {
+        }
+
+        catch (reaver::exception &)
+        {
+        }
+
+        std::remove(input.c_str());
+        std::remove(output.c_str());
+        return ret;
+    }
+
+    // the header and contents of the named section of an ELF64 image; an empty name if there is no such section
+    std::pair<Elf64_Shdr, std::string> find_section(const std::string & image, const std::string & name)
+    {
+        if (image.size() < sizeof(Elf64_Ehdr))
+        {
+            return {};
+        }
+
+        Elf64_Ehdr header;
+        std::memcpy(&header, image.data(), sizeof(header));
+
+        auto get = [&](std::size_t index)
+        {
+            Elf64_Shdr ret;
+            std::memcpy(&ret, image.data() + header.e_shoff + index * sizeof(ret), sizeof(ret));
+            return ret;
+        };
+
+        auto names = get(header.e_shstrndx);
+
+        for (std::size_t i = 0; i < header.e_shnum; ++i)
+        {
+            auto sect = get(i);
+
+            if (image.c_str() + names.sh_offset + sect.sh_name == name)
+            {
+                return { sect, image.substr(sect.sh_offset, sect.sh_size) };
+            }
+        }
+
+        return {};
+    }
+
+    struct row
+    {
+        std::string file;
+        std::uint64_t line;
+        std::uint64_t address;
+
+        bool operator==(const row & other) const
+        {
+            return file == other.file && line == other.line && address == other.address;
+        }
+    };
+
+    // the rows of every sequence of a version 4 line number program; addresses are relative to the start of their
+    // section, since the set_address operands are left for the relocations
+    std::vector<std::vector<row>> decode(const std::string & program)
+    {
+        std::vector<std::vector<row>> ret;
+        std::size_t position = 0;
+
+        auto byte = [&]() { return static_cast<std::uint8_t>(program[position++]); };
+        auto uleb = [&]()
+        {
+            std::uint64_t value = 0;
+            for (std::size_t shift = 0; ; shift += 7)
+            {
+                auto b = byte();
+                value |= std::uint64_t{ b & 0x7fu } << shift;
+                if (!(b & 0x80))
+                {
+                    return value;
+                }
+            }
+        };
+        auto sleb = [&]()
+        {
+            std::int64_t value = 0;
+            std::size_t shift = 0;
+            std::uint8_t b;
+            do
+            {
+                b = byte();
+                value |= std::int64_t{ b & 0x7f } << shift;
+                shift += 7;
+            } while (b & 0x80);
+
+            return shift < 64 && (b & 0x40) ? value | -(std::int64_t{ 1 } << shift) : value;
+        };
+
+        if (program.size() < 10 || program[4] != 4)
+        {
+            return ret;
+        }
+
+        position = 10;
+        byte();
+        byte();
+        byte();
+        auto line_base = static_cast<std::int8_t>(byte());
+        auto line_range = byte();
+        auto opcode_base = byte();
+        position += opcode_base - 1;
+
+        while (byte())
+        {
+            while (byte())
+            {
+            }
+        }
+
+        std::vector<std::string> files{ "" };
+        while (program[position])
+        {
+            files.emplace_back(program.c_str() + position);
+            position += files.back().size() + 1;
+            uleb();
+            uleb();
+            uleb();
+        }
+        ++position;
+
+        std::uint64_t file = 1, line = 1, address = 0;
+        std::vector<row> rows;
+
+        while (position < program.size())
+        {
+            auto opcode = byte();
+
+            if (opcode >= opcode_base)
+            {
+                opcode -= opcode_base;
+                address += opcode / line_range;
+                line += line_base + opcode % line_range;
+                rows.push_back({ files[file], line, address });
+                continue;
+            }
+
+            switch (opcode)
+            {
+                case 0:
+                {
+                    auto length = uleb();
+                    auto extended = byte();
+
+                    if (extended == 1)
+                    {
+                        ret.push_back(std::move(rows));
+                        rows.clear();
+                        file = 1, line = 1, address = 0;
+                    }
+
+                    position += length - 1;
+                    break;
+                }
+
+                case 1:
+                    rows.push_back({ files[file], line, address });
+                    break;
+
+                case 2:
+                    address += uleb();
+                    break;
+
+                case 3:
+                    line += sleb();
+                    break;
+
+                case 4:
+                    file = uleb();
+                    break;
+
+                default:
+                    break;
+            }
+        }
+
+        return ret;
+    }
+
+    // a location-less statement is what a client of the library gets when it builds the tree itself
+    class debug_frontend : public memory_frontend
+    {
+    public:
+        using memory_frontend::memory_frontend;
+
+        virtual bool debug_info() const override
+        {
+            return true;
+        }
+    };
+}
+
+int main()
+{
+    auto image = assemble(
+        "section .text\n"
+        "_start:\n"
+        "    mov eax, 1\n"
+        "    ret\n"
+        "section .data\n"
+        "value: dd 1\n"
+        "section .text\n"
+        "    nop\n", { "-g" });
+
+    expect("the source is assembled", !image.empty());
+
+    auto lines = find_section(image, ".debug_line");
+    auto sequences = decode(lines.second);
+    expect("every section with code or data gets a sequence", sequences.size() == 2);
+
+    if (sequences.size() == 2)
+    {
+        expect("rows follow the source lines of .text", sequences[0] == std::vector<row>{ { input, 3, 0 }, { input, 4, 5 },
+            { input, 8, 6 } });
+        expect("rows follow the source lines of .data", sequences[1] == std::vector<row>{ { input, 6, 0 } });
+    }
+
+    expect("there are no line numbers by default", find_section(assemble("nop\n", {}), ".debug_line").second.empty());
+
+    lines = find_section(assemble("nop\n", { "-g", "--compress-debug-sections" }), ".debug_line");
+    Elf64_Chdr compression{};
+    std::memcpy(&compression, lines.second.data(), std::min(sizeof(compression), lines.second.size()));
+    expect("--compress-debug-sections compresses .debug_line", (lines.first.sh_flags & SHF_COMPRESSED)
+        && compression.ch_type == ELFCOMPRESS_ZLIB);
+
+    debug_frontend front{ "" };
+    reaver::error_engine engine;
+    auto generator = create_generator(front, engine);
+
+    ast tree;
+    tree.push(instruction{ {}, {}, "nop", {} });
+
+    instruction located{ {}, {}, "ret", {} };
+    located.include_chain = std::make_shared<utils::include_chain>("built.asm", nullptr, 7);
+    tree.push(located);
+
+    auto object = (*generator)(tree);
+    const auto & blob = object->get_section(".debug_line").blob;
+    sequences = decode({ blob.begin(), blob.end() });
+    expect("statements without a location get no row", sequences.size() == 1
+        && sequences[0] == std::vector<row>{ { "built.asm", 7, 1 } });
+
+    std::cout << checked - failed << " of " << checked << " line number checks passed\n";
+    return failed != 0;
+}
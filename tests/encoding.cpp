@@ -0,0 +1,178 @@
+/**
+ * Reaver Project Assembler License
+ *
+ * Copyright © 2014 Michał "Griwes" Dominiak
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation is required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ **/
+
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <boost/optional.hpp>
+
+#include "../frontend/memory.h"
+#include "../parser/intel/intel.h"
+#include "../generator/intel/intel.h"
+#include "../generator/intel/encoding.h"
+
+namespace
+{
+    using namespace reaver::assembler;
+
+    std::size_t checked = 0;
+    std::size_t failed = 0;
+
+    void expect(const std::string & what, bool condition)
+    {
+        ++checked;
+
+        if (!condition)
+        {
+            ++failed;
+            std::cerr << "failed: " << what << '\n';
+        }
+    }
+
+    // the bytes an instruction encodes to in each mode; an empty list stands for the error given instead
+    struct expectation
+    {
+        const char * text;
+        intel::instruction instr;
+        std::vector<std::uint8_t> bytes[3];
+        intel::encoding_error errors[3];
+    };
+
+    const intel::mode modes[] = { intel::mode::bits16, intel::mode::bits32, intel::mode::bits64 };
+
+    void expect(const expectation & e)
+    {
+        for (std::size_t i = 0; i < 3; ++i)
+        {
+            auto what = std::string{ e.text } + " in " + std::to_string(static_cast<int>(modes[i])) + " bit mode";
+            auto encoded = intel::encoder_for(modes[i])(e.instr);
+
+            expect(what + " is the specialized encoding", intel::encode(e.instr, modes[i]).error == encoded.error
+                && intel::encode(e.instr, modes[i]).bytes == encoded.bytes);
+
+            if (e.bytes[i].empty())
+            {
+                expect(what + " is rejected", encoded.error == e.errors[i]);
+                continue;
+            }
+
+            expect(what + " encodes", encoded.error == intel::encoding_error::none
+                && std::vector<std::uint8_t>(encoded.bytes.begin(), encoded.bytes.begin() + encoded.size) == e.bytes[i]);
+        }
+    }
+
+    boost::optional<std::vector<char>> assemble(const std::string & source)
+    {
+        memory_frontend front{ source };
+        reaver::error_engine engine;
+
+        try
+        {
+            auto session = intel_generator{ front, engine }.start();
+            intel_parser{ front, engine }([&](ast && tree){ (*session)(tree); });
+            return session->finish()->get_section(".text").blob;
+        }
+
+        catch (reaver::error_engine &)
+        {
+            return boost::none;
+        }
+    }
+}
+
+int main()
+{
+    using intel::reg;
+    using intel::mem;
+    using intel::imm;
+
+    const auto none = intel::encoding_error::none;
+    const auto invalid_in_mode = intel::encoding_error::invalid_in_mode;
+    const auto invalid_address = intel::encoding_error::invalid_address;
+
+    const expectation expectations[] = {
+        { "mov eax, ebx", { "mov", reg("eax"), reg("ebx") },
+            { { 0x66, 0x89, 0xd8 }, { 0x89, 0xd8 }, { 0x89, 0xd8 } }, { none, none, none } },
+        { "mov ax, bx", { "mov", reg("ax"), reg("bx") },
+            { { 0x89, 0xd8 }, { 0x66, 0x89, 0xd8 }, { 0x66, 0x89, 0xd8 } }, { none, none, none } },
+        { "mov rax, rbx", { "mov", reg("rax"), reg("rbx") },
+            { {}, {}, { 0x48, 0x89, 0xd8 } }, { invalid_in_mode, invalid_in_mode, none } },
+        { "mov r8d, eax", { "mov", reg("r8d"), reg("eax") },
+            { {}, {}, { 0x41, 0x89, 0xc0 } }, { invalid_in_mode, invalid_in_mode, none } },
+        { "mov eax, [ebx + 4]", { "mov", reg("eax"), mem("ebx", 4) },
+            { { 0x67, 0x66, 0x8b, 0x43, 0x04 }, { 0x8b, 0x43, 0x04 }, { 0x67, 0x8b, 0x43, 0x04 } }, { none, none, none } },
+        { "mov ax, [bx + si]", { "mov", reg("ax"), mem("bx", "si", 1, 0) },
+            { { 0x8b, 0x00 }, { 0x67, 0x66, 0x8b, 0x00 }, {} }, { none, none, invalid_address } },
+        { "mov eax, [rbx]", { "mov", reg("eax"), mem("rbx") },
+            { {}, {}, { 0x8b, 0x03 } }, { invalid_address, invalid_address, none } },
+        { "mov ax, ss", { "mov", reg("ax"), reg("ss") },
+            { { 0x8c, 0xd0 }, { 0x66, 0x8c, 0xd0 }, { 0x66, 0x8c, 0xd0 } }, { none, none, none } },
+        { "mov eax, ss", { "mov", reg("eax"), reg("ss") },
+            { { 0x66, 0x8c, 0xd0 }, { 0x8c, 0xd0 }, { 0x8c, 0xd0 } }, { none, none, none } },
+        { "mov rax, ss", { "mov", reg("rax"), reg("ss") },
+            { {}, {}, { 0x48, 0x8c, 0xd0 } }, { invalid_in_mode, invalid_in_mode, none } },
+        { "mov word [ebx], ss", { "mov", mem("ebx", 0, 16), reg("ss") },
+            { { 0x67, 0x8c, 0x13 }, { 0x8c, 0x13 }, { 0x67, 0x8c, 0x13 } }, { none, none, none } },
+        { "mov ss, ax", { "mov", reg("ss"), reg("ax") },
+            { { 0x8e, 0xd0 }, { 0x8e, 0xd0 }, { 0x8e, 0xd0 } }, { none, none, none } },
+        { "add ax, 0x100", { "add", reg("ax"), imm(0x100) },
+            { { 0x81, 0xc0, 0x00, 0x01 }, { 0x66, 0x81, 0xc0, 0x00, 0x01 }, { 0x66, 0x81, 0xc0, 0x00, 0x01 } },
+            { none, none, none } },
+        { "push 0x1234", { "push", imm(0x1234) },
+            { { 0x68, 0x34, 0x12 }, { 0x68, 0x34, 0x12, 0x00, 0x00 }, { 0x68, 0x34, 0x12, 0x00, 0x00 } }, { none, none, none } },
+        { "push ebp", { "push", reg("ebp") },
+            { { 0x66, 0x55 }, { 0x55 }, {} }, { none, none, invalid_in_mode } },
+        { "push rbp", { "push", reg("rbp") },
+            { {}, {}, { 0x55 } }, { invalid_in_mode, invalid_in_mode, none } },
+        { "ret", { "ret" },
+            { { 0xc3 }, { 0xc3 }, { 0xc3 } }, { none, none, none } }
+    };
+
+    for (const auto & e : expectations)
+    {
+        expect(e);
+    }
+
+    // the same source through the parser, switching modes in between
+    auto bytes = [](std::initializer_list<std::uint8_t> list)
+    {
+        return boost::optional<std::vector<char>>{ std::vector<char>(list.begin(), list.end()) };
+    };
+
+    expect("bits 16 selects 16 bit operands", assemble("bits 16\nmov ax, ss\nmov eax, ss\nmov ax, [bx + si]\n")
+        == bytes({ 0x8c, 0xd0, 0x66, 0x8c, 0xd0, 0x8b, 0x00 }));
+    expect("bits 32 selects 32 bit operands", assemble("bits 32\nmov ax, ss\nmov eax, ss\nmov eax, [ebx + 4]\n")
+        == bytes({ 0x66, 0x8c, 0xd0, 0x8c, 0xd0, 0x8b, 0x43, 0x04 }));
+    expect("bits 64 selects 64 bit addresses", assemble("bits 64\nmov rax, ss\npush rbp\nmov eax, [rbx]\n")
+        == bytes({ 0x48, 0x8c, 0xd0, 0x55, 0x8b, 0x03 }));
+    expect("modes switch within a source", assemble("bits 32\npush ebp\nbits 16\npush ebp\nbits 64\npush rbp\n")
+        == bytes({ 0x55, 0x66, 0x55, 0x55 }));
+    expect("instructions invalid in the mode are rejected", !assemble("bits 32\npush rbp\n"));
+    expect("64 bit addresses are rejected in 16 bit mode", !assemble("bits 16\nmov eax, [rbx]\n"));
+    expect("bits 8 is rejected", !assemble("bits 8\n"));
+    expect("bits without a mode is rejected", !assemble("bits\n"));
+
+    std::cout << checked - failed << " of " << checked << " encoding checks passed\n";
+    return failed != 0;
+}
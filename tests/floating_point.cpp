@@ -0,0 +1,199 @@
+/**
+ * Reaver Project Assembler License
+ *
+ * Copyright © 2014 Michał "Griwes" Dominiak
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation is required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ **/
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <limits>
+#include <iostream>
+#include <random>
+#include <string>
+
+#include "../utils/floating_point.h"
+
+namespace
+{
+    using namespace reaver::assembler;
+
+    std::size_t checked = 0;
+    std::size_t failed = 0;
+
+    std::array<std::uint8_t, 10> bytes(long double value)
+    {
+        std::array<std::uint8_t, 10> ret;
+        std::memcpy(ret.data(), &value, ret.size());
+        return ret;
+    }
+
+    template<typename T>
+    void expect(const std::string & literal, const char * format, const T & actual, const T & expected)
+    {
+        ++checked;
+
+        if (actual != expected)
+        {
+            ++failed;
+            std::cerr << "mismatch: " << literal << " as " << format << '\n';
+        }
+    }
+
+    boost::multiprecision::cpp_rational rational(const utils::decimal & value)
+    {
+        boost::multiprecision::cpp_int ten = boost::multiprecision::pow(boost::multiprecision::cpp_int{ 10 },
+            static_cast<unsigned>(value.exponent < 0 ? -value.exponent : value.exponent));
+        boost::multiprecision::cpp_rational ret{ value.digits.empty() ? boost::multiprecision::cpp_int{ 0 }
+            : boost::multiprecision::cpp_int{ value.digits } };
+
+        if (value.exponent < 0)
+        {
+            ret /= ten;
+        }
+
+        else
+        {
+            ret *= ten;
+        }
+        return value.negative ? -ret : ret;
+    }
+
+    // checks the conversion of a literal against the exact rational conversion and against the C library
+    void check(const std::string & literal)
+    {
+        auto value = utils::parse_decimal(literal);
+        if (!value)
+        {
+            ++checked;
+            ++failed;
+            std::cerr << "failed to parse: " << literal << '\n';
+            return;
+        }
+
+        float single = std::strtof(literal.c_str(), nullptr);
+        double double_precision = std::strtod(literal.c_str(), nullptr);
+        long double extended = std::strtold(literal.c_str(), nullptr);
+
+        std::uint32_t single_bits;
+        std::uint64_t double_bits;
+        std::memcpy(&single_bits, &single, sizeof(single));
+        std::memcpy(&double_bits, &double_precision, sizeof(double_precision));
+
+        expect(literal, "binary32", utils::to_binary32(*value), single_bits);
+        expect(literal, "binary64", utils::to_binary64(*value), double_bits);
+
+        // long double is only the x87 format on x86
+        if (sizeof(long double) >= 10 && std::numeric_limits<long double>::digits == 64)
+        {
+            expect(literal, "extended", utils::to_extended(*value), bytes(extended));
+        }
+
+        // the rational path is slow, so it is only taken for a sample of the literals; it has no negative zero
+        if (checked % 7 == 0 && !value->digits.empty())
+        {
+            auto exact = rational(*value);
+
+            expect(literal, "binary32 (rational)", utils::to_binary32(*value), utils::to_binary32(exact));
+            expect(literal, "binary64 (rational)", utils::to_binary64(*value), utils::to_binary64(exact));
+            expect(literal, "extended (rational)", utils::to_extended(*value), utils::to_extended(exact));
+        }
+    }
+
+    template<typename T>
+    std::string print(const char * format, T value)
+    {
+        char buffer[64];
+        std::snprintf(buffer, sizeof(buffer), format, value);
+        return buffer;
+    }
+}
+
+int main()
+{
+    const char * edges[] = {
+        "0", "-0", "0.0", "1", "-1", "0.5", "1e0", "1E+2", "123.456e-2", "000123.4500",
+        // halfway between two floats and two doubles
+        "16777217", "9007199254740993", "9007199254740993.0000000000000000001", "4503599627370496.5",
+        // subnormals and the boundaries of every format
+        "1e-45", "1.4e-45", "7e-46", "1e-310", "4.9406564584124654e-324", "2.4703282292062327e-324",
+        "2.4703282292062328e-324", "2.2250738585072011e-308", "2.2250738585072014e-308", "3.4028235e38", "3.4028236e38",
+        "1.7976931348623157e308", "1.7976931348623158e308", "1.8e308", "1e-4950", "3.6e-4951", "1.18973149535723176502e4932",
+        "1.2e4932", "1e5000", "1e-5000", "1e1000000000000", "1e-1000000000000",
+        // long significands
+        "3.14159265358979323846264338327950288419716939937510", "2.71828182845904523536028747135266249775724709369995",
+        "0.1000000000000000055511151231257827021181583404541015625",
+        "0.1000000000000000055511151231257827021181583404541015624",
+        "0.1000000000000000055511151231257827021181583404541015626",
+        "123456789012345678901234567890e-10"
+    };
+
+    for (auto literal : edges)
+    {
+        check(literal);
+    }
+
+    std::mt19937_64 random{ 0x72617361 };
+
+    // every double, float and long double printed with enough digits to round-trip
+    for (std::size_t i = 0; i < 100000; ++i)
+    {
+        std::uint64_t bits = random();
+        double value;
+        std::memcpy(&value, &bits, sizeof(value));
+
+        if (!std::isfinite(value))
+        {
+            continue;
+        }
+
+        check(print("%.17g", value));
+
+        if (std::isfinite(static_cast<float>(value)))
+        {
+            check(print("%.9g", static_cast<float>(value)));
+        }
+
+        // a long double with bits below the precision of a double
+        check(print("%.21Lg", static_cast<long double>(value) * (1 + static_cast<long double>(i % 1000) / 1024)));
+    }
+
+    // random decimal literals with up to 25 significant digits over the whole range of the formats
+    std::uniform_int_distribution<int> digit{ 0, 9 };
+    std::uniform_int_distribution<int> length{ 1, 25 };
+    std::uniform_int_distribution<int> exponent{ -360, 330 };
+    std::uniform_int_distribution<int> wide_exponent{ -4970, 4950 };
+
+    for (std::size_t i = 0; i < 100000; ++i)
+    {
+        std::string literal;
+
+        for (auto n = length(random); n; --n)
+        {
+            literal.push_back('0' + digit(random));
+        }
+
+        literal += "e" + std::to_string(i % 10 ? exponent(random) : wide_exponent(random));
+        check(literal);
+    }
+
+    std::cout << checked - failed << " of " << checked << " conversions correct\n";
+    return failed != 0;
+}
@@ -0,0 +1,150 @@
+/**
+ * Reaver Project Assembler License
+ *
+ * Copyright © 2014 Michał "Griwes" Dominiak
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation is required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ **/
+
+
+#include <cstdint>
+#include <iostream>
+#include <string>
+
+#include <boost/variant/get.hpp>
+
+#include "../frontend/memory.h"
+#include "../parser/intel/intel.h"
+#include "../jit/jit.h"
+
+namespace
+{
+    using namespace reaver::assembler;
+
+    std::size_t checked = 0;
+    std::size_t failed = 0;
+
+    void expect(const std::string & what, bool condition)
+    {
+        ++checked;
+
+        if (!condition)
+        {
+            ++failed;
+            std::cerr << "failed: " << what << '\n';
+        }
+    }
+
+    // the parsed input, or nothing if it was rejected
+    boost::optional<ast> parse(const std::string & source)
+    {
+        memory_frontend front{ source };
+        reaver::error_engine engine;
+        ast ret;
+
+        try
+        {
+            intel_parser{ front, engine }([&](ast && tree){ ret.append(std::move(tree)); });
+            return ret;
+        }
+
+        catch (reaver::error_engine &)
+        {
+            return boost::none;
+        }
+    }
+
+    const address * memory_operand(const ast & tree, std::size_t statement, std::size_t operand)
+    {
+        auto instr = boost::get<instruction>(&tree.statements()[statement]);
+        return instr && instr->operands.size() > operand ? boost::get<address>(&instr->operands[operand]) : nullptr;
+    }
+
+    std::int64_t value(const integer & value)
+    {
+        return static_cast<std::int64_t>(boost::get<integer_literal>(value).value);
+    }
+}
+
+int main()
+{
+    auto tree = parse("four equ 4\nentry: lock add dword [fs:rbx + rsi * 4 + four - 1], 'a'\nsection .data\n");
+    expect("instructions, labels and sections parse", tree && tree->statements().size() == 3);
+
+    if (tree && tree->statements().size() == 3)
+    {
+        auto l = boost::get<label>(&tree->statements()[0]);
+        expect("the label precedes its instruction", l && l->label.name == "entry");
+
+        auto instr = boost::get<instruction>(&tree->statements()[1]);
+        expect("the prefix is kept", instr && instr->prefix && instr->prefix->prefix == "lock");
+        expect("the mnemonic is kept", instr && instr->mnemonic == "add" && instr->operands.size() == 2);
+
+        auto addr = memory_operand(*tree, 1, 0);
+        expect("the address has a size", addr && addr->size == 32);
+        expect("the address has a segment", addr && addr->segment
+            && boost::get<cpu_register>(*addr->segment).name == "fs");
+        expect("the address has a base and a scaled index", addr && addr->base && addr->base->name == "rbx" && addr->index
+            && boost::get<cpu_register>(*addr->index).name == "rsi" && addr->scale
+            && value(boost::get<integer>(*addr->scale)) == 4);
+        expect("constant terms are folded", addr && addr->displacement && value(*addr->displacement) == 3);
+        expect("a character literal is an integer", instr && instr->operands.size() == 2
+            && boost::get<integer>(&instr->operands[1]) && value(boost::get<integer>(instr->operands[1])) == 'a');
+
+        auto sect = boost::get<section_directive>(&tree->statements()[2]);
+        expect("the section is named", sect && sect->name == ".data");
+    }
+
+    tree = parse("mov eax, [rip + counter - 8]\n");
+    auto addr = tree ? memory_operand(*tree, 0, 1) : nullptr;
+    expect("a symbol is kept apart from the displacement", addr && addr->symbol && addr->symbol->name == "counter"
+        && addr->displacement && value(*addr->displacement) == -8);
+
+    expect("a symbol cannot be subtracted", !parse("mov eax, [rbx - counter]\n"));
+    expect("an address has at most one index", !parse("mov eax, [rbx + rsi * 2 + rdi * 4]\n"));
+    expect("a label-only line is a label", parse("done:\n") && parse("done:\n")->statements().size() == 1);
+
+    reaver::error_engine engine;
+
+    try
+    {
+        auto code = jit::assemble(
+            "section .text\n"
+            "sum:\n"
+            "    lea rax, [rdi + rsi * 2]\n"
+            "    sub rax, rsi\n"
+            "    ret\n"
+            "\n"
+            "load:\n"
+            "    mov eax, [rip + answer]\n"
+            "    ret\n"
+            "\n"
+            "section .data\n"
+            "answer: dd 42\n", {}, engine);
+
+        expect("jitted code adds", code.get<std::uint64_t (std::uint64_t, std::uint64_t)>("sum")(40, 2) == 42);
+        expect("jitted code loads its data", code.get<std::uint32_t ()>("load")() == 42);
+    }
+
+    catch (reaver::error_engine &)
+    {
+        expect("source is assembled to machine code", false);
+    }
+
+    std::cout << checked - failed << " of " << checked << " jit checks passed\n";
+    return failed != 0;
+}
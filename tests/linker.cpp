@@ -0,0 +1,96 @@
+/**
+ * Reaver Project Assembler License
+ *
+ * Copyright © 2014 Michał "Griwes" Dominiak
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation is required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ **/
+
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+#include "../frontend/memory.h"
+#include "../output/linker/linker.h"
+
+// links a hand-built object, so that only the linker is under test, and runs the executable
+int main()
+{
+    using namespace reaver::assembler;
+
+    auto obj = std::make_unique<object>();
+
+    auto & text = obj->get_section(".text");
+    text.blob = {
+        '\xb8', '\x01', '\x00', '\x00', '\x00',     // mov eax, 1
+        '\xbf', '\x01', '\x00', '\x00', '\x00',     // mov edi, 1
+        '\xbe', '\x00', '\x00', '\x00', '\x00',     // mov esi, message
+        '\xba', '\x03', '\x00', '\x00', '\x00',     // mov edx, 3
+        '\x0f', '\x05',                             // syscall
+        '\xb8', '\x3c', '\x00', '\x00', '\x00',     // mov eax, 60
+        '\xbf', '\x07', '\x00', '\x00', '\x00',     // mov edi, 7
+        '\x0f', '\x05'                              // syscall
+    };
+    text.relocations.push_back({ 11, "message", relocation_type::absolute32, 0 });
+
+    obj->get_section(".data").blob = { 'o', 'k', '\n' };
+
+    auto & start = obj->get_symbol("_start");
+    start.section = ".text";
+    start.global = true;
+
+    obj->get_symbol("message").section = ".data";
+
+    memory_frontend front{ "", std::string{ "x86_64-none-elf" }, "intel", "elf64" };
+    reaver::error_engine engine;
+
+    try
+    {
+        linker_output{ front, engine }(obj);
+    }
+
+    catch (reaver::error_engine &)
+    {
+        std::cerr << "failed: linking\n";
+        return 1;
+    }
+
+    const char * path = "tests/linker.exe";
+    {
+        std::ofstream out{ path, std::ios::binary };
+        out << front.output_buffer();
+    }
+    ::chmod(path, 0755);
+
+    auto pipe = ::popen(path, "r");
+    std::string printed;
+    for (int c; (c = std::fgetc(pipe)) != EOF; )
+    {
+        printed.push_back(c);
+    }
+    auto status = ::pclose(pipe);
+    std::remove(path);
+
+    bool passed = printed == "ok\n" && WIFEXITED(status) && WEXITSTATUS(status) == 7;
+    std::cout << (passed ? "linked executable ran correctly\n" : "failed: linked executable printed `" + printed
+        + "` and exited with " + std::to_string(WEXITSTATUS(status)) + "\n");
+    return !passed;
+}
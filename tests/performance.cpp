@@ -0,0 +1,136 @@
+/**
+ * Reaver Project Assembler License
+ *
+ * Copyright © 2014 Michał "Griwes" Dominiak
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation is required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ **/
+
+
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <boost/optional.hpp>
+
+#include "../frontend/console.h"
+#include "../driver/driver.h"
+
+namespace
+{
+    using namespace reaver::assembler;
+
+    std::size_t checked = 0;
+    std::size_t failed = 0;
+
+    void expect(const std::string & what, bool condition)
+    {
+        ++checked;
+
+        if (!condition)
+        {
+            ++failed;
+            std::cerr << "failed: " << what << '\n';
+        }
+    }
+
+    const std::string input = "tests/performance.asm";
+    const std::string output = "tests/performance.o";
+
+    // runs `rasm` on the source with the given options, like the command line does; what it printed to stderr, or
+    // nothing if the input was rejected
+    boost::optional<std::string> assemble(const std::string & source, std::vector<std::string> options)
+    {
+        std::ofstream{ input } << source;
+
+        options.insert(options.begin(), { "rasm", input, "-s", "-o", output });
+        std::vector<char *> argv;
+        for (auto & option : options)
+        {
+            argv.push_back(&option[0]);
+        }
+
+        std::ostringstream report;
+        auto old = std::cerr.rdbuf(report.rdbuf());
+        boost::optional<std::string> ret;
+
+        try
+        {
+            reaver::error_engine engine;
+            console_frontend front{ static_cast<int>(argv.size()), argv.data(), engine };
+
+            if (run(front, engine, reaver::logger::dlog) == 0)
+            {
+                ret = report.str();
+            }
+        }
+
+        catch (reaver::error_engine &)
+        {
+        }
+
+        catch (reaver::exception &)
+        {
+        }
+
+        std::cerr.rdbuf(old);
+        std::remove(input.c_str());
+        std::remove(output.c_str());
+        return ret;
+    }
+
+    bool contains(const boost::optional<std::string> & report, const std::string & text)
+    {
+        return report && report->find(text) != std::string::npos;
+    }
+}
+
+int main()
+{
+    const std::string source =
+        "section .text\n"
+        "global _start\n"
+        "_start:\n"
+        "    mov eax, 1\n"
+        "    add eax, ebx\n"
+        "    mov ecx, 10\n"
+        "loop:\n"
+        "    add eax, [rsp + 8]\n"
+        "    dec ecx\n"
+        "    jnz loop\n"
+        "    ret\n";
+
+    auto report = assemble(source, { "--perf-report" });
+    expect("the source is assembled", static_cast<bool>(report));
+    expect("the report names the microarchitecture", contains(report,
+        "Static performance report for skylake (3 basic blocks)"));
+    expect("labels start blocks", contains(report, "block _start (" + input + ":4): 3 instructions"));
+    expect("a label in the middle of code starts a block", contains(report, "block loop (" + input + ":8): 3 instructions"));
+    expect("a branch ends a block", contains(report, "block <anonymous> (" + input + ":11): 1 instructions"));
+    expect("a memory operand adds a load", contains(report, "uops: 4, latency chain: 6.00 cycles"));
+
+    expect("the report is off by default", assemble(source, {}) && !contains(assemble(source, {}), "Static performance"));
+    expect("other microarchitectures are selected with --perf-arch", contains(assemble(source, { "--perf-report",
+        "--perf-arch=zen2" }), "Static performance report for zen2"));
+    expect("an unknown microarchitecture is rejected", !assemble(source, { "--perf-report", "--perf-arch=none" }));
+
+    std::cout << checked - failed << " of " << checked << " performance report checks passed\n";
+    return failed != 0;
+}
@@ -0,0 +1,161 @@
+/**
+ * Reaver Project Assembler License
+ *
+ * Copyright © 2014 Michał "Griwes" Dominiak
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation is required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ **/
+
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../frontend/console.h"
+#include "../driver/driver.h"
+#include "../utils/spsc_queue.h"
+
+namespace
+{
+    using namespace reaver::assembler;
+
+    std::size_t checked = 0;
+    std::size_t failed = 0;
+
+    void expect(const std::string & what, bool condition)
+    {
+        ++checked;
+
+        if (!condition)
+        {
+            ++failed;
+            std::cerr << "failed: " << what << '\n';
+        }
+    }
+
+    const std::string input = "tests/pipeline.asm";
+    const std::string output = "tests/pipeline.o";
+
+    struct result
+    {
+        bool assembled = false;
+        std::string object;
+        std::string report;
+    };
+
+    // runs `rasm` on the source with the given options, like the command line does
+    result assemble(const std::string & source, std::vector<std::string> options)
+    {
+        std::ofstream{ input } << source;
+
+        options.insert(options.begin(), { "rasm", input, "-s", "-o", output });
+        std::vector<char *> argv;
+        for (auto & option : options)
+        {
+            argv.push_back(&option[0]);
+        }
+
+        result ret;
+        std::ostringstream report;
+        auto old = std::cerr.rdbuf(report.rdbuf());
+
+        try
+        {
+            reaver::error_engine engine;
+            console_frontend front{ static_cast<int>(argv.size()), argv.data(), engine };
+            ret.assembled = run(front, engine, reaver::logger::dlog) == 0;
+        }
+
+        catch (reaver::error_engine &)
+        {
+        }
+
+        catch (reaver::exception &)
+        {
+        }
+
+        std::cerr.rdbuf(old);
+        ret.report = report.str();
+
+        if (ret.assembled)
+        {
+            std::ifstream in{ output, std::ios::binary };
+            ret.object.assign(std::istreambuf_iterator<char>{ in }, std::istreambuf_iterator<char>{});
+        }
+
+        std::remove(input.c_str());
+        std::remove(output.c_str());
+        return ret;
+    }
+
+    // three batches, with labels referenced across them
+    std::string source(const std::string & tail = "")
+    {
+        std::string ret = "section .text\nglobal _start\n_start:\n    jmp middle\n";
+
+        for (std::size_t i = 0; i < 5000; ++i)
+        {
+            ret += "    add eax, " + std::to_string(i % 100) + "\n";
+        }
+
+        ret += "middle:\n";
+
+        for (std::size_t i = 0; i < 4000; ++i)
+        {
+            ret += "    nop\n";
+        }
+
+        return ret + "    jmp _start\n" + tail;
+    }
+}
+
+int main()
+{
+    auto sequential = assemble(source(), {});
+    auto pipelined = assemble(source(), { "--pipeline", "--stats" });
+
+    expect("the source is assembled", sequential.assembled && pipelined.assembled);
+    expect("the pipelined object is the same as the sequential one", sequential.object == pipelined.object);
+    expect("every batch goes through the queue", pipelined.report.find("pipeline batches") != std::string::npos
+        && pipelined.report.find(" 3\n", pipelined.report.find("pipeline batches")) != std::string::npos);
+
+    expect("errors in the last batch are reported", !assemble(source("    bogus eax\n"), { "--pipeline" }).assembled);
+    expect("errors in the first batch are reported", !assemble("    bogus eax\n" + source(), { "--pipeline" }).assembled);
+
+    utils::spsc_queue<int> queue{ 4 };
+    expect("a value is pushed", queue.push(1));
+    queue.close();
+    expect("a closed queue takes no more values, even with room left", !queue.push(2));
+
+    int value = 0;
+    expect("values pushed before closing are still delivered", queue.pop(value) && value == 1 && !queue.pop(value));
+
+    utils::spsc_queue<int> full{ 1 };
+    full.push(1);
+    std::thread consumer{ [&](){ std::this_thread::sleep_for(std::chrono::milliseconds{ 10 }); full.close(); } };
+    expect("a producer blocked on a full queue gives up when it is closed", !full.push(2));
+    consumer.join();
+
+    std::cout << checked - failed << " of " << checked << " pipeline checks passed\n";
+    return failed != 0;
+}
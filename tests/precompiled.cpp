@@ -0,0 +1,147 @@
+/**
+ * Reaver Project Assembler License
+ *
+ * Copyright © 2014 Michał "Griwes" Dominiak
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation is required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ **/
+
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+#include <boost/variant/get.hpp>
+
+#include "../frontend/memory.h"
+#include "../parser/intel/intel.h"
+#include "../parser/precompiled.h"
+
+namespace
+{
+    using namespace reaver::assembler;
+
+    std::size_t checked = 0;
+    std::size_t failed = 0;
+
+    void expect(const std::string & what, bool condition)
+    {
+        ++checked;
+
+        if (!condition)
+        {
+            ++failed;
+            std::cerr << "failed: " << what << '\n';
+        }
+    }
+
+    // the whole input as one tree, or nothing if it was rejected
+    boost::optional<ast> parse(const memory_frontend & front)
+    {
+        reaver::error_engine engine;
+        ast ret;
+
+        try
+        {
+            intel_parser{ front, engine }([&](ast && tree){ ret.append(std::move(tree)); });
+            return ret;
+        }
+
+        catch (reaver::error_engine &)
+        {
+            return boost::none;
+        }
+    }
+
+    // writes the snapshot of the header to `path`; false if the header was rejected
+    bool precompile(const std::string & header, const std::string & path)
+    {
+        memory_frontend front{ header };
+        reaver::error_engine engine;
+
+        auto tree = parse(front);
+        if (!tree)
+        {
+            return false;
+        }
+
+        try
+        {
+            reaver::assembler::precompile(front, engine, *tree);
+        }
+
+        catch (reaver::error_engine &)
+        {
+            return false;
+        }
+
+        std::ofstream{ path, std::ios::binary } << front.output_buffer();
+        return true;
+    }
+
+    template<typename T>
+    bool declares(const ast & tree, const std::string & name)
+    {
+        return std::any_of(tree.statements().begin(), tree.statements().end(), [&](const statement & s)
+        {
+            auto declaration = boost::get<T>(&s);
+            return declaration && declaration->name == name;
+        });
+    }
+}
+
+int main()
+{
+    const std::string path = "tests/precompiled.rpch";
+
+    expect("a header of constants and declarations is precompiled", precompile(
+        "; common definitions\n"
+        "answer equ 42\n"
+        "mask equ 0xff00\n"
+        "global entry\n"
+        "extern printf\n", path));
+
+    memory_frontend front{ "db 1\n" };
+    front.add_precompiled_include(path);
+
+    auto tree = parse(front);
+    expect("the snapshot is included", static_cast<bool>(tree));
+    expect("answer is visible", tree && tree->has_constant("answer") && tree->get_constant("answer") == 42);
+    expect("mask is visible", tree && tree->has_constant("mask") && tree->get_constant("mask") == 0xff00);
+    expect("entry is declared global", tree && declares<global_directive>(*tree, "entry"));
+    expect("printf is declared extern", tree && declares<extern_directive>(*tree, "printf"));
+    expect("the declarations lead the input", tree && tree->statements().size() == 3
+        && boost::get<data_directive>(&tree->statements().back()));
+
+    expect("a header with data is not precompiled", !precompile("db 1\n", "tests/rejected.rpch"));
+
+    memory_frontend stale{ "db 1\n", std::string{ "i686-none-elf" } };
+    stale.add_precompiled_include(path);
+    expect("a snapshot for another target is rejected", !parse(stale));
+
+    std::ofstream{ path, std::ios::binary } << "RASMPCH";
+    memory_frontend truncated{ "db 1\n" };
+    truncated.add_precompiled_include(path);
+    expect("a truncated snapshot is rejected", !parse(truncated));
+
+    std::remove(path.c_str());
+
+    std::cout << checked - failed << " of " << checked << " precompiled header checks passed\n";
+    return failed != 0;
+}
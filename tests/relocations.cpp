@@ -0,0 +1,173 @@
+/**
+ * Reaver Project Assembler License
+ *
+ * Copyright © 2014 Michał "Griwes" Dominiak
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation is required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ **/
+
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <elf.h>
+
+#include "../generator/intel/encoding.h"
+#include "../generator/object.h"
+#include "../output/object/elf.h"
+
+namespace
+{
+    using namespace reaver::assembler;
+
+    std::size_t checked = 0;
+    std::size_t failed = 0;
+
+    void expect(const std::string & what, bool condition)
+    {
+        ++checked;
+
+        if (!condition)
+        {
+            ++failed;
+            std::cerr << "failed: " << what << '\n';
+        }
+    }
+
+    intel::operand symbolic_immediate()
+    {
+        intel::operand ret;
+        ret.kind = intel::operand_kind::immediate;
+        ret.symbolic = true;
+        return ret;
+    }
+
+    intel::operand symbolic_memory(const char * base = nullptr)
+    {
+        intel::operand ret;
+        ret.kind = intel::operand_kind::memory;
+        ret.memory.base = base ? intel::find_register(base) : nullptr;
+        ret.memory.size = 32;
+        ret.symbolic = true;
+        return ret;
+    }
+
+    void expect_fixup(const std::string & what, const intel::instruction & instr, intel::mode mode, bool sign_extended)
+    {
+        auto encoded = intel::encoder_for(mode)(instr);
+        expect(what + " encodes", encoded.error == intel::encoding_error::none && encoded.fixup_count == 1);
+        expect(what + (sign_extended ? " is sign extended" : " is zero extended"), encoded.fixup_count
+            && encoded.fixups[0].size == 4 && encoded.fixups[0].sign_extended == sign_extended);
+    }
+
+    bool relocate(relocation_type type, std::int64_t value)
+    {
+        char field[8] = {};
+        return reaver::assembler::relocate(field, { 0, "sym", type, 0 }, value, 0);
+    }
+
+    // writes an object with a single relocation and returns the type of that relocation in the output
+    std::uint32_t written_type(bool elf64, relocation_type type)
+    {
+        object obj;
+        auto & text = obj.get_section(".text");
+        text.blob.resize(8);
+        text.relocations.push_back({ 0, "sym", type, 0 });
+        obj.get_symbol("sym");
+
+        reaver::error_engine engine;
+        elf_writer writer{ obj, elf64, static_cast<std::uint16_t>(elf64 ? EM_X86_64 : EM_386), engine };
+
+        std::vector<char> image(writer.size());
+        for (std::size_t i = 0; i < writer.pieces(); ++i)
+        {
+            writer.serialize(i);
+
+            auto offset = writer.offset(i);
+            for (const auto & vec : writer.iovecs(i))
+            {
+                std::memcpy(image.data() + offset, vec.iov_base, vec.iov_len);
+                offset += vec.iov_len;
+            }
+        }
+
+        auto find = [&](auto header, auto section, std::uint32_t kind) -> std::uint64_t
+        {
+            std::memcpy(&header, image.data(), sizeof(header));
+
+            for (std::size_t i = 0; i < header.e_shnum; ++i)
+            {
+                std::memcpy(&section, image.data() + header.e_shoff + i * sizeof(section), sizeof(section));
+
+                if (section.sh_type == kind)
+                {
+                    return section.sh_offset;
+                }
+            }
+
+            return 0;
+        };
+
+        if (elf64)
+        {
+            Elf64_Rela entry;
+            std::memcpy(&entry, image.data() + find(Elf64_Ehdr{}, Elf64_Shdr{}, SHT_RELA), sizeof(entry));
+            return ELF64_R_TYPE(entry.r_info);
+        }
+
+        Elf32_Rel entry;
+        std::memcpy(&entry, image.data() + find(Elf32_Ehdr{}, Elf32_Shdr{}, SHT_REL), sizeof(entry));
+        return ELF32_R_TYPE(entry.r_info);
+    }
+}
+
+int main()
+{
+    using intel::mode;
+    using intel::instruction;
+    using intel::reg;
+
+    // 32 bit fields the cpu sign extends to 64 bits
+    expect_fixup("mov rax, sym", instruction{ "mov", reg("rax"), symbolic_immediate() }, mode::bits64, true);
+    expect_fixup("push sym", instruction{ "push", symbolic_immediate() }, mode::bits64, true);
+    expect_fixup("mov eax, [sym]", instruction{ "mov", reg("eax"), symbolic_memory() }, mode::bits64, true);
+    expect_fixup("mov eax, [rbx + sym]", instruction{ "mov", reg("eax"), symbolic_memory("rbx") }, mode::bits64, true);
+
+    // and the ones it does not
+    expect_fixup("mov eax, sym", instruction{ "mov", reg("eax"), symbolic_immediate() }, mode::bits64, false);
+    expect_fixup("mov eax, [ebx + sym]", instruction{ "mov", reg("eax"), symbolic_memory("ebx") }, mode::bits64, false);
+    expect_fixup("mov eax, sym in 32 bit mode", instruction{ "mov", reg("eax"), symbolic_immediate() }, mode::bits32, false);
+    expect_fixup("mov eax, [sym] in 32 bit mode", instruction{ "mov", reg("eax"), symbolic_memory() }, mode::bits32, false);
+    expect_fixup("push sym in 32 bit mode", instruction{ "push", symbolic_immediate() }, mode::bits32, false);
+
+    expect("absolute32 takes 0xffffffff", relocate(relocation_type::absolute32, 0xffffffff));
+    expect("absolute32 rejects -1", !relocate(relocation_type::absolute32, -1));
+    expect("absolute32 rejects 1 << 32", !relocate(relocation_type::absolute32, std::int64_t{ 1 } << 32));
+    expect("absolute32s takes 0x7fffffff", relocate(relocation_type::absolute32s, 0x7fffffff));
+    expect("absolute32s takes -0x80000000", relocate(relocation_type::absolute32s, -0x80000000ll));
+    expect("absolute32s rejects 0x80000000", !relocate(relocation_type::absolute32s, 0x80000000));
+    expect("relative32 rejects 0x80000000", !relocate(relocation_type::relative32, 0x80000000));
+
+    expect("elf64 absolute32 is R_X86_64_32", written_type(true, relocation_type::absolute32) == R_X86_64_32);
+    expect("elf64 absolute32s is R_X86_64_32S", written_type(true, relocation_type::absolute32s) == R_X86_64_32S);
+    expect("elf32 absolute32 is R_386_32", written_type(false, relocation_type::absolute32) == R_386_32);
+    expect("elf32 absolute32s is R_386_32", written_type(false, relocation_type::absolute32s) == R_386_32);
+
+    std::cout << checked - failed << " of " << checked << " relocation checks passed\n";
+    return failed != 0;
+}
@@ -0,0 +1,179 @@
+/**
+ * Reaver Project Assembler License
+ *
+ * Copyright © 2014 Michał "Griwes" Dominiak
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation is required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ **/
+
+
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include <sys/wait.h>
+
+#include "../frontend/console.h"
+#include "../driver/driver.h"
+
+namespace
+{
+    using namespace reaver::assembler;
+
+    std::size_t checked = 0;
+    std::size_t failed = 0;
+
+    void expect(const std::string & what, bool condition)
+    {
+        ++checked;
+
+        if (!condition)
+        {
+            ++failed;
+            std::cerr << "failed: " << what << '\n';
+        }
+    }
+
+    const std::string input = "tests/sections.asm";
+    const std::string output = "tests/sections.exe";
+
+    // a function per section, as a compiler emits them with -ffunction-sections; `unused` is unreachable from
+    // `_start`, and the two twins are identical
+    const std::string source =
+        "section .text\n"
+        "global _start\n"
+        "_start:\n"
+        "    call    used\n"
+        "    mov     edi, eax\n"
+        "    call    twin_a\n"
+        "    call    twin_b\n"
+        "    mov     eax, 60\n"
+        "    syscall\n"
+        "section .text.used\n"
+        "used:\n"
+        "    mov     eax, 3\n"
+        "    ret\n"
+        "section .text.unused\n"
+        "unused:\n"
+        "    mov     eax, 0x12345678\n"
+        "    ret\n"
+        "section .text.twin_a\n"
+        "twin_a:\n"
+        "    add     edi, 0x0badf00d\n"
+        "    ret\n"
+        "section .text.twin_b\n"
+        "twin_b:\n"
+        "    add     edi, 0x0badf00d\n"
+        "    ret\n";
+
+    struct linked
+    {
+        std::string image;
+        int status = -1;
+    };
+
+    // assembles and links the source with the given options, like the command line does, and runs the executable
+    linked link(std::vector<std::string> options)
+    {
+        std::ofstream{ input } << source;
+
+        options.insert(options.begin(), { "rasm", input, "-o", output });
+        std::vector<char *> argv;
+        for (auto & option : options)
+        {
+            argv.push_back(&option[0]);
+        }
+
+        linked ret;
+        bool assembled = false;
+
+        // the frontend keeps the output open until it is destroyed, and an executable open for writing cannot be run
+        try
+        {
+            reaver::error_engine engine;
+            console_frontend front{ static_cast<int>(argv.size()), argv.data(), engine };
+            assembled = run(front, engine, reaver::logger::dlog) == 0;
+        }
+
+        catch (reaver::error_engine &)
+        {
+        }
+
+        catch (reaver::exception &)
+        {
+        }
+
+        if (assembled)
+        {
+            std::ifstream in{ output, std::ios::binary };
+            ret.image.assign(std::istreambuf_iterator<char>{ in }, std::istreambuf_iterator<char>{});
+
+            auto status = std::system(output.c_str());
+            ret.status = WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+        }
+
+        std::remove(input.c_str());
+        std::remove(output.c_str());
+        return ret;
+    }
+
+    std::size_t occurrences(const std::string & image, const std::string & bytes)
+    {
+        std::size_t ret = 0;
+
+        for (auto position = image.find(bytes); position != std::string::npos; position = image.find(bytes, position + 1))
+        {
+            ++ret;
+        }
+
+        return ret;
+    }
+
+    const std::string unused_code = "\x78\x56\x34\x12";
+    const std::string twin_code = "\x0d\xf0\xad\x0b";
+    // 3 + 2 * 0x0badf00d, truncated to the exit status
+    const int expected_status = 29;
+}
+
+int main()
+{
+    auto plain = link({});
+    expect("the executable runs", plain.status == expected_status);
+    expect("everything is linked by default", occurrences(plain.image, unused_code) == 1
+        && occurrences(plain.image, twin_code) == 2);
+
+    auto collected = link({ "--gc-sections" });
+    expect("the executable runs with --gc-sections", collected.status == expected_status);
+    expect("--gc-sections removes unreachable sections", occurrences(collected.image, unused_code) == 0);
+    expect("--gc-sections keeps reachable sections", occurrences(collected.image, twin_code) == 2);
+
+    auto folded = link({ "--icf" });
+    expect("the executable runs with --icf", folded.status == expected_status);
+    expect("--icf folds identical sections", occurrences(folded.image, twin_code) == 1);
+    expect("--icf keeps distinct sections", occurrences(folded.image, unused_code) == 1);
+
+    auto both = link({ "--gc-sections", "--icf" });
+    expect("the executable runs with both", both.status == expected_status);
+    expect("both shrink the executable the most", !both.image.empty() && both.image.size() < collected.image.size()
+        && both.image.size() < folded.image.size() && folded.image.size() < plain.image.size());
+
+    std::cout << checked - failed << " of " << checked << " section garbage collection and folding checks passed\n";
+    return failed != 0;
+}
@@ -0,0 +1,194 @@
+/**
+ * Reaver Project Assembler License
+ *
+ * Copyright © 2014 Michał "Griwes" Dominiak
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation is required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ **/
+
+
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <sys/wait.h>
+
+#include <boost/variant/get.hpp>
+
+#include "../frontend/console.h"
+#include "../frontend/memory.h"
+#include "../parser/intel/intel.h"
+#include "../generator/generator.h"
+#include "../driver/driver.h"
+
+namespace
+{
+    using namespace reaver::assembler;
+
+    std::size_t checked = 0;
+    std::size_t failed = 0;
+
+    void expect(const std::string & what, bool condition)
+    {
+        ++checked;
+
+        if (!condition)
+        {
+            ++failed;
+            std::cerr << "failed: " << what << '\n';
+        }
+    }
+
+    // long enough to be split into three batches; the constant, the labels and the section switches all cross batch
+    // boundaries
+    std::string source()
+    {
+        std::string ret = "status equ 5\nsection .text\nglobal _start\n_start:\n    jmp far_away\n";
+
+        for (std::size_t i = 0; i < 5000; ++i)
+        {
+            ret += "    add eax, " + std::to_string(i % 100) + "\n";
+        }
+
+        ret += "section .data\nvalue: dd 1\nsection .text\nfar_away:\n    mov edi, status\n    mov eax, 60\n    syscall\n";
+
+        for (std::size_t i = 0; i < 4000; ++i)
+        {
+            ret += "    nop\n";
+        }
+
+        return ret + "    jmp _start\n";
+    }
+
+    bool same(const object & lhs, const object & rhs)
+    {
+        if (lhs.sections().size() != rhs.sections().size() || lhs.symbols().size() != rhs.symbols().size())
+        {
+            return false;
+        }
+
+        for (std::size_t i = 0; i < lhs.sections().size(); ++i)
+        {
+            const auto & l = lhs.sections()[i];
+            const auto & r = rhs.sections()[i];
+
+            if (l.name != r.name || l.blob != r.blob || l.relocations.size() != r.relocations.size())
+            {
+                return false;
+            }
+
+            for (std::size_t j = 0; j < l.relocations.size(); ++j)
+            {
+                if (l.relocations[j].offset != r.relocations[j].offset || l.relocations[j].symbol != r.relocations[j].symbol
+                    || l.relocations[j].type != r.relocations[j].type || l.relocations[j].addend != r.relocations[j].addend)
+                {
+                    return false;
+                }
+            }
+        }
+
+        for (const auto & sym : lhs.symbols())
+        {
+            auto it = rhs.symbols().find(sym.first);
+            if (it == rhs.symbols().end() || it->second.section != sym.second.section
+                || it->second.offset != sym.second.offset || it->second.global != sym.second.global)
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+}
+
+int main()
+{
+    memory_frontend front{ source() };
+    reaver::error_engine engine;
+
+    std::vector<ast> batches;
+    intel_parser{ front, engine }([&](ast && batch){ batches.push_back(std::move(batch)); });
+    expect("the source is parsed in batches", batches.size() == 3);
+
+    bool resolved = false;
+    for (std::size_t i = 1; i < batches.size(); ++i)
+    {
+        for (const auto & statement : batches[i].statements())
+        {
+            auto instr = boost::get<instruction>(&statement);
+            if (instr && instr->mnemonic == "mov" && instr->operands.size() == 2)
+            {
+                auto value = boost::get<constant>(&instr->operands[1]);
+                resolved = resolved || (value && value->name == "status" && value->value == 5);
+            }
+        }
+    }
+    expect("constants reach later batches", resolved);
+
+    auto generator = create_generator(front, engine);
+    auto session = generator->start();
+    ast whole;
+
+    for (auto & batch : batches)
+    {
+        (*session)(batch);
+        whole.append(std::move(batch));
+    }
+
+    auto streamed = session->finish();
+    auto generated = (*generator)(whole);
+    expect("a streamed object is the same as one generated from the whole tree", same(*streamed, *generated));
+
+    const std::string input = "tests/streaming.asm";
+    const std::string output = "tests/streaming.exe";
+    std::ofstream{ input } << source();
+
+    std::vector<std::string> arguments{ "rasm", input, "-o", output };
+    std::vector<char *> argv;
+    for (auto & argument : arguments)
+    {
+        argv.push_back(&argument[0]);
+    }
+
+    bool assembled = false;
+
+    try
+    {
+        reaver::error_engine cli_engine;
+        console_frontend cli{ static_cast<int>(argv.size()), argv.data(), cli_engine };
+        assembled = run(cli, cli_engine, reaver::logger::dlog) == 0;
+    }
+
+    catch (reaver::error_engine &)
+    {
+    }
+
+    catch (reaver::exception &)
+    {
+    }
+
+    auto status = assembled ? std::system(output.c_str()) : -1;
+    expect("a streamed executable runs", assembled && WIFEXITED(status) && WEXITSTATUS(status) == 5);
+
+    std::remove(input.c_str());
+    std::remove(output.c_str());
+
+    std::cout << checked - failed << " of " << checked << " streaming checks passed\n";
+    return failed != 0;
+}
@@ -0,0 +1,95 @@
+/**
+ * Reaver Project Assembler License
+ *
+ * Copyright © 2014 Michał "Griwes" Dominiak
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation is required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ **/
+
+#include <algorithm>
+#include <iostream>
+#include <string>
+
+#include "../frontend/memory.h"
+#include "../parser/intel/intel.h"
+#include "../generator/intel/intel.h"
+
+namespace
+{
+    using namespace reaver::assembler;
+
+    std::size_t checked = 0;
+    std::size_t failed = 0;
+
+    void expect(const std::string & what, bool condition)
+    {
+        ++checked;
+
+        if (!condition)
+        {
+            ++failed;
+            std::cerr << "failed: " << what << '\n';
+        }
+    }
+
+    // returns the contents of .text, or nothing if the source was rejected
+    boost::optional<std::vector<char>> assemble(const std::string & source)
+    {
+        memory_frontend front{ source };
+        reaver::error_engine engine;
+
+        try
+        {
+            auto session = intel_generator{ front, engine }.start();
+            intel_parser{ front, engine }([&](ast && tree){ (*session)(tree); });
+            return session->finish()->get_section(".text").blob;
+        }
+
+        catch (reaver::error_engine &)
+        {
+            return boost::none;
+        }
+    }
+}
+
+int main()
+{
+    auto nops = assemble("times 4 db 0x90\n");
+    expect("times 4 db 0x90 assembles", static_cast<bool>(nops));
+    expect("times 4 db 0x90 is four nops", nops && *nops == std::vector<char>(4, static_cast<char>(0x90)));
+
+    auto pattern = assemble("times 3 dw 0x1234, 'a'\n");
+    std::vector<char> expected;
+    for (int i = 0; i < 3; ++i)
+    {
+        expected.insert(expected.end(), { 0x34, 0x12, 'a', 0 });
+    }
+    expect("times 3 dw 0x1234, 'a' repeats the whole list", pattern && *pattern == expected);
+
+    auto large = assemble("times 1048576 db 0\n");
+    expect("times 1048576 db 0 is a megabyte of zeros", large && large->size() == 1048576
+        && std::all_of(large->begin(), large->end(), [](char c){ return c == 0; }));
+
+    auto none = assemble("times 0 db 1\n");
+    expect("times 0 db 1 emits nothing", none && none->empty());
+
+    expect("times 4 nop is rejected", !assemble("times 4 nop\n"));
+    expect("times without a count is rejected", !assemble("times db 0\n"));
+
+    std::cout << checked - failed << " of " << checked << " repetition checks passed\n";
+    return failed != 0;
+}
@@ -0,0 +1,64 @@
+/**
+ * Reaver Project Assembler License
+ *
+ * Copyright © 2014 Michał "Griwes" Dominiak
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation is required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ **/
+
+#include <atomic>
+
+#include "allocation.h"
+
+namespace
+{
+    std::atomic<std::uint64_t> _allocations{ 0 };
+    std::atomic<std::uint64_t> _bytes{ 0 };
+    std::atomic<std::uint64_t> _live{ 0 };
+    std::atomic<std::uint64_t> _peak{ 0 };
+}
+
+void reaver::assembler::utils::allocation::allocated(std::size_t size)
+{
+    _allocations.fetch_add(1, std::memory_order_relaxed);
+    _bytes.fetch_add(size, std::memory_order_relaxed);
+    raise_peak(_live.fetch_add(size, std::memory_order_relaxed) + size);
+}
+
+void reaver::assembler::utils::allocation::released(std::size_t size)
+{
+    _live.fetch_sub(size, std::memory_order_relaxed);
+}
+
+reaver::assembler::utils::allocation::snapshot reaver::assembler::utils::allocation::current()
+{
+    return { _allocations.load(std::memory_order_relaxed), _bytes.load(std::memory_order_relaxed),
+        _live.load(std::memory_order_relaxed), _peak.load(std::memory_order_relaxed) };
+}
+
+std::uint64_t reaver::assembler::utils::allocation::reset_peak()
+{
+    return _peak.exchange(_live.load(std::memory_order_relaxed), std::memory_order_relaxed);
+}
+
+void reaver::assembler::utils::allocation::raise_peak(std::uint64_t value)
+{
+    auto peak = _peak.load(std::memory_order_relaxed);
+    while (peak < value && !_peak.compare_exchange_weak(peak, value, std::memory_order_relaxed))
+    {
+    }
+}
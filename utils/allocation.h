@@ -0,0 +1,61 @@
+/**
+ * Reaver Project Assembler License
+ *
+ * Copyright © 2014 Michał "Griwes" Dominiak
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation is required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ **/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace reaver
+{
+    namespace assembler
+    {
+        namespace utils
+        {
+            namespace allocation
+            {
+#ifdef REAVER_ASSEMBLER_ALLOC_STATS
+                constexpr bool enabled = true;
+#else
+                constexpr bool enabled = false;
+#endif
+
+                struct snapshot
+                {
+                    std::uint64_t allocations;
+                    std::uint64_t bytes;
+                    std::uint64_t live;
+                    std::uint64_t peak;
+                };
+
+                void allocated(std::size_t);
+                void released(std::size_t);
+
+                snapshot current();
+
+                // lowers the high-water mark to the current live size; returns the previous mark
+                std::uint64_t reset_peak();
+                void raise_peak(std::uint64_t);
+            }
+        }
+    }
+}
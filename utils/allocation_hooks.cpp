@@ -0,0 +1,162 @@
+/**
+ * Reaver Project Assembler License
+ *
+ * Copyright © 2014 Michał "Griwes" Dominiak
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation is required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ **/
+
+// replacement allocation functions for instrumented builds (make ALLOC_STATS=1); linked into the executable only, so
+// that they take precedence over the ones provided by the C++ runtime library
+
+#ifdef REAVER_ASSEMBLER_ALLOC_STATS
+
+#include <cstdlib>
+#include <new>
+
+#include <malloc.h>
+
+#include "allocation.h"
+
+namespace
+{
+    void * _allocate(std::size_t size, std::size_t alignment = 0)
+    {
+        void * ptr = nullptr;
+
+        if (alignment > alignof(std::max_align_t))
+        {
+            if (posix_memalign(&ptr, alignment, size ? size : 1))
+            {
+                ptr = nullptr;
+            }
+        }
+
+        else
+        {
+            ptr = std::malloc(size ? size : 1);
+        }
+
+        if (ptr)
+        {
+            reaver::assembler::utils::allocation::allocated(malloc_usable_size(ptr));
+        }
+
+        return ptr;
+    }
+
+    void _release(void * ptr)
+    {
+        if (ptr)
+        {
+            reaver::assembler::utils::allocation::released(malloc_usable_size(ptr));
+            std::free(ptr);
+        }
+    }
+}
+
+void * operator new(std::size_t size)
+{
+    if (auto ptr = _allocate(size))
+    {
+        return ptr;
+    }
+
+    throw std::bad_alloc{};
+}
+
+void * operator new[](std::size_t size)
+{
+    return operator new(size);
+}
+
+void * operator new(std::size_t size, std::align_val_t alignment)
+{
+    if (auto ptr = _allocate(size, static_cast<std::size_t>(alignment)))
+    {
+        return ptr;
+    }
+
+    throw std::bad_alloc{};
+}
+
+void * operator new[](std::size_t size, std::align_val_t alignment)
+{
+    return operator new(size, alignment);
+}
+
+void * operator new(std::size_t size, const std::nothrow_t &) noexcept
+{
+    return _allocate(size);
+}
+
+void * operator new[](std::size_t size, const std::nothrow_t &) noexcept
+{
+    return _allocate(size);
+}
+
+void operator delete(void * ptr) noexcept
+{
+    _release(ptr);
+}
+
+void operator delete[](void * ptr) noexcept
+{
+    _release(ptr);
+}
+
+void operator delete(void * ptr, std::size_t) noexcept
+{
+    _release(ptr);
+}
+
+void operator delete[](void * ptr, std::size_t) noexcept
+{
+    _release(ptr);
+}
+
+void operator delete(void * ptr, std::align_val_t) noexcept
+{
+    _release(ptr);
+}
+
+void operator delete[](void * ptr, std::align_val_t) noexcept
+{
+    _release(ptr);
+}
+
+void operator delete(void * ptr, std::size_t, std::align_val_t) noexcept
+{
+    _release(ptr);
+}
+
+void operator delete[](void * ptr, std::size_t, std::align_val_t) noexcept
+{
+    _release(ptr);
+}
+
+void operator delete(void * ptr, const std::nothrow_t &) noexcept
+{
+    _release(ptr);
+}
+
+void operator delete[](void * ptr, const std::nothrow_t &) noexcept
+{
+    _release(ptr);
+}
+
+#endif
@@ -0,0 +1,446 @@
+/**
+ * Reaver Project Assembler License
+ *
+ * Copyright © 2014 Michał "Griwes" Dominiak
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation is required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ **/
+
+#pragma once
+
+#include <streambuf>
+#include <array>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <system_error>
+#include <vector>
+#include <algorithm>
+
+#include <sys/uio.h>
+#include <sys/stat.h>
+#include <sys/sendfile.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <climits>
+
+namespace reaver
+{
+    namespace assembler
+    {
+        namespace utils
+        {
+            inline void write_all(int fd, const char * data, std::size_t size)
+            {
+                while (size)
+                {
+                    auto written = ::write(fd, data, size);
+
+                    if (written < 0)
+                    {
+                        if (errno == EINTR)
+                        {
+                            continue;
+                        }
+
+                        throw std::system_error{ errno, std::system_category(), "write" };
+                    }
+
+                    data += written;
+                    size -= written;
+                }
+            }
+
+            inline void pwrite_all(int fd, const char * data, std::size_t size, off_t offset)
+            {
+                while (size)
+                {
+                    auto written = ::pwrite(fd, data, size, offset);
+
+                    if (written < 0)
+                    {
+                        if (errno == EINTR)
+                        {
+                            continue;
+                        }
+
+                        throw std::system_error{ errno, std::system_category(), "pwrite" };
+                    }
+
+                    data += written;
+                    size -= written;
+                    offset += written;
+                }
+            }
+
+            // bytes of another file that are written to the output without being read into memory
+            struct file_extent
+            {
+                std::string path;
+                std::uint64_t offset;
+                std::uint64_t size;
+            };
+
+            class _source
+            {
+            public:
+                _source(const file_extent & extent) : _fd{ ::open(extent.path.c_str(), O_RDONLY | O_CLOEXEC) }
+                {
+                    if (_fd < 0)
+                    {
+                        throw std::system_error{ errno, std::system_category(), "open `" + extent.path + "`" };
+                    }
+                }
+
+                ~_source()
+                {
+                    ::close(_fd);
+                }
+
+                operator int() const
+                {
+                    return _fd;
+                }
+
+            private:
+                int _fd;
+            };
+
+            inline void read_extent(const file_extent & extent, char * data)
+            {
+                _source source{ extent };
+                auto position = static_cast<off_t>(extent.offset);
+
+                for (auto size = extent.size; size; )
+                {
+                    auto received = ::pread(source, data, size, position);
+
+                    if (received < 0 && errno == EINTR)
+                    {
+                        continue;
+                    }
+
+                    if (received <= 0)
+                    {
+                        throw std::system_error{ received ? errno : EIO, std::system_category(), "read `" + extent.path + "`" };
+                    }
+
+                    data += received;
+                    position += received;
+                    size -= received;
+                }
+            }
+
+            // copies in the kernel: copy_file_range between regular files, sendfile into pipes and sockets; `offset`, if
+            // given, is the position in the output to write at, and is advanced past the copied bytes
+            inline void copy_extent(int fd, const file_extent & extent, off_t * offset = nullptr)
+            {
+                _source source{ extent };
+                auto position = static_cast<off_t>(extent.offset);
+                auto size = extent.size;
+
+                bool kernel = true;
+                std::array<char, 64 * 1024> buffer;
+
+                while (size)
+                {
+                    ssize_t copied = -1;
+
+                    if (kernel)
+                    {
+                        copied = ::copy_file_range(source, &position, fd, offset, size, 0);
+
+                        if (copied < 0 && errno != EINTR && !offset)
+                        {
+                            copied = ::sendfile(fd, source, &position, size);
+                        }
+
+                        if (copied < 0 && errno != EINTR)
+                        {
+                            kernel = false;
+                            continue;
+                        }
+                    }
+
+                    else
+                    {
+                        copied = ::pread(source, buffer.data(), std::min<std::uint64_t>(size, buffer.size()), position);
+
+                        if (copied > 0 && offset)
+                        {
+                            pwrite_all(fd, buffer.data(), copied, *offset);
+                            *offset += copied;
+                        }
+
+                        else if (copied > 0)
+                        {
+                            write_all(fd, buffer.data(), copied);
+                        }
+
+                        position += std::max<ssize_t>(copied, 0);
+                    }
+
+                    if (copied < 0 && errno == EINTR)
+                    {
+                        continue;
+                    }
+
+                    if (copied <= 0)
+                    {
+                        throw std::system_error{ copied ? errno : EIO, std::system_category(), "copy `" + extent.path + "`" };
+                    }
+
+                    size -= copied;
+                }
+            }
+
+            inline void write_all(int fd, std::vector<iovec> iovecs)
+            {
+                auto current = iovecs.begin();
+
+                while (current != iovecs.end())
+                {
+                    auto count = std::min<std::ptrdiff_t>(iovecs.end() - current, IOV_MAX);
+                    auto written = ::writev(fd, &*current, count);
+
+                    if (written < 0)
+                    {
+                        if (errno == EINTR)
+                        {
+                            continue;
+                        }
+
+                        throw std::system_error{ errno, std::system_category(), "writev" };
+                    }
+
+                    while (current != iovecs.end() && static_cast<std::size_t>(written) >= current->iov_len)
+                    {
+                        written -= current->iov_len;
+                        ++current;
+                    }
+
+                    if (current != iovecs.end())
+                    {
+                        current->iov_base = static_cast<char *>(current->iov_base) + written;
+                        current->iov_len -= written;
+                    }
+                }
+            }
+
+            inline void write_all(std::ostream & out, int fd, std::vector<iovec> iovecs)
+            {
+                if (fd >= 0)
+                {
+                    write_all(fd, std::move(iovecs));
+                    return;
+                }
+
+                for (const auto & vec : iovecs)
+                {
+                    out.write(static_cast<const char *>(vec.iov_base), vec.iov_len);
+                }
+            }
+
+            inline void pwrite_all(int fd, std::vector<iovec> iovecs, off_t offset)
+            {
+                auto current = iovecs.begin();
+
+                while (current != iovecs.end())
+                {
+                    auto count = std::min<std::ptrdiff_t>(iovecs.end() - current, IOV_MAX);
+                    auto written = ::pwritev(fd, &*current, count, offset);
+
+                    if (written < 0)
+                    {
+                        if (errno == EINTR)
+                        {
+                            continue;
+                        }
+
+                        throw std::system_error{ errno, std::system_category(), "pwritev" };
+                    }
+
+                    offset += written;
+
+                    while (current != iovecs.end() && static_cast<std::size_t>(written) >= current->iov_len)
+                    {
+                        written -= current->iov_len;
+                        ++current;
+                    }
+
+                    if (current != iovecs.end())
+                    {
+                        current->iov_base = static_cast<char *>(current->iov_base) + written;
+                        current->iov_len -= written;
+                    }
+                }
+            }
+
+            // iovecs with a null base stand for the extents, in order
+            inline void write_all(std::ostream & out, int fd, std::vector<iovec> iovecs,
+                const std::vector<file_extent> & extents)
+            {
+                auto extent = extents.begin();
+                auto run = iovecs.begin();
+
+                for (auto it = iovecs.begin(); it != iovecs.end(); ++it)
+                {
+                    if (it->iov_base)
+                    {
+                        continue;
+                    }
+
+                    write_all(out, fd, { run, it });
+                    run = it + 1;
+
+                    if (fd >= 0)
+                    {
+                        copy_extent(fd, *extent++);
+                        continue;
+                    }
+
+                    std::vector<char> contents(extent->size);
+                    read_extent(*extent++, contents.data());
+                    out.write(contents.data(), contents.size());
+                }
+
+                write_all(out, fd, { run, iovecs.end() });
+            }
+
+            inline void pwrite_all(int fd, std::vector<iovec> iovecs, off_t offset, const std::vector<file_extent> & extents)
+            {
+                auto extent = extents.begin();
+                auto run = iovecs.begin();
+
+                for (auto it = iovecs.begin(); it != iovecs.end(); ++it)
+                {
+                    if (it->iov_base)
+                    {
+                        continue;
+                    }
+
+                    for (auto vec = run; vec != it; ++vec)
+                    {
+                        pwrite_all(fd, static_cast<const char *>(vec->iov_base), vec->iov_len, offset);
+                        offset += vec->iov_len;
+                    }
+
+                    copy_extent(fd, *extent++, &offset);
+                    run = it + 1;
+                }
+
+                pwrite_all(fd, { run, iovecs.end() }, offset);
+            }
+
+            inline bool seekable(int fd)
+            {
+                struct stat info;
+                return ::fstat(fd, &info) == 0 && S_ISREG(info.st_mode);
+            }
+
+            inline void preallocate(int fd, off_t size)
+            {
+                if (::ftruncate(fd, size) < 0)
+                {
+                    throw std::system_error{ errno, std::system_category(), "ftruncate" };
+                }
+
+                // not every filesystem supports it; the file already has its final size, so this is only a hint
+                ::posix_fallocate(fd, 0, size);
+            }
+
+            class descriptor_input_buffer : public std::streambuf
+            {
+            public:
+                descriptor_input_buffer(int fd = -1) : _fd{ fd }
+                {
+                }
+
+            protected:
+                virtual int_type underflow() override
+                {
+                    if (gptr() < egptr())
+                    {
+                        return traits_type::to_int_type(*gptr());
+                    }
+
+                    ssize_t received;
+                    do
+                    {
+                        received = ::read(_fd, _buffer.data(), _buffer.size());
+                    } while (received < 0 && errno == EINTR);
+
+                    if (received < 0)
+                    {
+                        throw std::system_error{ errno, std::system_category(), "read" };
+                    }
+
+                    if (received == 0)
+                    {
+                        return traits_type::eof();
+                    }
+
+                    setg(_buffer.data(), _buffer.data(), _buffer.data() + received);
+                    return traits_type::to_int_type(*gptr());
+                }
+
+            private:
+                int _fd;
+                std::array<char, 64 * 1024> _buffer;
+            };
+
+            class descriptor_buffer : public std::streambuf
+            {
+            public:
+                descriptor_buffer(int fd = -1) : _fd{ fd }
+                {
+                }
+
+                void reset(int fd)
+                {
+                    _fd = fd;
+                }
+
+                int descriptor() const
+                {
+                    return _fd;
+                }
+
+            protected:
+                virtual int_type overflow(int_type c) override
+                {
+                    if (c != traits_type::eof())
+                    {
+                        char ch = traits_type::to_char_type(c);
+                        write_all(_fd, &ch, 1);
+                    }
+
+                    return traits_type::not_eof(c);
+                }
+
+                virtual std::streamsize xsputn(const char * data, std::streamsize size) override
+                {
+                    write_all(_fd, data, size);
+                    return size;
+                }
+
+            private:
+                int _fd;
+            };
+        }
+    }
+}
@@ -0,0 +1,169 @@
+/**
+ * Reaver Project Assembler License
+ *
+ * Copyright © 2014 Michał "Griwes" Dominiak
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation is required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ **/
+
+#include "diagnostics.h"
+
+namespace
+{
+    const char * _format(reaver::assembler::utils::message id)
+    {
+        using reaver::assembler::utils::message;
+
+        switch (id)
+        {
+            case message::too_many_errors:
+                return "too many errors emitted, stopping now.";
+            case message::invalid_line_continuation:
+                return "invalid `\\` at the end of file.";
+            case message::unexpected_character:
+                return "unexpected character `%0`.";
+            case message::too_many_operands:
+                return "too many operands for `%0`.";
+            case message::unknown_instruction:
+                return "unknown instruction `%0`.";
+            case message::invalid_operands:
+                return "invalid combination of operands for `%0`.";
+            case message::ambiguous_size:
+                return "operand size not specified for `%0`.";
+            case message::invalid_address:
+                return "invalid effective address.";
+            case message::invalid_in_mode:
+                return "`%0` cannot be encoded in %1 bit mode.";
+            case message::rex_conflict:
+                return "high byte registers cannot be used in an instruction requiring a REX prefix.";
+            case message::unknown_prefix:
+                return "unknown prefix `%0`.";
+            case message::label_redefinition:
+                return "redefinition of label `%0`.";
+            case message::long_mode_unavailable:
+                return "64 bit mode is not available for this target.";
+            case message::invalid_mode:
+                return "invalid mode `%0`; allowed modes are 16, 32 and 64.";
+            case message::invalid_integer:
+                return "invalid integer value.";
+            case message::invalid_register:
+                return "invalid register `%0`.";
+            case message::far_address:
+                return "far addresses are not supported.";
+            case message::invalid_base_register:
+                return "invalid base register `%0`.";
+            case message::floating_point_operand:
+                return "floating point operands are not allowed for `%0`.";
+            case message::undefined_symbol:
+                return "symbol `%0` is undefined.";
+            case message::invalid_precompiled_header:
+                return "`%0` is not a valid precompiled header.";
+            case message::stale_precompiled_header:
+                return "precompiled header `%0` was built with a different %1; rebuild it.";
+            case message::not_a_declaration:
+                return "only constants and symbol declarations can be precompiled.";
+            case message::file_not_found:
+                return "cannot find file `%0`.";
+            case message::invalid_file_range:
+                return "offset %0 is past the end of `%1`, which is %2 bytes long.";
+            case message::unsupported_statement:
+                return "invalid or unsupported statement starting with `%0`.";
+            case message::unsupported_repetition:
+                return "`times` takes a count and a data directive (`db`, `dw`, `dd`, `dq` or `dt`); instructions cannot be "
+                    "repeated yet.";
+        }
+
+        return "";
+    }
+
+    std::string _text(const reaver::assembler::utils::diagnostic & diag)
+    {
+        std::string ret;
+
+        for (auto format = _format(diag.id); *format; ++format)
+        {
+            if (*format == '%' && format[1] >= '0' && format[1] <= '9')
+            {
+                std::size_t index = *++format - '0';
+                if (index < diag.arguments.size())
+                {
+                    ret.append(diag.arguments[index]);
+                }
+
+                continue;
+            }
+
+            ret.push_back(*format);
+        }
+
+        return ret;
+    }
+}
+
+bool reaver::assembler::utils::diagnostics::push(diagnostic diag)
+{
+    if (diag.level == logger::warning)
+    {
+        diag.level = _warning_level;
+    }
+
+    bool error = diag.level >= logger::error;
+    if (error)
+    {
+        ++_errors;
+    }
+
+    if (_capped)
+    {
+        return false;
+    }
+
+    _records.push_back(std::move(diag));
+
+    if (error && _errors == _limit)
+    {
+        _records.push_back({ logger::note, message::too_many_errors, nullptr, 0, 0, {} });
+        _capped = true;
+        return false;
+    }
+
+    return true;
+}
+
+void reaver::assembler::utils::diagnostics::render(error_engine & engine) const
+{
+    for (const auto & diag : _records)
+    {
+        auto text = exception(diag.level) << _text(diag);
+
+        if (!diag.chain)
+        {
+            engine.push(std::move(text));
+            continue;
+        }
+
+        if (diag.chain->line == diag.line)
+        {
+            engine.push({ diag.chain->exception(diag.column), std::move(text) });
+            continue;
+        }
+
+        include_chain chain{ *diag.chain };
+        chain.line = diag.line;
+        engine.push({ chain.exception(diag.column), std::move(text) });
+    }
+}
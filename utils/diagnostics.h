@@ -0,0 +1,106 @@
+/**
+ * Reaver Project Assembler License
+ *
+ * Copyright © 2014 Michał "Griwes" Dominiak
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation is required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ **/
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+
+#include <reaver/error.h>
+
+#include "include_chain.h"
+
+namespace reaver
+{
+    namespace assembler
+    {
+        namespace utils
+        {
+            enum class message
+            {
+                too_many_errors,
+                invalid_line_continuation,
+                unexpected_character,
+                too_many_operands,
+                unknown_instruction,
+                invalid_operands,
+                ambiguous_size,
+                invalid_address,
+                invalid_in_mode,
+                rex_conflict,
+                unknown_prefix,
+                label_redefinition,
+                long_mode_unavailable,
+                invalid_mode,
+                invalid_integer,
+                invalid_register,
+                far_address,
+                invalid_base_register,
+                floating_point_operand,
+                undefined_symbol,
+                invalid_precompiled_header,
+                stale_precompiled_header,
+                not_a_declaration,
+                file_not_found,
+                invalid_file_range,
+                unsupported_statement,
+                unsupported_repetition
+            };
+
+            struct diagnostic
+            {
+                logger::level level;
+                message id;
+                std::shared_ptr<include_chain> chain;
+                uint64_t line;
+                std::size_t column;
+                std::vector<std::string> arguments;
+            };
+
+            // keeps diagnostics as records; text, styles and include stacks are only produced by render()
+            class diagnostics
+            {
+            public:
+                diagnostics(logger::level warning_level, std::size_t limit) : _warning_level{ warning_level }, _limit{ limit }
+                {
+                }
+
+                bool push(diagnostic);
+
+                std::size_t errors() const
+                {
+                    return _errors;
+                }
+
+                void render(error_engine &) const;
+
+            private:
+                logger::level _warning_level;
+                std::size_t _limit;
+                std::size_t _errors = 0;
+                bool _capped = false;
+                std::vector<diagnostic> _records;
+            };
+        }
+    }
+}
@@ -0,0 +1,141 @@
+/**
+ * Reaver Project Assembler License
+ *
+ * Copyright © 2014 Michał "Griwes" Dominiak
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation is required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ **/
+
+#pragma once
+
+#include <string>
+#include <memory>
+#include <map>
+#include <list>
+#include <mutex>
+#include <fstream>
+#include <sstream>
+#include <ctime>
+
+#include <sys/stat.h>
+
+namespace reaver
+{
+    namespace assembler
+    {
+        namespace utils
+        {
+            // contents of included files, kept between requests of the server; an entry is reused only while the file
+            // is the same inode with the same size and nanosecond modification time, and the least recently used
+            // entries are dropped once the contents exceed the capacity
+            class file_cache
+            {
+            public:
+                file_cache(std::size_t capacity = 256 * 1024 * 1024) : _capacity{ capacity }
+                {
+                }
+
+                std::shared_ptr<const std::string> get(const std::string & path)
+                {
+                    timespec now;
+                    ::clock_gettime(CLOCK_REALTIME, &now);
+
+                    struct stat info;
+                    if (::stat(path.c_str(), &info) != 0 || !S_ISREG(info.st_mode))
+                    {
+                        return nullptr;
+                    }
+
+                    {
+                        std::lock_guard<std::mutex> lock{ _lock };
+
+                        auto it = _entries.find(path);
+                        if (it != _entries.end() && _same(it->second.info, info))
+                        {
+                            _order.splice(_order.begin(), _order, it->second.position);
+                            return it->second.contents;
+                        }
+                    }
+
+                    std::ifstream file{ path, std::ios::in | std::ios::binary };
+                    if (!file)
+                    {
+                        return nullptr;
+                    }
+
+                    std::ostringstream contents;
+                    contents << file.rdbuf();
+                    auto ret = std::make_shared<const std::string>(contents.str());
+
+                    std::lock_guard<std::mutex> lock{ _lock };
+                    _erase(path);
+
+                    // a file modified in the last second can still change without its timestamp moving, as filesystems
+                    // only update it once per tick; it is read again until it settles
+                    if (info.st_mtim.tv_sec + 1 >= now.tv_sec || ret->size() > _capacity)
+                    {
+                        return ret;
+                    }
+
+                    _order.push_front(path);
+                    _entries[path] = { info, ret, _order.begin() };
+                    _size += ret->size();
+
+                    while (_size > _capacity)
+                    {
+                        _erase(_order.back());
+                    }
+
+                    return ret;
+                }
+
+            private:
+                struct _entry
+                {
+                    struct stat info;
+                    std::shared_ptr<const std::string> contents;
+                    std::list<std::string>::iterator position;
+                };
+
+                static bool _same(const struct stat & lhs, const struct stat & rhs)
+                {
+                    return lhs.st_dev == rhs.st_dev && lhs.st_ino == rhs.st_ino && lhs.st_size == rhs.st_size
+                        && lhs.st_mtim.tv_sec == rhs.st_mtim.tv_sec && lhs.st_mtim.tv_nsec == rhs.st_mtim.tv_nsec;
+                }
+
+                void _erase(const std::string & path)
+                {
+                    auto it = _entries.find(path);
+                    if (it == _entries.end())
+                    {
+                        return;
+                    }
+
+                    _size -= it->second.contents->size();
+                    _order.erase(it->second.position);
+                    _entries.erase(it);
+                }
+
+                std::mutex _lock;
+                std::size_t _capacity;
+                std::size_t _size = 0;
+                std::list<std::string> _order;
+                std::map<std::string, _entry> _entries;
+            };
+        }
+    }
+}
@@ -0,0 +1,508 @@
+/**
+ * Reaver Project Assembler License
+ *
+ * Copyright © 2014 Michał "Griwes" Dominiak
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation is required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ **/
+
+#include <vector>
+#include <algorithm>
+
+#include "floating_point.h"
+
+namespace
+{
+    using boost::multiprecision::cpp_int;
+
+    struct _format
+    {
+        std::int64_t precision;
+        std::int64_t exponent_bits;
+
+        std::int64_t bias() const
+        {
+            return (std::int64_t{ 1 } << (exponent_bits - 1)) - 1;
+        }
+
+        std::int64_t infinity() const
+        {
+            return (std::int64_t{ 1 } << exponent_bits) - 1;
+        }
+    };
+
+    const _format _binary32{ 24, 8 };
+    const _format _binary64{ 53, 11 };
+    const _format _extended{ 64, 15 };
+
+    // significand has `precision` bits, with the integer bit set unless the value is subnormal or zero; the biased
+    // exponent is 0 for subnormals and zero, and all ones for infinities
+    struct _float
+    {
+        bool negative;
+        std::uint64_t significand;
+        std::int64_t exponent;
+
+        bool operator==(const _float & other) const
+        {
+            return negative == other.negative && significand == other.significand && exponent == other.exponent;
+        }
+
+        bool operator!=(const _float & other) const
+        {
+            return !(*this == other);
+        }
+    };
+
+    _float _infinity(bool negative, const _format & format)
+    {
+        return { negative, 0, format.infinity() };
+    }
+
+    std::uint64_t _pack(const _float & value, const _format & format)
+    {
+        auto ret = value.significand & ((std::uint64_t{ 1 } << (format.precision - 1)) - 1);
+        ret |= static_cast<std::uint64_t>(value.exponent) << (format.precision - 1);
+        ret |= static_cast<std::uint64_t>(value.negative) << (format.precision - 1 + format.exponent_bits);
+        return ret;
+    }
+
+    std::array<std::uint8_t, 10> _pack_extended(const _float & value)
+    {
+        auto significand = value.exponent ? value.significand | std::uint64_t{ 1 } << 63 : value.significand;
+        auto exponent = static_cast<std::uint16_t>(value.exponent | value.negative << 15);
+
+        std::array<std::uint8_t, 10> ret;
+
+        for (std::size_t i = 0; i < 8; ++i)
+        {
+            ret[i] = significand >> (i * 8);
+        }
+
+        ret[8] = exponent;
+        ret[9] = exponent >> 8;
+
+        return ret;
+    }
+
+    // rounds numerator / denominator, both positive, with exact integer division
+    _float _exact(bool negative, const cpp_int & numerator, const cpp_int & denominator, const _format & format)
+    {
+        if (numerator == 0)
+        {
+            return { negative, 0, 0 };
+        }
+
+        // numerator / denominator = quotient * 2^shift; this first guess puts the quotient in (2^(precision - 2), 2^precision)
+        std::int64_t shift = static_cast<std::int64_t>(boost::multiprecision::msb(numerator))
+            - static_cast<std::int64_t>(boost::multiprecision::msb(denominator)) - (format.precision - 1);
+        std::int64_t subnormal = 1 - format.bias() - (format.precision - 1);
+
+        cpp_int quotient, remainder, divisor;
+
+        auto divide = [&]()
+        {
+            cpp_int dividend = numerator;
+            divisor = denominator;
+
+            if (shift >= 0)
+            {
+                divisor <<= shift;
+            }
+
+            else
+            {
+                dividend <<= -shift;
+            }
+
+            boost::multiprecision::divide_qr(dividend, divisor, quotient, remainder);
+        };
+
+        shift = std::max(shift, subnormal);
+        divide();
+
+        cpp_int integer_bit = cpp_int{ 1 } << (format.precision - 1);
+
+        if (quotient < integer_bit && shift > subnormal)
+        {
+            --shift;
+            divide();
+        }
+
+        remainder *= 2;
+        if (remainder > divisor || (remainder == divisor && (quotient & 1) != 0))
+        {
+            ++quotient;
+        }
+
+        if (quotient == integer_bit * 2)
+        {
+            quotient >>= 1;
+            ++shift;
+        }
+
+        auto exponent = quotient >= integer_bit ? shift + format.precision - 1 + format.bias() : 0;
+        if (exponent >= format.infinity())
+        {
+            return _infinity(negative, format);
+        }
+
+        return { negative, quotient.convert_to<std::uint64_t>(), exponent };
+    }
+
+    // 128 bit approximations of powers of five, rounded down: 5^q = (high * 2^64 + low) * 2^(log2 - 127)
+    struct _power
+    {
+        std::uint64_t high;
+        std::uint64_t low;
+        std::int64_t log2;
+    };
+
+    const std::int64_t _min_power = -342;
+    const std::int64_t _max_power = 308;
+
+    const std::vector<_power> & _powers()
+    {
+        static const std::vector<_power> table = []()
+        {
+            std::vector<_power> ret(_max_power - _min_power + 1);
+            cpp_int mask = (cpp_int{ 1 } << 64) - 1;
+            cpp_int five = 1;
+
+            for (std::int64_t q = 0; q <= std::max(_max_power, -_min_power); five *= 5, ++q)
+            {
+                std::int64_t bits = boost::multiprecision::msb(five);
+
+                if (q <= _max_power)
+                {
+                    cpp_int value = bits >= 127 ? cpp_int{ five >> (bits - 127) } : cpp_int{ five << (127 - bits) };
+                    ret[q - _min_power] = { static_cast<std::uint64_t>(value >> 64), static_cast<std::uint64_t>(value & mask),
+                        bits };
+                }
+
+                if (q && -q >= _min_power)
+                {
+                    cpp_int value = (cpp_int{ 1 } << (128 + bits)) / five;
+                    ret[-q - _min_power] = { static_cast<std::uint64_t>(value >> 64), static_cast<std::uint64_t>(value & mask),
+                        -(bits + 1) };
+                }
+            }
+
+            return ret;
+        }();
+
+        return table;
+    }
+
+    void _multiply(std::uint64_t a, std::uint64_t b, std::uint64_t & high, std::uint64_t & low)
+    {
+        std::uint64_t mask = 0xffffffff;
+
+        auto ll = (a & mask) * (b & mask);
+        auto lh = (a & mask) * (b >> 32);
+        auto hl = (a >> 32) * (b & mask);
+        auto hh = (a >> 32) * (b >> 32);
+
+        auto middle = (ll >> 32) + (lh & mask) + (hl & mask);
+
+        low = (middle << 32) | (ll & mask);
+        high = hh + (lh >> 32) + (hl >> 32) + (middle >> 32);
+    }
+
+    std::int64_t _leading_zeros(std::uint64_t value)
+    {
+        std::int64_t ret = 0;
+
+        for (std::int64_t step = 32; step; step /= 2)
+        {
+            if (!(value >> (64 - step)))
+            {
+                value <<= step;
+                ret += step;
+            }
+        }
+
+        return ret;
+    }
+
+    // `count` (at most 64) bits of a 192 bit number, starting at bit `from`
+    std::uint64_t _field(const std::uint64_t (&words)[3], std::int64_t from, std::int64_t count)
+    {
+        auto index = from / 64;
+        auto offset = from % 64;
+
+        auto ret = words[index] >> offset;
+        if (offset && index < 2)
+        {
+            ret |= words[index + 1] << (64 - offset);
+        }
+
+        return count == 64 ? ret : ret & ((std::uint64_t{ 1 } << count) - 1);
+    }
+
+    // Eisel-Lemire: multiplies the decimal significand by the truncated power of five and rounds the top bits of the 192
+    // bit product; gives up on subnormals and whenever the truncation of the power could change the rounding
+    boost::optional<_float> _approximate(bool negative, std::uint64_t digits, std::int64_t power, const _format & format)
+    {
+        if (power < _min_power || power > _max_power)
+        {
+            return boost::none;
+        }
+
+        const auto & five = _powers()[power - _min_power];
+        auto zeros = _leading_zeros(digits);
+        digits <<= zeros;
+
+        std::uint64_t low_high, low_low, high_high, high_low;
+        _multiply(digits, five.low, low_high, low_low);
+        _multiply(digits, five.high, high_high, high_low);
+
+        std::uint64_t words[3] = { low_low, low_high + high_low, high_high };
+        words[2] += words[1] < low_high;
+
+        std::int64_t top = words[2] >> 63 ? 191 : 190;
+        auto round = top - format.precision;
+
+        // the exact product exceeds the computed one by less than 2^64; that matters only when the bits between 2^64 and
+        // the rounding bit are all ones (the difference may carry into it) or, with the rounding bit set, all zeros (the
+        // value may be exactly halfway)
+        bool ones = true;
+        bool none = true;
+
+        for (std::int64_t from = 64; from < round; from += 64)
+        {
+            auto count = std::min<std::int64_t>(64, round - from);
+            auto bits = _field(words, from, count);
+
+            ones = ones && bits == (count == 64 ? ~std::uint64_t{ 0 } : (std::uint64_t{ 1 } << count) - 1);
+            none = none && bits == 0;
+        }
+
+        bool up = _field(words, round, 1);
+        if (ones || (up && none))
+        {
+            return boost::none;
+        }
+
+        auto significand = _field(words, round + 1, format.precision);
+        auto exponent = top + five.log2 - 127 + power - zeros + format.bias();
+
+        if (up)
+        {
+            ++significand;
+
+            if (format.precision == 64 ? significand == 0 : significand >> format.precision)
+            {
+                significand = std::uint64_t{ 1 } << (format.precision - 1);
+                ++exponent;
+            }
+        }
+
+        if (exponent <= 0)
+        {
+            return boost::none;
+        }
+
+        if (exponent >= format.infinity())
+        {
+            return _infinity(negative, format);
+        }
+
+        return _float{ negative, significand, exponent };
+    }
+
+    _float _convert(const reaver::assembler::utils::decimal & value, const _format & format)
+    {
+        if (value.digits.empty())
+        {
+            return { value.negative, 0, 0 };
+        }
+
+        // far outside of the range of every supported format, and too far to be worth exact arithmetic
+        auto magnitude = static_cast<std::int64_t>(value.digits.size()) + value.exponent;
+        if (magnitude > 5000)
+        {
+            return _infinity(value.negative, format);
+        }
+
+        if (magnitude < -5000)
+        {
+            return { value.negative, 0, 0 };
+        }
+
+        auto used = std::min<std::size_t>(value.digits.size(), 19);
+        std::uint64_t digits = 0;
+
+        for (std::size_t i = 0; i < used; ++i)
+        {
+            digits = digits * 10 + (value.digits[i] - '0');
+        }
+
+        auto power = value.exponent + static_cast<std::int64_t>(value.digits.size() - used);
+        auto ret = _approximate(value.negative, digits, power, format);
+
+        // the dropped digits put the value strictly between the two truncations
+        if (ret && used < value.digits.size())
+        {
+            auto upper = _approximate(value.negative, digits + 1, power, format);
+            if (!upper || *upper != *ret)
+            {
+                ret = boost::none;
+            }
+        }
+
+        if (ret)
+        {
+            return *ret;
+        }
+
+        cpp_int numerator{ value.digits };
+        cpp_int denominator = 1;
+
+        if (value.exponent >= 0)
+        {
+            numerator *= boost::multiprecision::pow(cpp_int{ 10 }, static_cast<unsigned>(value.exponent));
+        }
+
+        else
+        {
+            denominator = boost::multiprecision::pow(cpp_int{ 10 }, static_cast<unsigned>(-value.exponent));
+        }
+
+        return _exact(value.negative, numerator, denominator, format);
+    }
+
+    _float _convert(const boost::multiprecision::cpp_rational & value, const _format & format)
+    {
+        return _exact(value < 0, boost::multiprecision::abs(boost::multiprecision::numerator(value)),
+            boost::multiprecision::denominator(value), format);
+    }
+
+    bool _digit(char c)
+    {
+        return c >= '0' && c <= '9';
+    }
+}
+
+boost::optional<reaver::assembler::utils::decimal> reaver::assembler::utils::parse_decimal(const std::string & literal)
+{
+    decimal ret;
+    std::int64_t exponent = 0;
+    bool any = false;
+
+    auto it = literal.begin();
+
+    if (it != literal.end() && (*it == '+' || *it == '-'))
+    {
+        ret.negative = *it++ == '-';
+    }
+
+    for (; it != literal.end() && _digit(*it); ++it)
+    {
+        ret.digits.push_back(*it);
+        any = true;
+    }
+
+    if (it != literal.end() && *it == '.')
+    {
+        for (++it; it != literal.end() && _digit(*it); ++it)
+        {
+            ret.digits.push_back(*it);
+            --exponent;
+            any = true;
+        }
+    }
+
+    if (!any)
+    {
+        return boost::none;
+    }
+
+    if (it != literal.end() && (*it == 'e' || *it == 'E'))
+    {
+        bool negative = false;
+        std::int64_t value = 0;
+        any = false;
+
+        if (++it != literal.end() && (*it == '+' || *it == '-'))
+        {
+            negative = *it++ == '-';
+        }
+
+        // anything past a billion is out of range anyway
+        for (; it != literal.end() && _digit(*it); ++it)
+        {
+            value = std::min<std::int64_t>(value * 10 + (*it - '0'), 1000000000);
+            any = true;
+        }
+
+        if (!any)
+        {
+            return boost::none;
+        }
+
+        exponent += negative ? -value : value;
+    }
+
+    if (it != literal.end())
+    {
+        return boost::none;
+    }
+
+    auto first = ret.digits.find_first_not_of('0');
+    if (first == std::string::npos)
+    {
+        ret.digits.clear();
+        return ret;
+    }
+
+    auto last = ret.digits.find_last_not_of('0');
+    ret.exponent = exponent + static_cast<std::int64_t>(ret.digits.size() - 1 - last);
+    ret.digits = ret.digits.substr(first, last - first + 1);
+
+    return ret;
+}
+
+std::uint32_t reaver::assembler::utils::to_binary32(const decimal & value)
+{
+    return _pack(_convert(value, _binary32), _binary32);
+}
+
+std::uint64_t reaver::assembler::utils::to_binary64(const decimal & value)
+{
+    return _pack(_convert(value, _binary64), _binary64);
+}
+
+std::array<std::uint8_t, 10> reaver::assembler::utils::to_extended(const decimal & value)
+{
+    return _pack_extended(_convert(value, _extended));
+}
+
+std::uint32_t reaver::assembler::utils::to_binary32(const boost::multiprecision::cpp_rational & value)
+{
+    return _pack(_convert(value, _binary32), _binary32);
+}
+
+std::uint64_t reaver::assembler::utils::to_binary64(const boost::multiprecision::cpp_rational & value)
+{
+    return _pack(_convert(value, _binary64), _binary64);
+}
+
+std::array<std::uint8_t, 10> reaver::assembler::utils::to_extended(const boost::multiprecision::cpp_rational & value)
+{
+    return _pack_extended(_convert(value, _extended));
+}
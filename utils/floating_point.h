@@ -0,0 +1,63 @@
+/**
+ * Reaver Project Assembler License
+ *
+ * Copyright © 2014 Michał "Griwes" Dominiak
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation is required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ **/
+
+#pragma once
+
+#include <cstdint>
+#include <array>
+#include <string>
+
+#include <boost/optional.hpp>
+#include <boost/multiprecision/cpp_int.hpp>
+
+namespace reaver
+{
+    namespace assembler
+    {
+        namespace utils
+        {
+            // value = digits * 10^exponent; digits has no leading or trailing zeros and is empty for zero
+            struct decimal
+            {
+                bool negative = false;
+                std::string digits;
+                std::int64_t exponent = 0;
+            };
+
+            // accepts `[+-]digits[.digits][(e|E)[+-]digits]`
+            boost::optional<decimal> parse_decimal(const std::string &);
+
+            // all conversions round to nearest, ties to even; values out of range become infinities or zeros
+
+            // tries the Eisel-Lemire approximation first and falls back to exact integer arithmetic only when its result
+            // could be off by one
+            std::uint32_t to_binary32(const decimal &);
+            std::uint64_t to_binary64(const decimal &);
+            std::array<std::uint8_t, 10> to_extended(const decimal &);
+
+            // exact conversions of a rational value
+            std::uint32_t to_binary32(const boost::multiprecision::cpp_rational &);
+            std::uint64_t to_binary64(const boost::multiprecision::cpp_rational &);
+            std::array<std::uint8_t, 10> to_extended(const boost::multiprecision::cpp_rational &);
+        }
+    }
+}
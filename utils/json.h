@@ -0,0 +1,64 @@
+/**
+ * Reaver Project Assembler License
+ *
+ * Copyright © 2014 Michał "Griwes" Dominiak
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation is required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ **/
+
+
+#pragma once
+
+#include <ostream>
+#include <string>
+
+namespace reaver
+{
+    namespace assembler
+    {
+        namespace utils
+        {
+            // writes a quoted JSON string; names in reports and traces come from the input, e.g. section names
+            inline void write_json_string(std::ostream & out, const std::string & str)
+            {
+                static const char digits[] = "0123456789abcdef";
+
+                out << '"';
+
+                for (unsigned char c : str)
+                {
+                    if (c == '"' || c == '\\')
+                    {
+                        out << '\\' << c;
+                    }
+
+                    else if (c < 0x20)
+                    {
+                        out << "\\u00" << digits[c >> 4] << digits[c & 0xf];
+                    }
+
+                    else
+                    {
+                        out << c;
+                    }
+                }
+
+                out << '"';
+            }
+        }
+    }
+}
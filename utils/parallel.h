@@ -0,0 +1,87 @@
+/**
+ * Reaver Project Assembler License
+ *
+ * Copyright © 2014 Michał "Griwes" Dominiak
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation is required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ **/
+
+#pragma once
+
+#include <cstddef>
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace reaver
+{
+    namespace assembler
+    {
+        namespace utils
+        {
+            template<typename F>
+            void parallel_for(std::size_t count, F && f)
+            {
+                std::atomic<std::size_t> next{ 0 };
+                std::mutex failure_lock;
+                std::exception_ptr failure;
+
+                auto worker = [&]()
+                {
+                    try
+                    {
+                        std::size_t i;
+                        while ((i = next++) < count)
+                        {
+                            f(i);
+                        }
+                    }
+
+                    catch (...)
+                    {
+                        std::lock_guard<std::mutex> lock{ failure_lock };
+                        failure = std::current_exception();
+                        next = count;
+                    }
+                };
+
+                std::vector<std::thread> threads;
+                auto thread_count = std::min<std::size_t>(std::max(std::thread::hardware_concurrency(), 1u), count);
+
+                for (std::size_t i = 1; i < thread_count; ++i)
+                {
+                    threads.emplace_back(worker);
+                }
+
+                worker();
+
+                for (auto & thread : threads)
+                {
+                    thread.join();
+                }
+
+                if (failure)
+                {
+                    std::rethrow_exception(failure);
+                }
+            }
+        }
+    }
+}
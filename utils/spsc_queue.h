@@ -0,0 +1,196 @@
+/**
+ * Reaver Project Assembler License
+ *
+ * Copyright © 2014 Michał "Griwes" Dominiak
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation is required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ **/
+
+#pragma once
+
+#include <cstddef>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+namespace reaver
+{
+    namespace assembler
+    {
+        namespace utils
+        {
+            // bounded single producer, single consumer ring buffer; push() blocks while the queue is full, pop() while it
+            // is empty, and the time spent blocked is accumulated for each side
+            template<typename T>
+            class spsc_queue
+            {
+            public:
+                spsc_queue(std::size_t capacity) : _slots(capacity + 1)
+                {
+                }
+
+                bool try_push(T && value)
+                {
+                    auto tail = _tail.load(std::memory_order_relaxed);
+                    auto next = (tail + 1) % _slots.size();
+
+                    if (next == _head.load(std::memory_order_acquire))
+                    {
+                        return false;
+                    }
+
+                    _slots[tail] = std::move(value);
+                    _tail.store(next, std::memory_order_release);
+
+                    auto occupancy = (next + _slots.size() - _head.load(std::memory_order_relaxed)) % _slots.size();
+                    if (occupancy > _peak)
+                    {
+                        _peak = occupancy;
+                    }
+
+                    ++_pushed;
+                    return true;
+                }
+
+                bool try_pop(T & value)
+                {
+                    auto head = _head.load(std::memory_order_relaxed);
+
+                    if (head == _tail.load(std::memory_order_acquire))
+                    {
+                        return false;
+                    }
+
+                    value = std::move(_slots[head]);
+                    _slots[head] = T{};
+                    _head.store((head + 1) % _slots.size(), std::memory_order_release);
+
+                    return true;
+                }
+
+                // returns false if the consumer has abandoned the queue
+                bool push(T && value)
+                {
+                    if (_closed.load(std::memory_order_acquire))
+                    {
+                        return false;
+                    }
+
+                    if (try_push(std::move(value)))
+                    {
+                        return true;
+                    }
+
+                    auto start = std::chrono::steady_clock::now();
+
+                    for (std::size_t spins = 0; !try_push(std::move(value)); ++spins)
+                    {
+                        if (_closed.load(std::memory_order_acquire))
+                        {
+                            return false;
+                        }
+
+                        _wait(spins);
+                    }
+
+                    _producer_stall += std::chrono::steady_clock::now() - start;
+                    return true;
+                }
+
+                // returns false once the queue is closed and drained
+                bool pop(T & value)
+                {
+                    if (try_pop(value))
+                    {
+                        return true;
+                    }
+
+                    auto start = std::chrono::steady_clock::now();
+
+                    for (std::size_t spins = 0; !try_pop(value); ++spins)
+                    {
+                        if (_closed.load(std::memory_order_acquire))
+                        {
+                            _consumer_stall += std::chrono::steady_clock::now() - start;
+                            return try_pop(value);
+                        }
+
+                        _wait(spins);
+                    }
+
+                    _consumer_stall += std::chrono::steady_clock::now() - start;
+                    return true;
+                }
+
+                void close()
+                {
+                    _closed.store(true, std::memory_order_release);
+                }
+
+                std::size_t capacity() const
+                {
+                    return _slots.size() - 1;
+                }
+
+                std::size_t peak() const
+                {
+                    return _peak;
+                }
+
+                std::size_t pushed() const
+                {
+                    return _pushed;
+                }
+
+                std::chrono::nanoseconds producer_stall() const
+                {
+                    return _producer_stall;
+                }
+
+                std::chrono::nanoseconds consumer_stall() const
+                {
+                    return _consumer_stall;
+                }
+
+            private:
+                static void _wait(std::size_t spins)
+                {
+                    if (spins < 64)
+                    {
+                        std::this_thread::yield();
+                        return;
+                    }
+
+                    std::this_thread::sleep_for(std::chrono::microseconds{ 50 });
+                }
+
+                std::vector<T> _slots;
+
+                alignas(64) std::atomic<std::size_t> _head{ 0 };
+                std::chrono::nanoseconds _consumer_stall{ 0 };
+
+                alignas(64) std::atomic<std::size_t> _tail{ 0 };
+                std::chrono::nanoseconds _producer_stall{ 0 };
+                std::size_t _peak = 0;
+                std::size_t _pushed = 0;
+
+                std::atomic<bool> _closed{ false };
+            };
+        }
+    }
+}
@@ -0,0 +1,305 @@
+/**
+ * Reaver Project Assembler License
+ *
+ * Copyright © 2014 Michał "Griwes" Dominiak
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation is required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ **/
+
+#pragma once
+
+#include <cstdint>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <map>
+#include <mutex>
+#include <ostream>
+#include <iomanip>
+#include <algorithm>
+
+#include <time.h>
+
+#include "allocation.h"
+#include "json.h"
+
+namespace reaver
+{
+    namespace assembler
+    {
+        namespace utils
+        {
+            class statistics
+            {
+            public:
+                struct duration
+                {
+                    std::chrono::nanoseconds wall{ 0 };
+                    std::chrono::nanoseconds cpu{ 0 };
+                };
+
+                class stopwatch
+                {
+                public:
+                    void start()
+                    {
+                        _wall = std::chrono::steady_clock::now();
+                        _cpu = _thread_time();
+                    }
+
+                    void stop()
+                    {
+                        _elapsed.wall += std::chrono::steady_clock::now() - _wall;
+                        _elapsed.cpu += _thread_time() - _cpu;
+                    }
+
+                    const duration & elapsed() const
+                    {
+                        return _elapsed;
+                    }
+
+                private:
+                    std::chrono::steady_clock::time_point _wall;
+                    std::chrono::nanoseconds _cpu;
+                    duration _elapsed;
+                };
+
+                class scope
+                {
+                public:
+                    scope(statistics * stats, std::string phase) : _statistics{ stats }, _phase{ std::move(phase) }
+                    {
+                        if (_statistics)
+                        {
+                            if (allocation::enabled)
+                            {
+                                _outer_peak = allocation::reset_peak();
+                                _memory = allocation::current();
+                            }
+
+                            _watch.start();
+                        }
+                    }
+
+                    ~scope()
+                    {
+                        if (!_statistics)
+                        {
+                            return;
+                        }
+
+                        _watch.stop();
+                        _statistics->add(_phase, _watch.elapsed());
+
+                        if (allocation::enabled)
+                        {
+                            auto memory = allocation::current();
+                            _statistics->count("allocations in " + _phase, memory.allocations - _memory.allocations);
+                            _statistics->count("allocated bytes in " + _phase, memory.bytes - _memory.bytes);
+                            _statistics->maximum("peak memory in " + _phase, memory.peak);
+                            allocation::raise_peak(_outer_peak);
+                        }
+                    }
+
+                private:
+                    statistics * _statistics;
+                    std::string _phase;
+                    stopwatch _watch;
+                    allocation::snapshot _memory{};
+                    std::uint64_t _outer_peak = 0;
+                };
+
+                void add(const std::string & phase, const duration & elapsed)
+                {
+                    std::lock_guard<std::mutex> lock{ _lock };
+
+                    if (!_times.count(phase))
+                    {
+                        _phases.push_back(phase);
+                    }
+
+                    _times[phase].wall += elapsed.wall;
+                    _times[phase].cpu += elapsed.cpu;
+                }
+
+                void count(const std::string & name, std::uint64_t value = 1)
+                {
+                    std::lock_guard<std::mutex> lock{ _lock };
+
+                    if (!_counters.count(name))
+                    {
+                        _names.push_back(name);
+                    }
+
+                    _counters[name] += value;
+                }
+
+                void maximum(const std::string & name, std::uint64_t value)
+                {
+                    std::lock_guard<std::mutex> lock{ _lock };
+
+                    if (!_counters.count(name))
+                    {
+                        _names.push_back(name);
+                    }
+
+                    _counters[name] = std::max(_counters[name], value);
+                }
+
+                void print(std::ostream & out, bool times, bool counters, bool json) const
+                {
+                    std::lock_guard<std::mutex> lock{ _lock };
+
+                    json ? _print_json(out, times, counters) : _print_text(out, times, counters);
+                }
+
+            private:
+                static std::chrono::nanoseconds _thread_time()
+                {
+                    timespec ts;
+                    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+                    return std::chrono::seconds{ ts.tv_sec } + std::chrono::nanoseconds{ ts.tv_nsec };
+                }
+
+                static double _milliseconds(std::chrono::nanoseconds ns)
+                {
+                    return ns.count() / 1e6;
+                }
+
+                // phases are stored in the order they first finish; report parents before their sub-phases
+                std::vector<std::string> _ordered() const
+                {
+                    std::vector<std::string> ret;
+
+                    auto parent = [](const std::string & phase) { return phase.substr(0, phase.find('/')); };
+
+                    for (const auto & phase : _phases)
+                    {
+                        if (phase.find('/') != std::string::npos)
+                        {
+                            continue;
+                        }
+
+                        ret.push_back(phase);
+
+                        for (const auto & sub : _phases)
+                        {
+                            if (sub != phase && parent(sub) == phase)
+                            {
+                                ret.push_back(sub);
+                            }
+                        }
+                    }
+
+                    for (const auto & phase : _phases)
+                    {
+                        if (!_times.count(parent(phase)))
+                        {
+                            ret.push_back(phase);
+                        }
+                    }
+
+                    return ret;
+                }
+
+                void _print_text(std::ostream & out, bool times, bool counters) const
+                {
+                    auto flags = out.flags();
+                    out << std::fixed << std::setprecision(3);
+
+                    if (times)
+                    {
+                        out << "Time report:\n" << std::left << std::setw(40) << "  phase" << std::right << std::setw(14)
+                            << "wall (ms)" << std::setw(14) << "cpu (ms)" << '\n';
+
+                        for (const auto & phase : _ordered())
+                        {
+                            auto slash = phase.find('/');
+                            auto name = slash == std::string::npos ? "  " + phase : "    " + phase.substr(slash + 1);
+                            const auto & elapsed = _times.at(phase);
+
+                            out << std::left << std::setw(40) << name << std::right << std::setw(14)
+                                << _milliseconds(elapsed.wall) << std::setw(14) << _milliseconds(elapsed.cpu) << '\n';
+                        }
+                    }
+
+                    if (counters)
+                    {
+                        out << "Statistics:\n";
+
+                        for (const auto & name : _names)
+                        {
+                            out << std::left << std::setw(40) << "  " + name << std::right << std::setw(14)
+                                << _counters.at(name) << '\n';
+                        }
+                    }
+
+                    out.flags(flags);
+                }
+
+                void _print_json(std::ostream & out, bool times, bool counters) const
+                {
+                    auto flags = out.flags();
+                    out << std::fixed << std::setprecision(3) << "{";
+
+                    if (times)
+                    {
+                        out << "\"time\": {";
+
+                        bool first = true;
+                        for (const auto & phase : _ordered())
+                        {
+                            const auto & elapsed = _times.at(phase);
+                            out << (first ? "" : ", ");
+                            write_json_string(out, phase);
+                            out << ": { \"wall_ms\": " << _milliseconds(elapsed.wall)
+                                << ", \"cpu_ms\": " << _milliseconds(elapsed.cpu) << " }";
+                            first = false;
+                        }
+
+                        out << "}";
+                    }
+
+                    if (counters)
+                    {
+                        out << (times ? ", " : "") << "\"stats\": {";
+
+                        bool first = true;
+                        for (const auto & name : _names)
+                        {
+                            out << (first ? "" : ", ");
+                            write_json_string(out, name);
+                            out << ": " << _counters.at(name);
+                            first = false;
+                        }
+
+                        out << "}";
+                    }
+
+                    out << "}\n";
+                    out.flags(flags);
+                }
+
+                mutable std::mutex _lock;
+                std::vector<std::string> _phases;
+                std::map<std::string, duration> _times;
+                std::vector<std::string> _names;
+                std::map<std::string, std::uint64_t> _counters;
+            };
+        }
+    }
+}
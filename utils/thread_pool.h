@@ -0,0 +1,181 @@
+/**
+ * Reaver Project Assembler License
+ *
+ * Copyright © 2014 Michał "Griwes" Dominiak
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation is required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ **/
+
+#pragma once
+
+#include <cstddef>
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace reaver
+{
+    namespace assembler
+    {
+        namespace utils
+        {
+            class thread_pool
+            {
+            public:
+                thread_pool(std::size_t count = std::max(std::thread::hardware_concurrency(), 1u))
+                {
+                    for (std::size_t i = 0; i < count; ++i)
+                    {
+                        _queues.push_back(std::make_unique<_queue>());
+                    }
+
+                    for (std::size_t i = 0; i < count; ++i)
+                    {
+                        _threads.emplace_back([this, i](){ _work(i); });
+                    }
+                }
+
+                ~thread_pool()
+                {
+                    wait();
+
+                    {
+                        std::lock_guard<std::mutex> lock{ _lock };
+                        _stop = true;
+                    }
+
+                    _wake.notify_all();
+
+                    for (auto & thread : _threads)
+                    {
+                        thread.join();
+                    }
+                }
+
+                void push(std::function<void ()> task)
+                {
+                    auto & queue = *_queues[_next++ % _queues.size()];
+
+                    {
+                        std::lock_guard<std::mutex> lock{ _lock };
+                        ++_pending;
+                        ++_queued;
+
+                        std::lock_guard<std::mutex> queue_lock{ queue.lock };
+                        queue.tasks.push_back(std::move(task));
+                    }
+
+                    _wake.notify_one();
+                }
+
+                void wait()
+                {
+                    std::unique_lock<std::mutex> lock{ _lock };
+                    _done.wait(lock, [&](){ return _pending == 0; });
+                }
+
+            private:
+                struct _queue
+                {
+                    std::mutex lock;
+                    std::deque<std::function<void ()>> tasks;
+                };
+
+                bool _take(std::size_t index, std::function<void ()> & task)
+                {
+                    {
+                        auto & own = *_queues[index];
+                        std::lock_guard<std::mutex> lock{ own.lock };
+
+                        if (!own.tasks.empty())
+                        {
+                            task = std::move(own.tasks.back());
+                            own.tasks.pop_back();
+                            return true;
+                        }
+                    }
+
+                    for (std::size_t i = 1; i < _queues.size(); ++i)
+                    {
+                        auto & victim = *_queues[(index + i) % _queues.size()];
+                        std::lock_guard<std::mutex> lock{ victim.lock };
+
+                        if (!victim.tasks.empty())
+                        {
+                            task = std::move(victim.tasks.front());
+                            victim.tasks.pop_front();
+                            return true;
+                        }
+                    }
+
+                    return false;
+                }
+
+                void _work(std::size_t index)
+                {
+                    while (true)
+                    {
+                        std::function<void ()> task;
+
+                        if (_take(index, task))
+                        {
+                            {
+                                std::lock_guard<std::mutex> lock{ _lock };
+                                --_queued;
+                            }
+
+                            task();
+
+                            std::lock_guard<std::mutex> lock{ _lock };
+                            if (--_pending == 0)
+                            {
+                                _done.notify_all();
+                            }
+
+                            continue;
+                        }
+
+                        std::unique_lock<std::mutex> lock{ _lock };
+                        if (_stop)
+                        {
+                            return;
+                        }
+
+                        _wake.wait(lock, [&](){ return _stop || _queued; });
+                    }
+                }
+
+                std::vector<std::unique_ptr<_queue>> _queues;
+                std::vector<std::thread> _threads;
+                std::atomic<std::size_t> _next{ 0 };
+
+                std::mutex _lock;
+                std::condition_variable _wake;
+                std::condition_variable _done;
+                std::size_t _pending = 0;
+                std::size_t _queued = 0;
+                bool _stop = false;
+            };
+        }
+    }
+}
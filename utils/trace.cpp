@@ -0,0 +1,86 @@
+/**
+ * Reaver Project Assembler License
+ *
+ * Copyright © 2014 Michał "Griwes" Dominiak
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation is required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ **/
+
+#include <atomic>
+#include <fstream>
+#include <set>
+
+#include <unistd.h>
+
+#include "trace.h"
+#include "json.h"
+
+namespace
+{
+    std::uint32_t _thread_id()
+    {
+        static std::atomic<std::uint32_t> next{ 1 };
+        thread_local std::uint32_t id = next++;
+        return id;
+    }
+
+    std::uint64_t _microseconds(std::chrono::steady_clock::duration duration)
+    {
+        return std::chrono::duration_cast<std::chrono::microseconds>(duration).count();
+    }
+}
+
+void reaver::assembler::utils::trace::add(std::string name, const char * category,
+    std::chrono::steady_clock::time_point begin, std::chrono::steady_clock::time_point end)
+{
+    _event event{ std::move(name), category, _microseconds(begin - _start), _microseconds(end - begin), _thread_id() };
+
+    std::lock_guard<std::mutex> lock{ _lock };
+    _events.push_back(std::move(event));
+}
+
+reaver::assembler::utils::trace::~trace()
+{
+    if (_path.empty())
+    {
+        return;
+    }
+
+    std::ofstream out{ _path, std::ios::trunc };
+    auto pid = getpid();
+
+    out << "{\"traceEvents\":[\n";
+
+    std::set<std::uint32_t> threads;
+    for (const auto & event : _events)
+    {
+        out << "{\"name\":";
+        write_json_string(out, event.name);
+        out << ",\"cat\":\"" << event.category << "\",\"ph\":\"X\",\"ts\":" << event.timestamp << ",\"dur\":"
+            << event.duration << ",\"pid\":" << pid << ",\"tid\":" << event.thread << "},\n";
+
+        threads.insert(event.thread);
+    }
+
+    for (auto thread : threads)
+    {
+        out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" << pid << ",\"tid\":" << thread
+            << ",\"args\":{\"name\":\"" << "thread " << thread << "\"}},\n";
+    }
+
+    out << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":" << pid << ",\"args\":{\"name\":\"rasm\"}}\n]}\n";
+}
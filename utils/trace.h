@@ -0,0 +1,105 @@
+/**
+ * Reaver Project Assembler License
+ *
+ * Copyright © 2014 Michał "Griwes" Dominiak
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation is required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ **/
+
+#pragma once
+
+#include <cstdint>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <mutex>
+
+namespace reaver
+{
+    namespace assembler
+    {
+        namespace utils
+        {
+            // collects Chrome trace event format spans; the file is written when the trace is destroyed
+            class trace
+            {
+            public:
+                class span
+                {
+                public:
+                    span(trace * t, std::string name, const char * category) : _trace{ t }
+                    {
+                        if (_trace)
+                        {
+                            _name = std::move(name);
+                            _category = category;
+                            _start = std::chrono::steady_clock::now();
+                        }
+                    }
+
+                    span(const span &) = delete;
+                    span & operator=(const span &) = delete;
+
+                    ~span()
+                    {
+                        if (_trace)
+                        {
+                            _trace->add(std::move(_name), _category, _start, std::chrono::steady_clock::now());
+                        }
+                    }
+
+                private:
+                    trace * _trace;
+                    std::string _name;
+                    const char * _category = nullptr;
+                    std::chrono::steady_clock::time_point _start;
+                };
+
+                ~trace();
+
+                void open(std::string path)
+                {
+                    _path = std::move(path);
+                    _start = std::chrono::steady_clock::now();
+                }
+
+                bool enabled() const
+                {
+                    return !_path.empty();
+                }
+
+                void add(std::string name, const char * category, std::chrono::steady_clock::time_point begin,
+                    std::chrono::steady_clock::time_point end);
+
+            private:
+                struct _event
+                {
+                    std::string name;
+                    const char * category;
+                    std::uint64_t timestamp;
+                    std::uint64_t duration;
+                    std::uint32_t thread;
+                };
+
+                std::mutex _lock;
+                std::vector<_event> _events;
+                std::string _path;
+                std::chrono::steady_clock::time_point _start;
+            };
+        }
+    }
+}